@@ -48,6 +48,7 @@
 #include "compositor.h"
 #include "focus.h"
 #include "frame.h"
+#include "frameindex.h"
 #include "hints.h"
 #include "icons.h"
 #include "misc.h"
@@ -261,15 +262,29 @@ clientRecomputeMaximizeSize (Client *c)
     clientToggleMaximized (c, maximization_flags, FALSE);
 }
 
+/* Mapped and at least partly within the screen */
+static gboolean
+clientFrameShown (Client *c)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = c->screen_info;
+    return (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE) &&
+            (frameX (c) < screen_info->width) && (frameX (c) + frameWidth (c) > 0) &&
+            (frameY (c) < screen_info->height) && (frameY (c) + frameHeight (c) > 0));
+}
+
 void
 clientUpdateAllFrames (ScreenInfo *screen_info, int mask)
 {
     Client *c;
+    GList *hidden, *list;
     guint i;
 
     g_return_if_fail (screen_info != NULL);
     TRACE ("entering");
 
+    hidden = NULL;
     for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
     {
         unsigned short configure_flags = 0;
@@ -314,10 +329,24 @@ clientUpdateAllFrames (ScreenInfo *screen_info, int mask)
         }
         if (mask & UPDATE_FRAME)
         {
-            frameQueueDraw (c, TRUE);
+            /* Frames that can be seen are redrawn first */
+            if (clientFrameShown (c))
+            {
+                frameBatchDraw (c, TRUE);
+            }
+            else
+            {
+                hidden = g_list_prepend (hidden, c);
+            }
         }
+    }
 
+    hidden = g_list_reverse (hidden);
+    for (list = hidden; list; list = g_list_next (list))
+    {
+        frameBatchDraw ((Client *) list->data, TRUE);
     }
+    g_list_free (hidden);
 }
 
 void
@@ -653,6 +682,7 @@ clientConfigureWindows (Client *c, XWindowChanges * wc, unsigned long mask, unsi
         change_values.height = frameHeight (c);
         XConfigureWindow (display_info->dpy, c->frame, change_mask_frame, &change_values);
     }
+    frameIndexUpdate (c);
 
     if (change_mask_client & (CWX | CWY | CWWidth | CWHeight))
     {
@@ -1324,10 +1354,9 @@ clientFree (Client *c)
     {
         g_source_remove (c->icon_timeout_id);
     }
-    if (c->frame_timeout_id)
-    {
-        g_source_remove (c->frame_timeout_id);
-    }
+    frameClearQueueDraw (c);
+    frameIndexRemove (c);
+    frameFree (c);
     if (c->ping_timeout_id)
     {
         clientRemoveNetWMPing (c);
@@ -1587,23 +1616,31 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     ScreenInfo *screen_info;
     XWindowAttributes attr;
     XSetWindowAttributes attributes;
+    XWMHints *wmhints;
+    XClassHint class;
     Client *c = NULL;
+    Window *cmap_windows;
+    Window client_leader;
     gboolean shaped;
+    gboolean opacity_locked;
     gchar *wm_name;
     unsigned long valuemask;
+    guint32 opacity;
     long pid;
+    int ncmap;
     int i;
 
     g_return_val_if_fail (w != None, NULL);
     g_return_val_if_fail (display_info != NULL, NULL);
     TRACE ("window 0x%lx", w);
 
-    myDisplayGrabServer (display_info);
-
+    /*
+     * Read as much as we can from the window before grabbing the server,
+     * every round trip made with the grab held stalls all other clients.
+     */
     if (!XGetWindowAttributes (display_info->dpy, w, &attr))
     {
         DBG ("Cannot get window attributes for window (0x%lx)", w);
-        myDisplayUngrabServer (display_info);
         return NULL;
     }
 
@@ -1611,7 +1648,6 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     if (!screen_info)
     {
         DBG ("Cannot determine screen info from window (0x%lx)", w);
-        myDisplayUngrabServer (display_info);
         return NULL;
     }
 
@@ -1619,7 +1655,6 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     {
         TRACE ("not managing our own event window");
         compositorAddWindow (display_info, w, NULL);
-        myDisplayUngrabServer (display_info);
         return NULL;
     }
 
@@ -1630,7 +1665,6 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         if (screen_info->systray != None)
         {
             sendSystrayReqDock (display_info, w, screen_info->systray);
-            myDisplayUngrabServer (display_info);
             return NULL;
         }
         TRACE ("no systray found for this screen");
@@ -1641,15 +1675,19 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     {
         TRACE ("override redirect window 0x%lx", w);
         compositorAddWindow (display_info, w, NULL);
-        myDisplayUngrabServer (display_info);
         return NULL;
     }
 
+    /*
+     * Listen to the client before reading its properties, so that a
+     * change made while we read them is not lost.
+     */
+    XSelectInput (display_info->dpy, w, CLIENT_EVENT_MASK);
+
     c = g_new0 (Client, 1);
     if (!c)
     {
         TRACE ("cannot allocate memory for the window structure");
-        myDisplayUngrabServer (display_info);
         return NULL;
     }
 
@@ -1667,13 +1705,16 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     g_free (wm_name);
 
     getTransientFor (display_info, screen_info->xroot, c->window, &c->transient_for);
-    XChangeSaveSet(display_info->dpy, c->window, SetModeInsert);
 
     /* Initialize structure */
     c->size = NULL;
     c->flags = 0L;
     c->wm_flags = 0L;
     c->xfwm_flags = XFWM_FLAG_INITIAL_VALUES;
+    if (screen_info->params->single_window_frame)
+    {
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW);
+    }
     c->x = attr.x;
     c->y = attr.y;
     c->width = attr.width;
@@ -1695,6 +1736,23 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     c->cmap = attr.colormap;
 
     shaped = clientCheckShape(c);
+
+    /* Plain properties, stored in the client below */
+    if (!XGetWMColormapWindows (display_info->dpy, c->window, &cmap_windows, &ncmap))
+    {
+        cmap_windows = NULL;
+        ncmap = 0;
+    }
+    opacity = NET_WM_OPAQUE;
+    getOpacity (display_info, c->window, &opacity);
+    opacity_locked = getOpacityLock (display_info, c->window);
+    class.res_name = NULL;
+    class.res_class = NULL;
+    XGetClassHint (display_info->dpy, w, &class);
+    wmhints = XGetWMHints (display_info->dpy, c->window);
+    client_leader = getClientLeader (display_info, c->window);
+    getHint (display_info, c->window, NET_WM_PID, (long *) &pid);
+
     if (shaped)
     {
         FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_HAS_BORDER);
@@ -1715,10 +1773,8 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         c->button_status[i] = BUTTON_STATE_NORMAL;
     }
 
-    if (!XGetWMColormapWindows (display_info->dpy, c->window, &c->cmap_windows, &c->ncmap))
-    {
-        c->ncmap = 0;
-    }
+    c->cmap_windows = cmap_windows;
+    c->ncmap = ncmap;
 
     c->fullscreen_monitors[0] = 0;
     c->fullscreen_monitors[1] = 0;
@@ -1726,15 +1782,14 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     c->fullscreen_monitors[3] = 0;
 
     /* Opacity for compositing manager */
-    c->opacity = NET_WM_OPAQUE;
-    getOpacity (display_info, c->window, &c->opacity);
+    c->opacity = opacity;
     c->opacity_applied = c->opacity;
     c->opacity_flags = 0;
 
     /* Keep count of blinking iterations */
     c->blink_iterations = 0;
 
-    if (getOpacityLock (display_info, c->window))
+    if (opacity_locked)
     {
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_OPACITY_LOCKED);
     }
@@ -1750,10 +1805,8 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     /* Ping timeout  */
     c->ping_time = 0;
 
-    c->class.res_name = NULL;
-    c->class.res_class = NULL;
-    XGetClassHint (display_info->dpy, w, &c->class);
-    c->wmhints = XGetWMHints (display_info->dpy, c->window);
+    c->class = class;
+    c->wmhints = wmhints;
     c->group_leader = None;
     if (c->wmhints)
     {
@@ -1762,7 +1815,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
             c->group_leader = c->wmhints->window_group;
         }
     }
-    c->client_leader = getClientLeader (display_info, c->window);
+    c->client_leader = client_leader;
 
     TRACE ("\"%s\" (0x%lx) initial map_state = %s",
                 c->name, c->window,
@@ -1773,11 +1826,6 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
                 (attr.map_state == IsUnviewable) ?
                 "IsUnviewable" :
                 "(unknown)");
-    if (attr.map_state != IsUnmapped)
-    {
-        /* Reparent will send us unmap/map events */
-        FLAG_SET (c->xfwm_flags, XFWM_FLAG_MAP_PENDING);
-    }
     c->ignore_unmap = 0;
     c->type = UNSET;
     c->type_atom = None;
@@ -1796,7 +1844,6 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     clientGetUserTime (c);
 
     /*client PID */
-    getHint (display_info, c->window, NET_WM_PID, (long *) &pid);
     c->pid = (GPid) pid;
     TRACE ("client \"%s\" (0x%lx) PID = %i", c->name, c->window, c->pid);
 
@@ -1852,8 +1899,37 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
      */
     clientApplyInitialState (c);
 
+    myDisplayGrabServer (display_info);
+
+    /*
+     * The window may have been destroyed before we got the grab, that
+     * is the only round trip made with the server grabbed.
+     */
+    if (!XGetWindowAttributes (display_info->dpy, w, &attr))
+    {
+        DBG ("Window (0x%lx) vanished before it could be framed", w);
+        myDisplayUngrabServer (display_info);
+        clientRemoveUserTimeWin (c);
+        sessionUnmatchWin (c);
+        clientFree (c);
+        return NULL;
+    }
+
+    XChangeSaveSet(display_info->dpy, c->window, SetModeInsert);
+
+    if (attr.map_state != IsUnmapped)
+    {
+        /* Reparent will send us unmap/map events */
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_MAP_PENDING);
+    }
+
     valuemask = CWEventMask|CWBitGravity|CWWinGravity;
     attributes.event_mask = (FRAME_EVENT_MASK | POINTER_EVENT_MASK);
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+    {
+        /* Button prelight is tracked on the frame itself */
+        attributes.event_mask |= LeaveWindowMask;
+    }
     attributes.win_gravity = StaticGravity;
     attributes.bit_gravity = StaticGravity;
 
@@ -1928,8 +2004,14 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         xfwmPixmapInit (screen_info, &c->appmenu[i]);
     }
 
+    /*
+       With a single window frame, the whole decoration is drawn in the
+       frame window and the pointer is tracked there, no child needed.
+     */
     for (i = 0; i < SIDE_COUNT; i++)
     {
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+            break;
         if (i == SIDE_TOP)
             continue;  /* Keep SIDE_TOP for later */
 
@@ -1938,27 +2020,30 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
             myDisplayGetCursorResize(screen_info->display_info, CORNER_COUNT + i));
     }
 
-    for (i = 0; i < CORNER_COUNT; i++)
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
     {
-        xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
-            &c->corners[i], NoEventMask,
-            myDisplayGetCursorResize(screen_info->display_info, i));
-    }
-
-    xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
-        &c->title, NoEventMask, None);
+        for (i = 0; i < CORNER_COUNT; i++)
+        {
+            xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
+                &c->corners[i], NoEventMask,
+                myDisplayGetCursorResize(screen_info->display_info, i));
+        }
 
-    /*create the top side window AFTER the title window since they overlap
-       and the top side window should be on top */
+        xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
+            &c->title, NoEventMask, None);
 
-    xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
-        &c->sides[SIDE_TOP], NoEventMask,
-        myDisplayGetCursorResize(screen_info->display_info, CORNER_COUNT + SIDE_TOP));
+        /*create the top side window AFTER the title window since they overlap
+           and the top side window should be on top */
 
-    for (i = 0; i < BUTTON_COUNT; i++)
-    {
         xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
-            &c->buttons[i], BUTTON_EVENT_MASK, None);
+            &c->sides[SIDE_TOP], NoEventMask,
+            myDisplayGetCursorResize(screen_info->display_info, CORNER_COUNT + SIDE_TOP));
+
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
+                &c->buttons[i], BUTTON_EVENT_MASK, None);
+        }
     }
     clientUpdateIconPix (c);
 
@@ -2011,6 +2096,8 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     c->xsync_counter = None;
     c->xsync_alarm = None;
     c->xsync_timeout_id = 0;
+    c->xsync_request_time = 0;
+    c->xsync_frame_time = 0;
     if (display_info->have_xsync)
     {
         clientGetXSyncCounter (c);
@@ -2142,7 +2229,7 @@ clientFrameAll (ScreenInfo *screen_info)
                     EnterWindowMask,
                     FALSE);
 
-    XSync (display_info->dpy, FALSE);
+    myDisplaySync (display_info, FALSE);
     myDisplayGrabServer (display_info);
     XQueryTree (display_info->dpy, screen_info->xroot, &w1, &w2, &wins, &count);
     for (i = 0; i < count; i++)
@@ -2168,7 +2255,7 @@ clientFrameAll (ScreenInfo *screen_info)
     clientFocusTop (screen_info, WIN_LAYER_FULLSCREEN, myDisplayGetCurrentTime (display_info));
     xfwmWindowDelete (&shield);
     myDisplayUngrabServer (display_info);
-    XSync (display_info->dpy, FALSE);
+    myDisplaySync (display_info, FALSE);
 }
 
 void
@@ -2183,7 +2270,7 @@ clientUnframeAll (ScreenInfo *screen_info)
 
     display_info = screen_info->display_info;
     clientSetFocus (screen_info, NULL, myDisplayGetCurrentTime (display_info), FOCUS_IGNORE_MODAL);
-    XSync (display_info->dpy, FALSE);
+    myDisplaySync (display_info, FALSE);
     myDisplayGrabServer (display_info);
     XQueryTree (display_info->dpy, screen_info->xroot, &w1, &w2, &wins, &count);
     for (i = 0; i < count; i++)
@@ -2195,7 +2282,7 @@ clientUnframeAll (ScreenInfo *screen_info)
         }
     }
     myDisplayUngrabServer (display_info);
-    XSync(display_info->dpy, FALSE);
+    myDisplaySync (display_info, FALSE);
     if (wins)
     {
         XFree (wins);
@@ -2355,6 +2442,11 @@ clientShowSingle (Client *c, gboolean deiconify)
     {
         TRACE ("showing client \"%s\" (0x%lx)", c->name, c->window);
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_VISIBLE);
+        frameIndexUpdate (c);
+        if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+        {
+            strutsInvalidate (screen_info);
+        }
         myDisplayErrorTrapPush (display_info);
         XMapWindow (display_info->dpy, c->frame);
         if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
@@ -2418,6 +2510,11 @@ clientWithdrawSingle (Client *c, GList *exclude_list, gboolean iconify)
     if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE))
     {
         FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_VISIBLE);
+        frameIndexRemove (c);
+        if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+        {
+            strutsInvalidate (screen_info);
+        }
         c->ignore_unmap++;
         /* Adjust to urgency state as the window is not visible */
         clientUpdateUrgency (c);
@@ -2567,7 +2664,7 @@ clientToggleShowDesktop (ScreenInfo *screen_info)
     }
     else
     {
-        for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+        for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
         {
             Client *c = (Client *) list->data;
             if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_WAS_SHOWN))
@@ -3780,8 +3877,8 @@ clientButtonPressEventFilter (XfwmEvent *event, gpointer data)
     Client *c;
     ButtonPressData *passdata;
     eventFilterStatus status;
-    int b;
-    gboolean pressed;
+    int b, detail;
+    gboolean pressed, inside;
 
     passdata = (ButtonPressData *) data;
     c = passdata->c;
@@ -3822,6 +3919,25 @@ clientButtonPressEventFilter (XfwmEvent *event, gpointer data)
                 frameQueueDraw (c, FALSE);
             }
             break;
+        case XFWM_EVENT_MOTION:
+            /* No button window to cross with a single window frame */
+            if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+            {
+                break;
+            }
+            inside = ((frameHitTest (c, event->motion.x, event->motion.y, &detail) == FRAME_HIT_BUTTON)
+                      && (detail == b));
+            if (inside && (c->button_status[b] != BUTTON_STATE_PRESSED))
+            {
+                c->button_status[b] = BUTTON_STATE_PRESSED;
+                frameQueueDraw (c, FALSE);
+            }
+            else if (!inside && (c->button_status[b] == BUTTON_STATE_PRESSED))
+            {
+                c->button_status[b] = BUTTON_STATE_NORMAL;
+                frameQueueDraw (c, FALSE);
+            }
+            break;
         case XFWM_EVENT_XEVENT:
             if ((event->meta.xevent->type == UnmapNotify) && (event->meta.window == c->window))
             {
@@ -3853,16 +3969,30 @@ clientButtonPress (Client *c, Window w, XfwmEventButton *event)
     DisplayInfo *display_info;
     ButtonPressData passdata;
     gint b;
+    long mask;
     gboolean g1;
 
     g_return_if_fail (c != NULL);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    for (b = 0; b < BUTTON_COUNT; b++)
+    mask = ButtonReleaseMask | EnterWindowMask | LeaveWindowMask;
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
     {
-        if (MYWINDOW_XWINDOW (c->buttons[b]) == w)
+        /* The button is found from the position in the frame */
+        if (frameHitTest (c, event->x, event->y, &b) != FRAME_HIT_BUTTON)
         {
-            break;
+            return;
+        }
+        mask |= PointerMotionMask;
+    }
+    else
+    {
+        for (b = 0; b < BUTTON_COUNT; b++)
+        {
+            if (MYWINDOW_XWINDOW (c->buttons[b]) == w)
+            {
+                break;
+            }
         }
     }
 
@@ -3871,8 +4001,7 @@ clientButtonPress (Client *c, Window w, XfwmEventButton *event)
 
     myDisplayErrorTrapPush (display_info);
     g1 = xfwm_device_grab (display_info->devices, &display_info->devices->pointer,
-                           display_info->dpy, w, FALSE,
-                           ButtonReleaseMask | EnterWindowMask | LeaveWindowMask,
+                           display_info->dpy, w, FALSE, mask,
                            GrabModeAsync, screen_info->xroot, None,
                            myDisplayGetCurrentTime (display_info));
     myDisplayErrorTrapPopIgnored (display_info);
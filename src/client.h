@@ -104,6 +104,10 @@
 #define CLIENT_XSYNC_TIMEOUT            500  /* ms */
 #endif
 
+#ifndef CLIENT_XSYNC_MAX_TIMEOUT
+#define CLIENT_XSYNC_MAX_TIMEOUT        2000 /* ms */
+#endif
+
 #ifndef CLIENT_BLINK_TIMEOUT
 #define CLIENT_BLINK_TIMEOUT            500  /* ms */
 #endif
@@ -143,6 +147,10 @@
 #define XFWM_FLAG_MOVING_RESIZING       (1L<<21)
 #define XFWM_FLAG_NEEDS_REDRAW          (1L<<22)
 #define XFWM_FLAG_OPACITY_LOCKED        (1L<<23)
+#define XFWM_FLAG_NEEDS_RESHAPE         (1L<<24)
+#define XFWM_FLAG_SINGLE_WINDOW         (1L<<25)
+#define XFWM_FLAG_DRAW_BATCHED          (1L<<26)
+#define XFWM_FLAG_INDEXED               (1L<<27)
 
 #define CLIENT_FLAG_HAS_STRUT           (1L<<0)
 #define CLIENT_FLAG_HAS_STRUT_PARTIAL   (1L<<1)
@@ -171,6 +179,8 @@
 #define CLIENT_FLAG_XSYNC_ENABLED       (1L<<23)
 #define CLIENT_FLAG_XSYNC_EXT_COUNTER   (1L<<24)
 #define CLIENT_FLAG_RESTORE_SIZE_POS    (1L<<25)
+#define CLIENT_FLAG_XSYNC_CONFIGURE     (1L<<26)
+#define CLIENT_FLAG_XSYNC_FRAME_PENDING (1L<<27)
 
 #define WM_FLAG_DELETE                  (1L<<0)
 #define WM_FLAG_INPUT                   (1L<<1)
@@ -339,6 +349,15 @@ struct _Client
     unsigned long xfwm_flags;
     gint fullscreen_monitors[4];
     gint frame_extents[SIDE_COUNT];
+    /* Side pixmaps shared with other frames */
+    FramePixmapEntry *frame_pixmaps[SIDE_COUNT];
+    /* Frame parts as last drawn */
+    FrameDrawState *frame_state;
+    /* Frame extents as known to the frame index */
+    GdkRectangle index_rect;
+    guint index_stamp;
+    /* Link of the client in screen_info->windows_stack */
+    GList *stack_link;
 
     /* Termination dialog */
     gint dialog_pid;
@@ -366,6 +385,9 @@ struct _Client
     XSyncCounter xsync_counter;
     XSyncValue xsync_value;
     XSyncValue next_xsync_value;
+    XSyncValue xsync_frame_value;
+    gint64 xsync_request_time;
+    gint64 xsync_frame_time;
     guint xsync_timeout_id;
 #endif /* HAVE_XSYNC */
 };
@@ -54,6 +54,7 @@
 #include "frame.h"
 #include "hints.h"
 #include "compositor.h"
+#include "xsync.h"
 
 #ifdef HAVE_COMPOSITOR
 #include "common/xfwm-common.h"
@@ -97,11 +98,19 @@
 #define WIN_IS_VISIBLE(cw)              (WIN_IS_VIEWABLE(cw) && WIN_HAS_DAMAGE(cw))
 #define WIN_IS_DAMAGED(cw)              (cw->damaged)
 #define WIN_IS_REDIRECTED(cw)           (cw->redirected)
+#define WIN_IS_FROZEN(cw)               (WIN_HAS_CLIENT(cw) && \
+                                         FLAG_TEST (cw->c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING) && \
+                                         FLAG_TEST (cw->c->flags, CLIENT_FLAG_XSYNC_WAITING))
 
 #ifndef TIMEOUT_REPAINT_PRIORITY
 #define TIMEOUT_REPAINT_PRIORITY   1
 #endif /* TIMEOUT_REPAINT_PRIORITY */
 
+/* Width of the box move/resize outline */
+#ifndef COMPOSITOR_OUTLINE_WIDTH
+#define COMPOSITOR_OUTLINE_WIDTH   2
+#endif /* COMPOSITOR_OUTLINE_WIDTH */
+
 #ifndef MONITOR_ROOT_PIXMAP
 #define MONITOR_ROOT_PIXMAP   1
 #endif /* MONITOR_ROOT_PIXMAP */
@@ -128,6 +137,17 @@ struct _CWindow
     gboolean native_opacity;
     gboolean opacity_locked;
 
+    /* Held back while the client draws at its new size */
+    gboolean frozen_damage;
+    gboolean frozen_resize;
+    XRectangle frozen_geometry;
+    gint frozen_border;
+
+    /* Painted at the translated position during a lazy move */
+    gboolean translated;
+    gint translate_x, translate_y;
+    gint real_x, real_y;
+
     Damage damage;
 #if HAVE_NAME_WINDOW_PIXMAP
     Pixmap name_window_pixmap;
@@ -1466,7 +1486,7 @@ fence_sync (ScreenInfo *screen_info, gushort buffer)
 
     fence_reset (screen_info, buffer);
 #else
-    XSync (myScreenGetXDisplay (screen_info), FALSE);
+    myDisplaySync (screen_info->display_info, FALSE);
     glXWaitX ();
 #endif /* HAVE_XSYNC */
 }
@@ -1979,6 +1999,67 @@ paint_cursor (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffe
                       screen_info->cursorLocation.height);
 }
 
+static void
+get_outline_rects (XRectangle *outline, XRectangle *rects)
+{
+    gint border;
+
+    border = MIN (COMPOSITOR_OUTLINE_WIDTH, MIN (outline->width, outline->height) / 2);
+
+    rects[0].x = outline->x;
+    rects[0].y = outline->y;
+    rects[0].width = outline->width;
+    rects[0].height = border;
+
+    rects[1].x = outline->x;
+    rects[1].y = outline->y + outline->height - border;
+    rects[1].width = outline->width;
+    rects[1].height = border;
+
+    rects[2].x = outline->x;
+    rects[2].y = outline->y + border;
+    rects[2].width = border;
+    rects[2].height = MAX (outline->height - 2 * border, 0);
+
+    rects[3].x = outline->x + outline->width - border;
+    rects[3].y = outline->y + border;
+    rects[3].width = border;
+    rects[3].height = MAX (outline->height - 2 * border, 0);
+}
+
+static void
+paint_outline (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffer)
+{
+    Display *dpy;
+    XRenderColor color;
+    XRectangle rects[4];
+
+    if (!screen_info->outlineVisible)
+    {
+        return;
+    }
+
+    dpy = myScreenGetXDisplay (screen_info);
+    XFixesSetPictureClipRegion (dpy, paint_buffer, 0, 0, region);
+
+    /* Translucent fill, colors are premultiplied */
+    color.alpha = (unsigned short) (screen_info->outlineColor.alpha * 0xffff);
+    color.red = (unsigned short) (screen_info->outlineColor.red * color.alpha);
+    color.green = (unsigned short) (screen_info->outlineColor.green * color.alpha);
+    color.blue = (unsigned short) (screen_info->outlineColor.blue * color.alpha);
+    XRenderFillRectangle (dpy, PictOpOver, paint_buffer, &color,
+                          screen_info->outlineLocation.x, screen_info->outlineLocation.y,
+                          screen_info->outlineLocation.width, screen_info->outlineLocation.height);
+
+    /* Opaque border */
+    color.alpha = 0xffff;
+    color.red = (unsigned short) (screen_info->outlineColor.red * 0xffff);
+    color.green = (unsigned short) (screen_info->outlineColor.green * 0xffff);
+    color.blue = (unsigned short) (screen_info->outlineColor.blue * 0xffff);
+    get_outline_rects (&screen_info->outlineLocation, rects);
+    XRenderFillRectangles (dpy, PictOpOver, paint_buffer, &color, rects, 4);
+}
+
 static void
 paint_win (CWindow *cw, XserverRegion region, Picture paint_buffer, gboolean solid_part)
 {
@@ -2310,6 +2391,8 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
         }
     }
 
+    paint_outline (screen_info, region, paint_buffer);
+
     TRACE ("copying data back to screen");
 #ifdef HAVE_EPOXY
     if (screen_info->use_glx)
@@ -2392,6 +2475,25 @@ remove_timeouts (ScreenInfo *screen_info)
     }
 }
 
+static void
+frame_drawn (ScreenInfo *screen_info)
+{
+#ifdef HAVE_XSYNC
+    GList *list;
+    gint64 now;
+
+    now = g_get_monotonic_time ();
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        CWindow *cw = (CWindow *) list->data;
+        if (WIN_HAS_CLIENT(cw) && FLAG_TEST (cw->c->flags, CLIENT_FLAG_XSYNC_FRAME_PENDING))
+        {
+            clientXSyncFrameDrawn (cw->c, now);
+        }
+    }
+#endif /* HAVE_XSYNC */
+}
+
 static gboolean
 repair_screen (ScreenInfo *screen_info)
 {
@@ -2401,13 +2503,16 @@ repair_screen (ScreenInfo *screen_info)
     g_return_val_if_fail (screen_info, FALSE);
     TRACE ("entering");
 
+    /* Nothing gets painted, but clients still wait for their frames to be */
     if (!screen_info->compositor_active)
     {
+        frame_drawn (screen_info);
         return FALSE;
     }
 
     if (screen_info->width == 0 || screen_info->height == 0)
     {
+        frame_drawn (screen_info);
         return FALSE;
     }
 
@@ -2439,7 +2544,9 @@ repair_screen (ScreenInfo *screen_info)
 #endif /* HAVE_PRESENT_EXTENSION */
 
         remove_timeouts (screen_info);
+        myDisplayPushRequestTag (display_info, "paint_all");
         paint_all (screen_info, damage, screen_info->current_buffer);
+        myDisplayPopRequestTag (display_info);
 
 #ifdef HAVE_PRESENT_EXTENSION
         if (screen_info->use_present)
@@ -2457,6 +2564,7 @@ repair_screen (ScreenInfo *screen_info)
         }
 #endif /* HAVE_PRESENT_EXTENSION */
     }
+    frame_drawn (screen_info);
 
     return FALSE;
 }
@@ -2971,6 +3079,9 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
     new->screen_info = screen_info;
     new->id = id;
     new->damaged = FALSE;
+    new->frozen_damage = FALSE;
+    new->frozen_resize = FALSE;
+    new->translated = FALSE;
     new->redirected = TRUE;
     new->fulloverlay = FALSE;
     new->shaped = is_shaped (display_info, id);
@@ -3166,6 +3277,34 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
     }
 }
 
+static void
+configure_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
+{
+    if (cw->translated)
+    {
+        /* Keep the last known server position for when the move ends */
+        cw->real_x = x;
+        cw->real_y = y;
+        x = cw->translate_x;
+        y = cw->translate_y;
+    }
+
+    if (WIN_IS_FROZEN(cw))
+    {
+        TRACE ("window 0x%lx frozen, resize deferred", cw->id);
+        cw->frozen_resize = TRUE;
+        cw->frozen_geometry.x = x;
+        cw->frozen_geometry.y = y;
+        cw->frozen_geometry.width = width;
+        cw->frozen_geometry.height = height;
+        cw->frozen_border = bw;
+        return;
+    }
+
+    cw->frozen_resize = FALSE;
+    resize_win (cw, x, y, width, height, bw);
+}
+
 static void
 reshape_win (CWindow *cw)
 {
@@ -3410,7 +3549,15 @@ compositorHandleDamage (DisplayInfo *display_info, XDamageNotifyEvent *ev)
     if ((cw) && WIN_IS_REDIRECTED(cw))
     {
         screen_info = cw->screen_info;
-        repair_win (cw, &ev->area);
+        if (WIN_IS_FROZEN(cw))
+        {
+            /* Left in the damage object until compositorThawWindow() */
+            cw->frozen_damage = TRUE;
+        }
+        else
+        {
+            repair_win (cw, &ev->area);
+        }
         screen_info->damages_pending = ev->more;
     }
 }
@@ -3564,7 +3711,7 @@ compositorHandleConfigureNotify (DisplayInfo *display_info, XConfigureEvent *ev)
     if (cw)
     {
         restack_win (cw, ev->above);
-        resize_win (cw, ev->x, ev->y, ev->width, ev->height, ev->border_width);
+        configure_win (cw, ev->x, ev->y, ev->width, ev->height, ev->border_width);
     }
 }
 
@@ -4090,8 +4237,205 @@ compositorResizeWindow (DisplayInfo *display_info, Window id, int x, int y, int
     cw = find_cwindow_in_display (display_info, id);
     if (cw)
     {
-        resize_win (cw, x, y, width, height, 0);
+        configure_win (cw, x, y, width, height, 0);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorThawWindow (DisplayInfo *display_info, Window id)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("window 0x%lx", id);
+
+    if ((id == None) || !compositorIsUsable (display_info))
+    {
+        return;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (!cw)
+    {
+        return;
+    }
+
+    if (cw->frozen_resize)
+    {
+        cw->frozen_resize = FALSE;
+        resize_win (cw, cw->frozen_geometry.x, cw->frozen_geometry.y,
+                    cw->frozen_geometry.width, cw->frozen_geometry.height,
+                    cw->frozen_border);
+    }
+
+    if (cw->frozen_damage)
+    {
+        cw->frozen_damage = FALSE;
+        if (WIN_IS_REDIRECTED(cw))
+        {
+            repair_win (cw, NULL);
+        }
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
+/*
+ * Paint the window at the given position without moving it on the server,
+ * ConfigureNotify events received meanwhile do not change where the window
+ * is painted. Returns FALSE if the window is not composited.
+ */
+gboolean
+compositorTranslateWindow (DisplayInfo *display_info, Window id, int x, int y)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    TRACE ("window 0x%lx, (%i,%i)", id, x, y);
+
+    if ((id == None) || !compositorIsUsable (display_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (!(cw) || !(cw->screen_info->compositor_active) || !WIN_IS_REDIRECTED(cw))
+    {
+        return FALSE;
+    }
+
+    if (!cw->translated)
+    {
+        cw->translated = TRUE;
+        cw->real_x = cw->attr.x;
+        cw->real_y = cw->attr.y;
+    }
+    cw->translate_x = x;
+    cw->translate_y = y;
+
+    if (WIN_IS_FROZEN(cw))
+    {
+        cw->frozen_geometry.x = x;
+        cw->frozen_geometry.y = y;
+    }
+    else if ((cw->attr.x != x) || (cw->attr.y != y))
+    {
+        resize_win (cw, x, y, cw->attr.width, cw->attr.height, cw->attr.border_width);
+    }
+
+    return TRUE;
+#endif /* HAVE_COMPOSITOR */
+    return FALSE;
+}
+
+void
+compositorEndTranslateWindow (DisplayInfo *display_info, Window id)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("window 0x%lx", id);
+
+    if ((id == None) || !compositorIsUsable (display_info))
+    {
+        return;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (!(cw) || !(cw->translated))
+    {
+        return;
+    }
+
+    cw->translated = FALSE;
+    if (WIN_IS_FROZEN(cw))
+    {
+        cw->frozen_geometry.x = cw->real_x;
+        cw->frozen_geometry.y = cw->real_y;
+    }
+    else if ((cw->attr.x != cw->real_x) || (cw->attr.y != cw->real_y))
+    {
+        resize_win (cw, cw->real_x, cw->real_y, cw->attr.width, cw->attr.height, cw->attr.border_width);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
+/*
+ * Returns TRUE if the compositor takes care of sending the frame drawn
+ * message once it has painted the window.
+ */
+gboolean
+compositorQueueFrameDrawn (DisplayInfo *display_info, Window id)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    TRACE ("window 0x%lx", id);
+
+    if ((id == None) || !compositorIsUsable (display_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if ((cw) && (cw->screen_info->compositor_active) && WIN_IS_REDIRECTED(cw))
+    {
+        add_repair (cw->screen_info);
+        return TRUE;
+    }
+#endif /* HAVE_COMPOSITOR */
+    return FALSE;
+}
+
+/*
+ * Draw the box move/resize outline as part of the composited screen,
+ * instead of using a window. Returns FALSE if the compositor is not
+ * active, pass a NULL location to remove the outline.
+ */
+gboolean
+compositorSetOutline (ScreenInfo *screen_info, XRectangle *location, GdkRGBA *color)
+{
+#ifdef HAVE_COMPOSITOR
+    XRectangle damage[2];
+    gint n;
+
+    g_return_val_if_fail (screen_info != NULL, FALSE);
+    TRACE ("entering");
+
+    if (!compositorIsActive (screen_info))
+    {
+        return FALSE;
+    }
+
+    n = 0;
+    if (screen_info->outlineVisible)
+    {
+        damage[n++] = screen_info->outlineLocation;
+    }
+
+    screen_info->outlineVisible = (location != NULL);
+    if (location)
+    {
+        screen_info->outlineLocation = *location;
+        damage[n++] = *location;
+    }
+    if (color)
+    {
+        screen_info->outlineColor = *color;
+    }
+
+    if (n > 0)
+    {
+        expose_area (screen_info, damage, n);
     }
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR */
+    return FALSE;
 #endif /* HAVE_COMPOSITOR */
 }
 
@@ -4132,6 +4476,8 @@ void
 compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
 {
 #ifdef HAVE_COMPOSITOR
+    guint32 trace;
+
     g_return_if_fail (display_info != NULL);
     g_return_if_fail (ev != NULL);
     TRACE ("event type %i", ev->type);
@@ -4140,7 +4486,11 @@ compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
     {
         return;
     }
-    else if (ev->type == CreateNotify)
+
+    myDisplayPushRequestTag (display_info, G_STRFUNC);
+    trace = eventTraceBegin (display_info->event_trace, EVENT_TRACE_SOURCE_COMPOSITOR,
+                             ev->type, ev->xany.window, display_info->current_time);
+    if (ev->type == CreateNotify)
     {
         compositorHandleCreateNotify (display_info, (XCreateWindowEvent *) ev);
     }
@@ -4194,6 +4544,8 @@ compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
         compositorHandleGenericEvent (display_info, (XGenericEvent *) ev);
     }
 #endif /* HAVE_PRESENT_EXTENSION */
+    eventTraceEnd (display_info->event_trace, trace);
+    myDisplayPopRequestTag (display_info);
 
 #endif /* HAVE_COMPOSITOR */
 }
@@ -4491,6 +4843,7 @@ compositorManageScreen (ScreenInfo *screen_info)
     screen_info->zoomed = FALSE;
     screen_info->zoom_timeout_id = 0;
     screen_info->damages_pending = FALSE;
+    screen_info->outlineVisible = FALSE;
     screen_info->current_buffer = 0;
     memset(screen_info->transform.matrix, 0, 9);
     screen_info->transform.matrix[0][0] = 1 << 16;
@@ -4597,6 +4950,8 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
     screen_info->compositor_active = FALSE;
 
     remove_timeouts (screen_info);
+    /* The queued frames will not be painted anymore, answer them now */
+    frame_drawn (screen_info);
 
     i = 0;
     for (list = screen_info->cwindows; list; list = g_list_next (list))
@@ -52,6 +52,19 @@ void                     compositorResizeWindow                 (DisplayInfo *,
                                                                  int,
                                                                  int,
                                                                  int);
+void                     compositorThawWindow                   (DisplayInfo *,
+                                                                 Window);
+gboolean                 compositorTranslateWindow              (DisplayInfo *,
+                                                                 Window,
+                                                                 int,
+                                                                 int);
+void                     compositorEndTranslateWindow           (DisplayInfo *,
+                                                                 Window);
+gboolean                 compositorQueueFrameDrawn              (DisplayInfo *,
+                                                                 Window);
+gboolean                 compositorSetOutline                   (ScreenInfo *,
+                                                                 XRectangle *,
+                                                                 GdkRGBA *);
 Pixmap                   compositorGetWindowPixmapAtSize        (ScreenInfo *,
                                                                  Window,
                                                                  guint *,
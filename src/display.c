@@ -25,6 +25,7 @@
 #endif
 
 #include <stdio.h>
+#include <unistd.h>
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -44,6 +45,7 @@
 #include "screen.h"
 #include "client.h"
 #include "compositor.h"
+#include "frame.h"
 
 #ifndef MAX_HOSTNAME_LENGTH
 #define MAX_HOSTNAME_LENGTH 512
@@ -59,6 +61,8 @@
 
 static DisplayInfo *default_display;
 
+static void              myDisplayAccountRequests               (DisplayInfo *);
+
 static int
 handleXError (Display * dpy, XErrorEvent * err)
 {
@@ -73,6 +77,26 @@ handleXError (Display * dpy, XErrorEvent * err)
     return 0;
 }
 
+static int
+myDisplayAfterFunction (Display *dpy)
+{
+    DisplayInfo *display;
+
+    display = default_display;
+    if (!display || display->dpy != dpy)
+    {
+        return 0;
+    }
+
+    myDisplayAccountRequests (display);
+    if (display->xrequest_after_function)
+    {
+        return (*display->xrequest_after_function) (dpy);
+    }
+
+    return 0;
+}
+
 static gboolean
 myDisplayInitAtoms (DisplayInfo *display_info)
 {
@@ -119,6 +143,8 @@ myDisplayInitAtoms (DisplayInfo *display_info)
         "_NET_WM_BYPASS_COMPOSITOR",
         "_NET_WM_CONTEXT_HELP",
         "_NET_WM_DESKTOP",
+        "_NET_WM_FRAME_DRAWN",
+        "_NET_WM_FRAME_TIMINGS",
         "_NET_WM_FULLSCREEN_MONITORS",
         "_NET_WM_ICON",
         "_NET_WM_ICON_GEOMETRY",
@@ -223,6 +249,7 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->session = NULL;
     display->quit = FALSE;
     display->reload = FALSE;
+    display->dump_stats = FALSE;
 
     XSetErrorHandler (handleXError);
 
@@ -329,9 +356,19 @@ myDisplayInit (GdkDisplay *gdisplay)
     myDisplayCreateTimestampWin (display);
 
     display->xfilter = NULL;
+    display->event_trace = eventTraceNew ();
     display->screens = NULL;
     display->clients = NULL;
     display->xgrabcount = 0;
+    display->xgrab_time = 0;
+    display->xgrab_site = NULL;
+    display->xgrab_stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    display->xrequest_stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    display->xrequest_tags = NULL;
+    display->xrequest_serial = NextRequest (display->dpy);
+    display->xrequest_processed = LastKnownRequestProcessed (display->dpy);
+    display->xrequest_after_function =
+        XSetAfterFunction (display->dpy, myDisplayAfterFunction);
     display->double_click_time = 250;
     display->double_click_distance = 5;
     display->nb_screens = 0;
@@ -374,6 +411,19 @@ myDisplayClose (DisplayInfo *display)
     g_slist_free (display->clients);
     display->clients = NULL;
 
+    g_hash_table_destroy (display->xgrab_stats);
+    display->xgrab_stats = NULL;
+
+    eventTraceFree (display->event_trace);
+    display->event_trace = NULL;
+
+    XSetAfterFunction (display->dpy, display->xrequest_after_function);
+    display->xrequest_after_function = NULL;
+    g_slist_free (display->xrequest_tags);
+    display->xrequest_tags = NULL;
+    g_hash_table_destroy (display->xrequest_stats);
+    display->xrequest_stats = NULL;
+
     g_slist_free (display->screens);
     display->screens = NULL;
 
@@ -493,16 +543,45 @@ myDisplayGetCursorResize (DisplayInfo *display, guint list)
 }
 
 
+static void
+myDisplayRecordGrab (DisplayInfo *display, const gchar *site, gint64 duration)
+{
+    XGrabStats *stats;
+    guint bucket;
+
+    stats = g_hash_table_lookup (display->xgrab_stats, site);
+    if (!stats)
+    {
+        stats = g_new0 (XGrabStats, 1);
+        stats->site = site;
+        g_hash_table_insert (display->xgrab_stats, (gpointer) site, stats);
+    }
+
+    stats->count++;
+    stats->total_time += duration;
+    stats->max_time = MAX (stats->max_time, duration);
+
+    bucket = g_bit_storage ((gulong) duration);
+    stats->histogram[MIN (bucket, XGRAB_HISTOGRAM_SIZE - 1)]++;
+
+    if (duration > XGRAB_WARN_THRESHOLD)
+    {
+        g_warning ("Server grabbed for %.1f ms by %s", duration / 1000.0, site);
+    }
+}
+
 void
-myDisplayGrabServer (DisplayInfo *display)
+myDisplayGrabServerFull (DisplayInfo *display, const gchar *site)
 {
     g_return_if_fail (display);
 
-    DBG ("entering myDisplayGrabServer");
+    DBG ("entering myDisplayGrabServer from %s", site);
     if (display->xgrabcount == 0)
     {
         DBG ("grabbing server");
         XGrabServer (display->dpy);
+        display->xgrab_time = g_get_monotonic_time ();
+        display->xgrab_site = site;
     }
     display->xgrabcount++;
     DBG ("grabs : %i", display->xgrabcount);
@@ -524,10 +603,247 @@ myDisplayUngrabServer (DisplayInfo *display)
         DBG ("ungrabbing server");
         XUngrabServer (display->dpy);
         XFlush (display->dpy);
+        if (display->xgrab_site)
+        {
+            myDisplayRecordGrab (display, display->xgrab_site,
+                                 g_get_monotonic_time () - display->xgrab_time);
+            display->xgrab_site = NULL;
+        }
     }
     DBG ("grabs : %i", display->xgrabcount);
 }
 
+static XRequestStats *
+myDisplayGetRequestStats (DisplayInfo *display, const gchar *tag)
+{
+    XRequestStats *stats;
+
+    stats = g_hash_table_lookup (display->xrequest_stats, tag);
+    if (!stats)
+    {
+        stats = g_new0 (XRequestStats, 1);
+        stats->tag = tag;
+        g_hash_table_insert (display->xrequest_stats, (gpointer) tag, stats);
+    }
+
+    return stats;
+}
+
+static XRequestStats *
+myDisplayGetCurrentRequestStats (DisplayInfo *display)
+{
+    if (display->xrequest_tags)
+    {
+        return (XRequestStats *) display->xrequest_tags->data;
+    }
+
+    return myDisplayGetRequestStats (display, XREQUEST_UNTAGGED);
+}
+
+/*
+ * Called after each Xlib request. Xlib does not tell us whether the
+ * call waited for a reply, but when it did the last request processed
+ * by the server has caught up with the last request sent.
+ */
+static void
+myDisplayAccountRequests (DisplayInfo *display)
+{
+    XRequestStats *stats;
+    unsigned long serial, processed;
+
+    if (!display->xrequest_stats)
+    {
+        return;
+    }
+
+    serial = NextRequest (display->dpy);
+    processed = LastKnownRequestProcessed (display->dpy);
+    if ((serial == display->xrequest_serial) && (processed == display->xrequest_processed))
+    {
+        return;
+    }
+
+    stats = myDisplayGetCurrentRequestStats (display);
+    stats->requests += serial - display->xrequest_serial;
+    if ((processed != display->xrequest_processed) && (processed + 1 == serial))
+    {
+        stats->replies++;
+    }
+
+    display->xrequest_serial = serial;
+    display->xrequest_processed = processed;
+}
+
+void
+myDisplayPushRequestTag (DisplayInfo *display, const gchar *tag)
+{
+    XRequestStats *stats;
+
+    g_return_if_fail (display);
+    g_return_if_fail (tag);
+
+    myDisplayAccountRequests (display);
+    stats = myDisplayGetRequestStats (display, tag);
+    stats->calls++;
+    display->xrequest_tags = g_slist_prepend (display->xrequest_tags, stats);
+}
+
+void
+myDisplayPopRequestTag (DisplayInfo *display)
+{
+    g_return_if_fail (display);
+    g_return_if_fail (display->xrequest_tags);
+
+    myDisplayAccountRequests (display);
+    display->xrequest_tags = g_slist_delete_link (display->xrequest_tags,
+                                                  display->xrequest_tags);
+}
+
+void
+myDisplaySync (DisplayInfo *display, gboolean discard)
+{
+    g_return_if_fail (display);
+
+    XSync (display->dpy, discard);
+    myDisplayGetCurrentRequestStats (display)->syncs++;
+}
+
+static gint
+myDisplayCompareGrabStats (gconstpointer a, gconstpointer b)
+{
+    const XGrabStats *stats_a = a;
+    const XGrabStats *stats_b = b;
+
+    if (stats_a->total_time > stats_b->total_time)
+    {
+        return -1;
+    }
+    return (stats_a->total_time < stats_b->total_time);
+}
+
+static void
+myDisplayDumpGrabStats (DisplayInfo *display)
+{
+    GList *list, *l;
+    XGrabStats *stats;
+    guint i;
+
+    g_print ("Server grabs (usec):\n");
+    g_print ("%-32s %8s %12s %10s %10s\n", "site", "count", "total", "avg", "max");
+
+    list = g_list_sort (g_hash_table_get_values (display->xgrab_stats),
+                        myDisplayCompareGrabStats);
+    for (l = list; l; l = g_list_next (l))
+    {
+        stats = (XGrabStats *) l->data;
+        g_print ("%-32s %8u %12" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+                 stats->site, stats->count, stats->total_time,
+                 stats->total_time / MAX (stats->count, 1), stats->max_time);
+        for (i = 0; i < XGRAB_HISTOGRAM_SIZE; i++)
+        {
+            if (stats->histogram[i])
+            {
+                g_print ("    %s%8lu : %u\n", (i == XGRAB_HISTOGRAM_SIZE - 1) ? ">=" : " <",
+                         (i == XGRAB_HISTOGRAM_SIZE - 1) ? (1UL << (i - 1)) : (1UL << i),
+                         stats->histogram[i]);
+            }
+        }
+    }
+    g_list_free (list);
+}
+
+static gint
+myDisplayCompareRequestStats (gconstpointer a, gconstpointer b)
+{
+    const XRequestStats *stats_a = a;
+    const XRequestStats *stats_b = b;
+
+    if (stats_a->replies != stats_b->replies)
+    {
+        return (stats_a->replies > stats_b->replies) ? -1 : 1;
+    }
+    if (stats_a->requests != stats_b->requests)
+    {
+        return (stats_a->requests > stats_b->requests) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void
+myDisplayDumpRequestStats (DisplayInfo *display)
+{
+    GList *list, *l;
+    XRequestStats *stats;
+
+    g_print ("X requests per handler:\n");
+    g_print ("%-32s %8s %10s %10s %8s %10s %10s\n",
+             "handler", "calls", "requests", "replies", "syncs", "req/call", "rep/call");
+
+    myDisplayAccountRequests (display);
+    list = g_list_sort (g_hash_table_get_values (display->xrequest_stats),
+                        myDisplayCompareRequestStats);
+    for (l = list; l; l = g_list_next (l))
+    {
+        stats = (XRequestStats *) l->data;
+        g_print ("%-32s %8u %10lu %10lu %8lu %10.1f %10.1f\n",
+                 stats->tag, stats->calls, stats->requests, stats->replies, stats->syncs,
+                 (gdouble) stats->requests / MAX (stats->calls, 1),
+                 (gdouble) stats->replies / MAX (stats->calls, 1));
+    }
+    g_list_free (list);
+}
+
+static void
+myDisplayDumpScreenStats (DisplayInfo *display)
+{
+    ScreenInfo *screen_info;
+    GSList *list;
+
+    for (list = display->screens; list; list = g_slist_next (list))
+    {
+        screen_info = (ScreenInfo *) list->data;
+        frameDumpPixmapCacheStats (screen_info);
+        g_print ("Screen %i move/resize motion: %u received, %u applied (%.1f%%)\n",
+                 screen_info->screen, screen_info->motion_received, screen_info->motion_applied,
+                 100.0 * screen_info->motion_applied / MAX (screen_info->motion_received, 1));
+    }
+}
+
+static void
+myDisplayDumpEventTrace (DisplayInfo *display)
+{
+    const gchar *str;
+    gchar *filename;
+
+    str = g_getenv ("XFWM4_TRACE_FILE");
+    if (str)
+    {
+        filename = g_strdup (str);
+    }
+    else
+    {
+        gchar *basename;
+
+        basename = g_strdup_printf ("xfwm4-trace-%d.bin", (int) getpid ());
+        filename = g_build_filename (g_get_user_runtime_dir (), basename, NULL);
+        g_free (basename);
+    }
+
+    eventTraceDump (display->event_trace, filename);
+    g_free (filename);
+}
+
+void
+myDisplayDumpStats (DisplayInfo *display)
+{
+    g_return_if_fail (display);
+
+    myDisplayDumpGrabStats (display);
+    myDisplayDumpRequestStats (display);
+    myDisplayDumpScreenStats (display);
+    myDisplayDumpEventTrace (display);
+}
+
 void
 myDisplayAddClient (DisplayInfo *display, Client *c)
 {
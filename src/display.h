@@ -66,6 +66,7 @@
 #include <libxfce4ui/libxfce4ui.h>
 
 #include "event_filter.h"
+#include "event_trace.h"
 
 /*
  * The following macro is taken straight from metacity,
@@ -211,6 +212,8 @@ enum
     NET_WM_BYPASS_COMPOSITOR,
     NET_WM_CONTEXT_HELP,
     NET_WM_DESKTOP,
+    NET_WM_FRAME_DRAWN,
+    NET_WM_FRAME_TIMINGS,
     NET_WM_FULLSCREEN_MONITORS,
     NET_WM_ICON,
     NET_WM_ICON_GEOMETRY,
@@ -281,6 +284,41 @@ typedef struct _xfwmPixmap        xfwmPixmap;
 typedef struct _XfwmParams        XfwmParams;
 typedef struct _ScreenInfo        ScreenInfo;
 typedef struct _Settings          Settings;
+typedef struct _XGrabStats        XGrabStats;
+typedef struct _FramePixmapCache  FramePixmapCache;
+typedef struct _FramePixmapEntry  FramePixmapEntry;
+typedef struct _FrameDrawState    FrameDrawState;
+typedef struct _FrameIndex        FrameIndex;
+typedef struct _StrutsCache       StrutsCache;
+typedef struct _MonitorGrid       MonitorGrid;
+typedef struct _XRequestStats     XRequestStats;
+
+/* Server grab hold times are sorted in power of two buckets of usec */
+#define XGRAB_HISTOGRAM_SIZE    16
+#ifndef XGRAB_WARN_THRESHOLD
+#define XGRAB_WARN_THRESHOLD    20000
+#endif
+
+struct _XGrabStats
+{
+    const gchar *site;
+    guint count;
+    gint64 total_time;
+    gint64 max_time;
+    guint histogram[XGRAB_HISTOGRAM_SIZE];
+};
+
+/* X requests, replies and XSync issued while a handler tag is active */
+#define XREQUEST_UNTAGGED       "(untagged)"
+
+struct _XRequestStats
+{
+    const gchar *tag;
+    guint calls;
+    gulong requests;
+    gulong replies;
+    gulong syncs;
+};
 
 struct _DisplayInfo
 {
@@ -290,6 +328,7 @@ struct _DisplayInfo
     XfceSMClient *session;
     gboolean quit;
     gboolean reload;
+    gboolean dump_stats;
 
     Window timestamp_win;
     Cursor busy_cursor;
@@ -300,6 +339,7 @@ struct _DisplayInfo
     Atom atoms[ATOM_COUNT];
 
     eventFilterSetup *xfilter;
+    eventTrace *event_trace;
     XfwmDevices *devices;
     GSList *screens;
     GSList *clients;
@@ -313,6 +353,15 @@ struct _DisplayInfo
     gint double_click_time;
     gint double_click_distance;
     gint xgrabcount;
+    gint64 xgrab_time;
+    const gchar *xgrab_site;
+    GHashTable *xgrab_stats;
+
+    int (*xrequest_after_function) (Display *);
+    GHashTable *xrequest_stats;
+    GSList *xrequest_tags;
+    unsigned long xrequest_serial;
+    unsigned long xrequest_processed;
     gint nb_screens;
     gchar* hostname;
 
@@ -377,8 +426,15 @@ Cursor                   myDisplayGetCursorMove                 (DisplayInfo *);
 Cursor                   myDisplayGetCursorRoot                 (DisplayInfo *);
 Cursor                   myDisplayGetCursorResize               (DisplayInfo *,
                                                                  guint);
-void                     myDisplayGrabServer                    (DisplayInfo *);
+void                     myDisplayGrabServerFull                (DisplayInfo *,
+                                                                 const gchar *);
 void                     myDisplayUngrabServer                  (DisplayInfo *);
+void                     myDisplayPushRequestTag                (DisplayInfo *,
+                                                                 const gchar *);
+void                     myDisplayPopRequestTag                 (DisplayInfo *);
+void                     myDisplaySync                          (DisplayInfo *,
+                                                                 gboolean);
+void                     myDisplayDumpStats                     (DisplayInfo *);
 void                     myDisplayAddClient                     (DisplayInfo *,
                                                                  Client *);
 void                     myDisplayRemoveClient                  (DisplayInfo *,
@@ -426,4 +482,8 @@ gint                     myDisplayErrorTrapPop                  (DisplayInfo *);
 void                     myDisplayErrorTrapPopIgnored           (DisplayInfo *);
 void                     myDisplayBeep                          (DisplayInfo *);
 GdkKeymap               *myDisplayGetKeymap                     (DisplayInfo *);
+
+/* Keep track of the call site holding the server grab */
+#define myDisplayGrabServer(display) myDisplayGrabServerFull (display, G_STRFUNC)
+
 #endif /* INC_DISPLAY_H */
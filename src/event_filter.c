@@ -166,6 +166,11 @@ eventXfwmFilter (GdkXEvent *gdk_xevent, GdkEvent *gevent, gpointer data)
     filterelt = setup->filterstack;
     g_return_val_if_fail (filterelt != NULL, GDK_FILTER_CONTINUE);
 
+    if (setup->record)
+    {
+        eventRecordWrite (setup->record, (XEvent *) gdk_xevent);
+    }
+
     event = xfwm_device_translate_event (setup->devices, (XEvent *)gdk_xevent, NULL);
     loop = EVENT_FILTER_CONTINUE;
 
@@ -222,6 +227,7 @@ GdkWindow *
 eventFilterAddWin (GdkScreen *gscr, XfwmDevices *devices, long event_mask)
 {
     XWindowAttributes attribs;
+    DisplayInfo *display_info;
     Display *dpy;
     Window xroot;
     GdkWindow *event_win;
@@ -236,8 +242,9 @@ eventFilterAddWin (GdkScreen *gscr, XfwmDevices *devices, long event_mask)
     gdisplay = gdk_window_get_display (event_win);
     dpy = gdk_x11_display_get_xdisplay (gdisplay);
 
-    myDisplayErrorTrapPush (myDisplayGetDefault ());
-    gdk_x11_grab_server ();
+    display_info = myDisplayGetDefault ();
+    myDisplayErrorTrapPush (display_info);
+    myDisplayGrabServer (display_info);
 
     XGetWindowAttributes (dpy, xroot, &attribs);
     XSelectInput (dpy, xroot, attribs.your_event_mask | event_mask);
@@ -245,8 +252,8 @@ eventFilterAddWin (GdkScreen *gscr, XfwmDevices *devices, long event_mask)
     xfwm_device_configure_xi2_event_mask (devices, dpy, xroot, attribs.your_event_mask | event_mask);
 #endif
 
-    gdk_x11_ungrab_server ();
-    error = myDisplayErrorTrapPop (myDisplayGetDefault ());
+    myDisplayUngrabServer (display_info);
+    error = myDisplayErrorTrapPop (display_info);
 
     if (error)
     {
@@ -261,10 +268,19 @@ eventFilterSetup *
 eventFilterInit (XfwmDevices *devices, gpointer data)
 {
     eventFilterSetup *setup;
+    const gchar *filename;
 
     setup = g_new0 (eventFilterSetup, 1);
     setup->filterstack = NULL;
     setup->devices = devices;
+    setup->record = NULL;
+
+    filename = g_getenv ("XFWM4_RECORD_FILE");
+    if (filename && *filename)
+    {
+        setup->record = eventRecordOpen (gdk_x11_display_get_xdisplay (gdk_display_get_default ()),
+                                         filename);
+    }
     eventFilterPush (setup, default_event_filter, data);
     gdk_window_add_filter (NULL, eventXfwmFilter, (gpointer) setup);
 
@@ -280,4 +296,10 @@ eventFilterClose (eventFilterSetup *setup)
     while ((filterelt = eventFilterPop (setup)));
     gdk_window_remove_filter (NULL, eventXfwmFilter, NULL);
     setup->filterstack = NULL;
+
+    if (setup->record)
+    {
+        eventRecordClose (setup->record);
+        setup->record = NULL;
+    }
 }
@@ -32,6 +32,7 @@
 #include <X11/Xlib.h>
 
 #include "device.h"
+#include "event_record.h"
 
 /* this formatting is needed by glib-mkenums */
 typedef enum {
@@ -56,6 +57,7 @@ typedef struct eventFilterSetup
 {
     eventFilterStack *filterstack;
     XfwmDevices *devices;
+    eventRecord *record;
 }
 eventFilterSetup;
 
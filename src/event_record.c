@@ -0,0 +1,373 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "display.h"
+#include "event_record.h"
+
+static void
+appendAtomName (GByteArray *array, Display *dpy, Atom atom)
+{
+    gchar *name;
+
+    name = (atom != None) ? XGetAtomName (dpy, atom) : NULL;
+    if (name)
+    {
+        g_byte_array_append (array, (guint8 *) name, strlen (name));
+        XFree (name);
+    }
+    g_byte_array_append (array, (guint8 *) "", 1);
+}
+
+static gboolean
+eventRecordWriteEntry (eventRecord *record, XEvent *xevent,
+                       const gchar *atom_name, const gchar *type_name,
+                       guint32 format, GByteArray *data)
+{
+    eventRecordEntry entry;
+    gboolean success;
+
+    memset (&entry, 0, sizeof (entry));
+    entry.time = g_get_monotonic_time () - record->start_time;
+    entry.xevent = *xevent;
+    entry.atom_length = atom_name ? strlen (atom_name) : 0;
+    entry.type_length = type_name ? strlen (type_name) : 0;
+    entry.format = format;
+    entry.data_length = data ? data->len : 0;
+
+    success = (fwrite (&entry, sizeof (entry), 1, record->file) == 1);
+    if (success && entry.atom_length)
+    {
+        success = (fwrite (atom_name, entry.atom_length, 1, record->file) == 1);
+    }
+    if (success && entry.type_length)
+    {
+        success = (fwrite (type_name, entry.type_length, 1, record->file) == 1);
+    }
+    if (success && entry.data_length)
+    {
+        success = (fwrite (data->data, entry.data_length, 1, record->file) == 1);
+    }
+    if (success)
+    {
+        /* Keep what has been recorded so far if we crash */
+        success = (fflush (record->file) == 0);
+    }
+
+    record->count++;
+    return success;
+}
+
+/*
+ * Properties are fetched when the notification is received rather than
+ * when it is handled, which is as close as we can get to the value the
+ * client actually set.
+ */
+static gboolean
+eventRecordWriteProperty (eventRecord *record, XEvent *xevent)
+{
+    XPropertyEvent *ev;
+    DisplayInfo *display_info;
+    GByteArray *data;
+    unsigned char *prop;
+    unsigned long nitems, bytes_after, i;
+    gchar *atom_name, *type_name;
+    Atom type;
+    int format, status;
+    gboolean success;
+
+    ev = (XPropertyEvent *) xevent;
+    display_info = myDisplayGetDefault ();
+    data = g_byte_array_new ();
+    prop = NULL;
+    type = None;
+    format = 0;
+    nitems = 0;
+
+    myDisplayErrorTrapPush (display_info);
+    atom_name = XGetAtomName (ev->display, ev->atom);
+    if (ev->state == PropertyNewValue)
+    {
+        status = XGetWindowProperty (ev->display, ev->window, ev->atom,
+                                     0L, G_MAXLONG, FALSE, AnyPropertyType,
+                                     &type, &format, &nitems, &bytes_after, &prop);
+        if (status != Success)
+        {
+            type = None;
+            format = 0;
+            nitems = 0;
+            prop = NULL;
+        }
+    }
+
+    if (prop && (type == XA_ATOM) && (format == 32))
+    {
+        for (i = 0; i < nitems; i++)
+        {
+            appendAtomName (data, ev->display, ((Atom *) prop)[i]);
+        }
+    }
+    else if (prop && (format == 32))
+    {
+        guint32 value;
+
+        /* Xlib hands out format 32 data as longs */
+        for (i = 0; i < nitems; i++)
+        {
+            value = (guint32) ((unsigned long *) prop)[i];
+            g_byte_array_append (data, (guint8 *) &value, sizeof (value));
+        }
+    }
+    else if (prop)
+    {
+        g_byte_array_append (data, prop, nitems * (format / 8));
+    }
+    type_name = (type != None) ? XGetAtomName (ev->display, type) : NULL;
+    myDisplayErrorTrapPopIgnored (display_info);
+
+    success = eventRecordWriteEntry (record, xevent, atom_name, type_name,
+                                     (guint32) format, data);
+
+    if (prop)
+    {
+        XFree (prop);
+    }
+    if (atom_name)
+    {
+        XFree (atom_name);
+    }
+    if (type_name)
+    {
+        XFree (type_name);
+    }
+    g_byte_array_free (data, TRUE);
+
+    return success;
+}
+
+static gboolean
+eventRecordWriteClientMessage (eventRecord *record, XEvent *xevent)
+{
+    XClientMessageEvent *ev;
+    DisplayInfo *display_info;
+    GByteArray *data;
+    gchar *atom_name;
+    gchar *name;
+    gboolean success;
+    int i;
+
+    ev = (XClientMessageEvent *) xevent;
+    display_info = myDisplayGetDefault ();
+    data = g_byte_array_new ();
+
+    myDisplayErrorTrapPush (display_info);
+    atom_name = XGetAtomName (ev->display, ev->message_type);
+    for (i = 0; i < 5; i++)
+    {
+        /* _NET_WM_STATE is the only message carrying atoms we care about */
+        if ((ev->format == 32) && (i == 1 || i == 2) &&
+            (ev->message_type == display_info->atoms[NET_WM_STATE]))
+        {
+            appendAtomName (data, ev->display, (Atom) ev->data.l[i]);
+        }
+        else
+        {
+            g_byte_array_append (data, (guint8 *) "", 1);
+        }
+    }
+    myDisplayErrorTrapPopIgnored (display_info);
+
+    success = eventRecordWriteEntry (record, xevent, atom_name, NULL,
+                                     (guint32) ev->format, data);
+
+    if (atom_name)
+    {
+        XFree (atom_name);
+    }
+    g_byte_array_free (data, TRUE);
+
+    return success;
+}
+
+/*
+ * The window manager reads the initial properties of a window when it
+ * gets the map request, there is no notification for those, so record
+ * them all ahead of the request itself.
+ */
+static gboolean
+eventRecordWriteMapRequest (eventRecord *record, XEvent *xevent)
+{
+    DisplayInfo *display_info;
+    XEvent pevent;
+    Atom *atoms;
+    Window w;
+    int count, i;
+    gboolean success;
+
+    w = xevent->xmaprequest.window;
+    display_info = myDisplayGetDefault ();
+
+    myDisplayErrorTrapPush (display_info);
+    atoms = XListProperties (xevent->xany.display, w, &count);
+    myDisplayErrorTrapPopIgnored (display_info);
+
+    success = TRUE;
+    for (i = 0; success && atoms && i < count; i++)
+    {
+        memset (&pevent, 0, sizeof (pevent));
+        pevent.xproperty.type = PropertyNotify;
+        pevent.xproperty.serial = xevent->xany.serial;
+        pevent.xproperty.send_event = TRUE;
+        pevent.xproperty.display = xevent->xany.display;
+        pevent.xproperty.window = w;
+        pevent.xproperty.atom = atoms[i];
+        pevent.xproperty.time = CurrentTime;
+        pevent.xproperty.state = PropertyNewValue;
+        success = eventRecordWriteProperty (record, &pevent);
+    }
+    if (atoms)
+    {
+        XFree (atoms);
+    }
+
+    if (success)
+    {
+        success = eventRecordWriteEntry (record, xevent, NULL, NULL, 0, NULL);
+    }
+
+    return success;
+}
+
+eventRecord *
+eventRecordOpen (Display *dpy, const gchar *filename)
+{
+    eventRecordHeader header;
+    eventRecord *record;
+    FILE *f;
+
+    g_return_val_if_fail (dpy != NULL, NULL);
+    g_return_val_if_fail (filename != NULL, NULL);
+
+    f = fopen (filename, "wb");
+    if (!f)
+    {
+        g_warning ("Cannot record events to %s: %s", filename, g_strerror (errno));
+        return NULL;
+    }
+
+    record = g_new0 (eventRecord, 1);
+    record->file = f;
+    record->filename = g_strdup (filename);
+    record->start_time = g_get_monotonic_time ();
+    record->count = 0;
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, EVENT_RECORD_MAGIC, sizeof (header.magic));
+    header.byte_order = 0x01020304;
+    header.event_size = sizeof (XEvent);
+    header.root = (guint32) DefaultRootWindow (dpy);
+    header.start_time = record->start_time;
+
+    if (fwrite (&header, sizeof (header), 1, f) != 1)
+    {
+        g_warning ("Failed to write event recording header to %s", filename);
+        eventRecordClose (record);
+        return NULL;
+    }
+
+    g_message ("Recording X events to %s", filename);
+    return record;
+}
+
+/*
+ * Only the events coming from other clients that a replay can reproduce
+ * are recorded, everything else is a consequence of what xfwm4 does.
+ */
+void
+eventRecordWrite (eventRecord *record, XEvent *xevent)
+{
+    gboolean success;
+
+    g_return_if_fail (record != NULL);
+    g_return_if_fail (xevent != NULL);
+
+    if (!record->file)
+    {
+        return;
+    }
+
+    switch (xevent->type)
+    {
+        case CreateNotify:
+        case DestroyNotify:
+        case UnmapNotify:
+        case MapNotify:
+        case ConfigureRequest:
+            success = eventRecordWriteEntry (record, xevent, NULL, NULL, 0, NULL);
+            break;
+        case MapRequest:
+            success = eventRecordWriteMapRequest (record, xevent);
+            break;
+        case PropertyNotify:
+            success = eventRecordWriteProperty (record, xevent);
+            break;
+        case ClientMessage:
+            success = eventRecordWriteClientMessage (record, xevent);
+            break;
+        default:
+            return;
+    }
+
+    if (!success)
+    {
+        g_warning ("Failed to record events to %s, recording stopped", record->filename);
+        fclose (record->file);
+        record->file = NULL;
+    }
+}
+
+void
+eventRecordClose (eventRecord *record)
+{
+    g_return_if_fail (record != NULL);
+
+    if (record->file)
+    {
+        fclose (record->file);
+        g_message ("%u X events recorded to %s", record->count, record->filename);
+    }
+    g_free (record->filename);
+    g_free (record);
+}
@@ -0,0 +1,86 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifndef INC_EVENT_RECORD_H
+#define INC_EVENT_RECORD_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <glib.h>
+#include <X11/Xlib.h>
+
+/*
+ * A recording is a header followed by a stream of entries, each entry
+ * being immediately followed by its variable length payload: the atom
+ * name, the property type name and then the data, in that order.
+ *
+ * Atoms are stored by name so that a recording can be replayed on a
+ * different X server. Format 32 property data is stored as 32 bit
+ * values, ATOM properties as a list of nul terminated names and, for
+ * client messages, the data holds five nul terminated names, one per
+ * long, empty when the long is not an atom.
+ *
+ * Everything is written in the byte order of the machine running
+ * xfwm4 and XEvents are stored raw, so recordings are only meant to
+ * be replayed on the same architecture.
+ */
+#define EVENT_RECORD_MAGIC      "XFWMREC1"
+
+typedef struct
+{
+    gchar magic[8];
+    guint32 byte_order;
+    guint32 event_size;
+    guint32 root;
+    guint32 padding;
+    gint64 start_time;
+} eventRecordHeader;
+
+typedef struct
+{
+    gint64 time;
+    XEvent xevent;
+    guint32 atom_length;
+    guint32 type_length;
+    guint32 format;
+    guint32 data_length;
+} eventRecordEntry;
+
+typedef struct
+{
+    FILE *file;
+    gchar *filename;
+    gint64 start_time;
+    guint32 count;
+} eventRecord;
+
+eventRecord             *eventRecordOpen                        (Display *,
+                                                                 const gchar *);
+void                     eventRecordWrite                       (eventRecord *,
+                                                                 XEvent *);
+void                     eventRecordClose                       (eventRecord *);
+
+#endif /* INC_EVENT_RECORD_H */
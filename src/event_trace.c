@@ -0,0 +1,153 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "event_trace.h"
+
+eventTrace *
+eventTraceNew (void)
+{
+    return g_new0 (eventTrace, 1);
+}
+
+void
+eventTraceFree (eventTrace *trace)
+{
+    g_free (trace);
+}
+
+/*
+ * The trace is only ever written from the main loop, so claiming the
+ * next slot of the ring is just a matter of bumping the sequence.
+ * Returns the sequence number to pass to eventTraceEnd().
+ */
+guint32
+eventTraceBegin (eventTrace *trace, eventTraceSource source, int type,
+                 Window window, guint32 server_time)
+{
+    eventTraceRecord *record;
+    guint32 sequence;
+
+    g_return_val_if_fail (trace != NULL, 0);
+
+    sequence = trace->sequence++;
+    record = &trace->records[sequence % EVENT_TRACE_SIZE];
+
+    record->sequence = sequence;
+    record->source = (guint16) source;
+    record->type = (guint16) type;
+    record->window = (guint32) window;
+    record->server_time = server_time;
+    record->receive_time = g_get_monotonic_time ();
+    record->duration = 0;
+    record->padding = 0;
+
+    return sequence;
+}
+
+void
+eventTraceEnd (eventTrace *trace, guint32 sequence)
+{
+    eventTraceRecord *record;
+    gint64 duration;
+
+    g_return_if_fail (trace != NULL);
+
+    record = &trace->records[sequence % EVENT_TRACE_SIZE];
+    if (record->sequence != sequence)
+    {
+        /* Overwritten by the time the handler returned */
+        return;
+    }
+
+    duration = g_get_monotonic_time () - record->receive_time;
+    record->duration = (guint32) MIN (duration, G_MAXUINT32);
+}
+
+gboolean
+eventTraceDump (eventTrace *trace, const gchar *filename)
+{
+    eventTraceHeader header;
+    guint32 first, i;
+    gboolean success;
+    FILE *f;
+    int fd;
+
+    g_return_val_if_fail (trace != NULL, FALSE);
+    g_return_val_if_fail (filename != NULL, FALSE);
+
+    /* Never follow a link planted in place of the trace file */
+    fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    f = (fd < 0) ? NULL : fdopen (fd, "wb");
+    if (!f)
+    {
+        g_warning ("Cannot write event trace to %s: %s", filename, g_strerror (errno));
+        if (fd >= 0)
+        {
+            close (fd);
+        }
+        return FALSE;
+    }
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, EVENT_TRACE_MAGIC, sizeof (header.magic));
+    header.byte_order = 0x01020304;
+    header.record_size = sizeof (eventTraceRecord);
+    header.count = MIN (trace->sequence, EVENT_TRACE_SIZE);
+    header.dropped = trace->sequence - header.count;
+    header.dump_time = g_get_monotonic_time ();
+
+    success = (fwrite (&header, sizeof (header), 1, f) == 1);
+
+    first = trace->sequence - header.count;
+    for (i = 0; success && i < header.count; i++)
+    {
+        success = (fwrite (&trace->records[(first + i) % EVENT_TRACE_SIZE],
+                           sizeof (eventTraceRecord), 1, f) == 1);
+    }
+
+    if (fclose (f) != 0)
+    {
+        success = FALSE;
+    }
+
+    if (!success)
+    {
+        g_warning ("Failed to write event trace to %s", filename);
+        return FALSE;
+    }
+
+    g_print ("Event trace of %u records written to %s\n", header.count, filename);
+    return TRUE;
+}
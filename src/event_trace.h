@@ -0,0 +1,86 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+#ifndef INC_EVENT_TRACE_H
+#define INC_EVENT_TRACE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+/*
+ * The trace file is a header followed by the records, oldest first,
+ * both written in the byte order of the machine running xfwm4.
+ */
+#define EVENT_TRACE_MAGIC       "XFWMTRC1"
+#define EVENT_TRACE_SIZE        4096
+
+typedef enum
+{
+    EVENT_TRACE_SOURCE_HANDLER = 0,
+    EVENT_TRACE_SOURCE_COMPOSITOR
+} eventTraceSource;
+
+typedef struct
+{
+    gchar magic[8];
+    guint32 byte_order;
+    guint32 record_size;
+    guint32 count;
+    guint32 dropped;
+    gint64 dump_time;
+} eventTraceHeader;
+
+typedef struct
+{
+    guint32 sequence;
+    guint16 source;
+    guint16 type;
+    guint32 window;
+    guint32 server_time;
+    gint64 receive_time;
+    guint32 duration;
+    guint32 padding;
+} eventTraceRecord;
+
+typedef struct
+{
+    eventTraceRecord records[EVENT_TRACE_SIZE];
+    guint32 sequence;
+} eventTrace;
+
+eventTrace              *eventTraceNew                          (void);
+void                     eventTraceFree                         (eventTrace *);
+guint32                  eventTraceBegin                        (eventTrace *,
+                                                                 eventTraceSource,
+                                                                 int,
+                                                                 Window,
+                                                                 guint32);
+void                     eventTraceEnd                          (eventTrace *,
+                                                                 guint32);
+gboolean                 eventTraceDump                         (eventTrace *,
+                                                                 const gchar *);
+
+#endif /* INC_EVENT_TRACE_H */
@@ -291,7 +291,16 @@ toggle_show_desktop (ScreenInfo *screen_info)
 static eventFilterStatus
 handleMotionNotify (DisplayInfo *display_info, XfwmEventMotion *event)
 {
+    Client *c;
+
     TRACE ("entering");
+
+    c = myDisplayGetClientFromWindow (display_info, event->meta.window, SEARCH_FRAME);
+    if ((c) && FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+    {
+        frameUpdatePointer (c, event->x, event->y, TRUE);
+    }
+
     return EVENT_FILTER_REMOVE;
 }
 
@@ -873,6 +882,94 @@ titleButton (Client *c, guint state, XfwmEventButton *event)
 #endif /* HAVE_COMPOSITOR */
 }
 
+static void
+menuButton (Client *c, XfwmEventButton *event)
+{
+    ScreenInfo *screen_info;
+    XfwmButtonClickType tclick;
+
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (event != NULL);
+
+    screen_info = c->screen_info;
+
+    if (event->button != Button1)
+    {
+        return;
+    }
+
+    tclick = typeOfClick (screen_info, c->window, event, TRUE);
+
+    if (tclick == XFWM_BUTTON_DOUBLE_CLICK)
+    {
+        clientClose (c);
+    }
+    else if (tclick != XFWM_BUTTON_UNDEFINED)
+    {
+        if (!(c->type & WINDOW_TYPE_DONT_FOCUS))
+        {
+            clientSetFocus (screen_info, c, event->time, NO_FOCUS_FLAG);
+        }
+        if (screen_info->params->raise_on_click)
+        {
+            clientClearDelayedRaise ();
+            clientRaise (c, None);
+        }
+        xfwm_device_button_update_window (event, event->root);
+        if (screen_info->button_handler_id)
+        {
+            g_signal_handler_disconnect (G_OBJECT (myScreenGetGtkWidget (screen_info)), screen_info->button_handler_id);
+        }
+        screen_info->button_handler_id = g_signal_connect (G_OBJECT (myScreenGetGtkWidget (screen_info)),
+                                                  "button_press_event", G_CALLBACK (show_popup_cb), (gpointer) c);
+        /* Let GTK handle this for us. */
+    }
+}
+
+/* Single window frame, find out which part was clicked */
+static void
+frameButton (Client *c, guint state, XfwmEventButton *event)
+{
+    ScreenInfo *screen_info;
+    int detail;
+
+    screen_info = c->screen_info;
+
+    switch (frameHitTest (c, event->x, event->y, &detail))
+    {
+        case FRAME_HIT_BUTTON:
+            if (detail == MENU_BUTTON)
+            {
+                menuButton (c, event);
+            }
+            else if (event->button <= Button3)
+            {
+                if (!(c->type & WINDOW_TYPE_DONT_FOCUS))
+                {
+                    clientSetFocus (screen_info, c, event->time, NO_FOCUS_FLAG);
+                }
+                if (screen_info->params->raise_on_click)
+                {
+                    clientClearDelayedRaise ();
+                    clientRaise (c, None);
+                }
+                clientButtonPress (c, c->frame, event);
+            }
+            break;
+        case FRAME_HIT_TITLE:
+            titleButton (c, state, event);
+            break;
+        case FRAME_HIT_EDGE:
+            if (state == 0)
+            {
+                edgeButton (c, detail, event);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 static void
 rootScrollButton (DisplayInfo *display_info, XfwmEventButton *event)
 {
@@ -958,6 +1055,10 @@ handleButtonPress (DisplayInfo *display_info, XfwmEventButton *event)
             workspaceSwitch (screen_info, screen_info->current_ws + 1, NULL, TRUE, event->time);
         }
 
+        else if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW) && (event->meta.window == c->frame))
+        {
+            frameButton (c, state, event);
+        }
         else if (WIN_IS_BUTTON (win))
         {
             if (event->button <= Button3)
@@ -980,37 +1081,7 @@ handleButtonPress (DisplayInfo *display_info, XfwmEventButton *event)
         }
         else if (win == MYWINDOW_XWINDOW (c->buttons[MENU_BUTTON]))
         {
-            if (event->button == Button1)
-            {
-                XfwmButtonClickType tclick;
-
-                tclick = typeOfClick (screen_info, c->window, event, TRUE);
-
-                if (tclick == XFWM_BUTTON_DOUBLE_CLICK)
-                {
-                    clientClose (c);
-                }
-                else if (tclick != XFWM_BUTTON_UNDEFINED)
-                {
-                    if (!(c->type & WINDOW_TYPE_DONT_FOCUS))
-                    {
-                        clientSetFocus (screen_info, c, event->time, NO_FOCUS_FLAG);
-                    }
-                    if (screen_info->params->raise_on_click)
-                    {
-                        clientClearDelayedRaise ();
-                        clientRaise (c, None);
-                    }
-                    xfwm_device_button_update_window (event, event->root);
-                    if (screen_info->button_handler_id)
-                    {
-                        g_signal_handler_disconnect (G_OBJECT (myScreenGetGtkWidget (screen_info)), screen_info->button_handler_id);
-                    }
-                    screen_info->button_handler_id = g_signal_connect (G_OBJECT (myScreenGetGtkWidget (screen_info)),
-                                                              "button_press_event", G_CALLBACK (show_popup_cb), (gpointer) c);
-                    /* Let GTK handle this for us. */
-                }
-            }
+            menuButton (c, event);
         }
         else if ((win == MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]))
             && (state == 0))
@@ -1453,6 +1524,10 @@ handleEnterNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
                 frameQueueDraw (c, FALSE);
             }
         }
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW) && (event->meta.window == c->frame))
+        {
+            frameUpdatePointer (c, event->x_root - frameX (c), event->y_root - frameY (c), TRUE);
+        }
 
         /* No need to process the event any further */
         return EVENT_FILTER_REMOVE;
@@ -1511,6 +1586,11 @@ handleLeaveNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
         {
             frameQueueDraw (c, FALSE);
         }
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW) && (event->meta.window == c->frame))
+        {
+            /* Left the decoration, possibly for the client window */
+            frameUpdatePointer (c, 0, 0, FALSE);
+        }
 
         /* No need to process the event any further */
         return EVENT_FILTER_REMOVE;
@@ -2141,6 +2221,7 @@ handleShape (DisplayInfo *display_info, XShapeEvent * ev)
         }
         if (!update)
         {
+            FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_RESHAPE);
             frameQueueDraw (c, FALSE);
         }
     }
@@ -2198,12 +2279,18 @@ static eventFilterStatus
 handleEvent (DisplayInfo *display_info, XfwmEvent *event)
 {
     eventFilterStatus status;
+    guint32 timestamp;
+    guint32 trace;
     status = EVENT_FILTER_PASS;
 
     TRACE ("entering");
 
+    myDisplayPushRequestTag (display_info, "handleEvent");
+
     /* Update the display time */
-    myDisplayUpdateCurrentTime (display_info, event);
+    timestamp = myDisplayUpdateCurrentTime (display_info, event);
+    trace = eventTraceBegin (display_info->event_trace, EVENT_TRACE_SOURCE_HANDLER,
+                             event->meta.xevent->type, event->meta.window, timestamp);
     sn_process_event (event->meta.xevent);
 
     switch (event->meta.type)
@@ -2211,97 +2298,149 @@ handleEvent (DisplayInfo *display_info, XfwmEvent *event)
         case XFWM_EVENT_KEY:
             if (event->key.pressed)
             {
+                myDisplayPushRequestTag (display_info, "handleKeyPress");
                 status = handleKeyPress (display_info, &event->key);
+                myDisplayPopRequestTag (display_info);
             }
             else
             {
+                myDisplayPushRequestTag (display_info, "handleKeyRelease");
                 status = handleKeyRelease (display_info, &event->key);
+                myDisplayPopRequestTag (display_info);
             }
             break;
         case XFWM_EVENT_BUTTON:
             if (event->button.pressed)
             {
+                myDisplayPushRequestTag (display_info, "handleButtonPress");
                 status = handleButtonPress (display_info, &event->button);
+                myDisplayPopRequestTag (display_info);
             }
             else
             {
+                myDisplayPushRequestTag (display_info, "handleButtonRelease");
                 status = handleButtonRelease (display_info, &event->button);
+                myDisplayPopRequestTag (display_info);
             }
             break;
         case XFWM_EVENT_MOTION:
+            myDisplayPushRequestTag (display_info, "handleMotionNotify");
             status = handleMotionNotify (display_info, &event->motion);
+            myDisplayPopRequestTag (display_info);
             break;
         case XFWM_EVENT_CROSSING:
             if (event->crossing.enter)
             {
+                myDisplayPushRequestTag (display_info, "handleEnterNotify");
                 status = handleEnterNotify (display_info, &event->crossing);
+                myDisplayPopRequestTag (display_info);
             }
             else
             {
+                myDisplayPushRequestTag (display_info, "handleLeaveNotify");
                 status = handleLeaveNotify (display_info, &event->crossing);
+                myDisplayPopRequestTag (display_info);
             }
             break;
         case XFWM_EVENT_XEVENT:
             switch (event->meta.xevent->type)
             {
                 case DestroyNotify:
+                    myDisplayPushRequestTag (display_info, "handleDestroyNotify");
                     status = handleDestroyNotify (display_info, (XDestroyWindowEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case UnmapNotify:
+                    myDisplayPushRequestTag (display_info, "handleUnmapNotify");
                     status = handleUnmapNotify (display_info, (XUnmapEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case MapRequest:
+                    myDisplayPushRequestTag (display_info, "handleMapRequest");
                     status = handleMapRequest (display_info, (XMapRequestEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case MapNotify:
+                    myDisplayPushRequestTag (display_info, "handleMapNotify");
                     status = handleMapNotify (display_info, (XMapEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case ConfigureNotify:
+                    myDisplayPushRequestTag (display_info, "handleConfigureNotify");
                     status = handleConfigureNotify (display_info, (XConfigureEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case ConfigureRequest:
+                    myDisplayPushRequestTag (display_info, "handleConfigureRequest");
                     status = handleConfigureRequest (display_info, (XConfigureRequestEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case FocusIn:
+                    myDisplayPushRequestTag (display_info, "handleFocusIn");
                     status = handleFocusIn (display_info, (XFocusChangeEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case FocusOut:
+                    myDisplayPushRequestTag (display_info, "handleFocusOut");
                     status = handleFocusOut (display_info, (XFocusChangeEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case PropertyNotify:
+                    myDisplayPushRequestTag (display_info, "handlePropertyNotify");
                     status = handlePropertyNotify (display_info, (XPropertyEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case ClientMessage:
+                    myDisplayPushRequestTag (display_info, "handleClientMessage");
                     status = handleClientMessage (display_info, (XClientMessageEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case SelectionClear:
+                    myDisplayPushRequestTag (display_info, "handleSelectionClear");
                     status = handleSelectionClear (display_info, (XSelectionClearEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case ColormapNotify:
+                    myDisplayPushRequestTag (display_info, "handleColormapNotify");
                     handleColormapNotify (display_info, (XColormapEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 case ReparentNotify:
+                    myDisplayPushRequestTag (display_info, "handleReparentNotify");
                     status = handleReparentNotify (display_info, (XReparentEvent *) event->meta.xevent);
+                    myDisplayPopRequestTag (display_info);
                     break;
                 default:
                     if ((display_info->have_shape) &&
                             (event->meta.xevent->type == display_info->shape_event_base))
                     {
+                        myDisplayPushRequestTag (display_info, "handleShape");
                         status = handleShape (display_info, (XShapeEvent *) event->meta.xevent);
+                        myDisplayPopRequestTag (display_info);
                     }
 #ifdef HAVE_XSYNC
                     if ((display_info->have_xsync) &&
                             (event->meta.xevent->type == (display_info->xsync_event_base + XSyncAlarmNotify)))
                     {
+                        myDisplayPushRequestTag (display_info, "handleXSyncAlarmNotify");
                         status = handleXSyncAlarmNotify (display_info, (XSyncAlarmNotifyEvent *) event->meta.xevent);
+                        myDisplayPopRequestTag (display_info);
                     }
 #endif /* HAVE_XSYNC */
                     break;
             }
             break;
     }
+    eventTraceEnd (display_info->event_trace, trace);
+    myDisplayPopRequestTag (display_info);
+
     if (!gdk_events_pending () && !XPending (display_info->dpy))
     {
+        if (display_info->dump_stats)
+        {
+            myDisplayDumpStats (display_info);
+            display_info->dump_stats = FALSE;
+        }
         if (display_info->reload)
         {
             reloadSettings (display_info, UPDATE_ALL);
@@ -2767,6 +2906,9 @@ refresh_font_cb (GObject * obj, GdkEvent * ev, gpointer data)
     for (list = display_info->screens; list; list = g_slist_next (list))
     {
         ScreenInfo *screen_info = (ScreenInfo *) list->data;
+        /* Font rendering options changed, titles need to be shaped again */
+        frameClearTitleCache (screen_info);
+        frameClearShapeCache (screen_info);
         clientUpdateAllFrames (screen_info, UPDATE_FRAME);
     }
 
@@ -39,12 +39,112 @@
 #include "frame.h"
 #include "compositor.h"
 
+/* Number of title layouts kept per screen */
+#define TITLE_CACHE_SIZE 128
+/* Memory kept for side pixmaps no frame uses anymore */
+#define PIXMAP_CACHE_MAX_BYTES (4 * 1024 * 1024)
+/* Number of frame shapes kept per screen */
+#define SHAPE_CACHE_SIZE 32
+/* Time spent on batched redraws per idle iteration, in microseconds */
+#define DRAW_BATCH_SLICE 8000
+
+/* Parts of the frame updated by frameDrawWin() */
+#define FRAME_PART_TITLE        (1 << 0)
+#define FRAME_PART_SIDES        (1 << 1)
+#define FRAME_PART_CORNERS      (1 << 2)
+#define FRAME_PART_SHAPE        (1 << 3)
+#define FRAME_PART_BUTTON(b)    (1 << (4 + (b)))
+#define FRAME_PART_BUTTONS      (((1 << BUTTON_COUNT) - 1) << 4)
+#define FRAME_PART_ALL          (~0U)
+
 typedef struct
 {
     xfwmPixmap pm_title;
-    xfwmPixmap pm_sides[SIDE_COUNT];
+    xfwmPixmap pm_top;
+    /* Top is pm_top, others are shared through the pixmap cache */
+    xfwmPixmap *pm_sides[SIDE_COUNT];
+    /* The whole decoration, with a single window frame */
+    xfwmPixmap *pm_frame;
 } FramePixmap;
 
+typedef struct
+{
+    gchar *title;
+    PangoFontDescription *font_desc;
+    PangoAttrList *attr_list;
+    PangoLayout *layout;
+    PangoRectangle logical_rect;
+    GList link;
+} TitleCacheEntry;
+
+typedef struct
+{
+    guint generation;
+    gint side;
+    gint state;
+    gint width;
+    gint height;
+} FramePixmapKey;
+
+struct _FramePixmapEntry
+{
+    FramePixmapKey key;
+    xfwmPixmap pm;
+    guint ref_count;
+    gsize size;
+    GList link;
+};
+
+/* What was drawn last, to tell which parts changed */
+struct _FrameDrawState
+{
+    gboolean valid;
+    gint state;
+    unsigned long flags;
+    gint width;
+    gint height;
+    gint left;
+    gint right;
+    gchar *title;
+    Pixmap button_pixmap[BUTTON_COUNT];
+    gint button_x[BUTTON_COUNT];
+    gint top_height;
+    /* Cursor set on a single window frame */
+    Cursor cursor;
+    /* Cached shape last applied to the frame, 0 if none */
+    guint shape_serial;
+};
+
+/* A frame shape, for the decoration described by the first fields */
+typedef struct
+{
+    gint state;
+    unsigned long flags;
+    gint width;
+    gint height;
+    gint left;
+    gint right;
+    gchar *title;
+    Pixmap button_pixmap[BUTTON_COUNT];
+    gint button_x[BUTTON_COUNT];
+    Display *dpy;
+    Window shape_win;
+    guint serial;
+    GList link;
+} ShapeCacheEntry;
+
+struct _FramePixmapCache
+{
+    GHashTable *entries;
+    /* Unreferenced entries, most recently released first */
+    GQueue unused;
+    guint generation;
+    gsize bytes;
+    gsize unused_bytes;
+    guint hits;
+    guint misses;
+};
+
 static int
 frameDecorationBorderTop (ScreenInfo *screen_info)
 {
@@ -136,6 +236,480 @@ frameFillTitlePixmap (Client * c, int state, int part, int x, int w, int h, xfwm
     xfwmPixmapFill (&screen_info->title[part][state], title_pm, x, 0, w, frameDecorationTop(screen_info));
 }
 
+static guint
+titleCacheHash (gconstpointer key)
+{
+    const TitleCacheEntry *entry = key;
+
+    return g_str_hash (entry->title) ^
+           pango_font_description_hash (entry->font_desc) ^
+           GPOINTER_TO_UINT (entry->attr_list);
+}
+
+static gboolean
+titleCacheEqual (gconstpointer a, gconstpointer b)
+{
+    const TitleCacheEntry *entry_a = a;
+    const TitleCacheEntry *entry_b = b;
+
+    return ((entry_a->attr_list == entry_b->attr_list) &&
+            !g_strcmp0 (entry_a->title, entry_b->title) &&
+            pango_font_description_equal (entry_a->font_desc, entry_b->font_desc));
+}
+
+static void
+titleCacheEntryFree (gpointer data)
+{
+    TitleCacheEntry *entry = data;
+
+    g_free (entry->title);
+    pango_font_description_free (entry->font_desc);
+    if (entry->attr_list)
+    {
+        pango_attr_list_unref (entry->attr_list);
+    }
+    g_object_unref (G_OBJECT (entry->layout));
+    g_free (entry);
+}
+
+/*
+ * Returns the layout of the given title, shaped and measured only if it
+ * is not in the cache already. The layout belongs to the cache.
+ */
+static PangoLayout *
+frameGetTitleLayout (ScreenInfo *screen_info, const gchar *title, PangoRectangle *logical_rect)
+{
+    TitleCacheEntry key, *entry;
+
+    if (!screen_info->title_cache)
+    {
+        screen_info->title_cache = g_hash_table_new_full (titleCacheHash, titleCacheEqual,
+                                                          NULL, titleCacheEntryFree);
+        screen_info->title_cache_lru = g_queue_new ();
+    }
+
+    key.title = (gchar *) (title ? title : "");
+    key.font_desc = myScreenGetFontDescription (screen_info);
+    key.attr_list = screen_info->pango_attr_list;
+
+    entry = g_hash_table_lookup (screen_info->title_cache, &key);
+    if (entry)
+    {
+        /* Most recently used first */
+        g_queue_unlink (screen_info->title_cache_lru, &entry->link);
+        g_queue_push_head_link (screen_info->title_cache_lru, &entry->link);
+        *logical_rect = entry->logical_rect;
+
+        return entry->layout;
+    }
+
+    if (g_queue_get_length (screen_info->title_cache_lru) >= TITLE_CACHE_SIZE)
+    {
+        TitleCacheEntry *oldest;
+
+        oldest = g_queue_peek_tail (screen_info->title_cache_lru);
+        g_queue_unlink (screen_info->title_cache_lru, &oldest->link);
+        g_hash_table_remove (screen_info->title_cache, oldest);
+    }
+
+    entry = g_new0 (TitleCacheEntry, 1);
+    entry->title = g_strdup (key.title);
+    entry->font_desc = pango_font_description_copy (key.font_desc);
+    entry->attr_list = key.attr_list ? pango_attr_list_ref (key.attr_list) : NULL;
+    entry->layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), entry->title);
+    pango_layout_set_font_description (entry->layout, entry->font_desc);
+    pango_layout_set_auto_dir (entry->layout, FALSE);
+    if (entry->attr_list != NULL)
+    {
+        pango_layout_set_attributes (entry->layout, entry->attr_list);
+    }
+    pango_layout_get_pixel_extents (entry->layout, NULL, &entry->logical_rect);
+    entry->link.data = entry;
+
+    g_hash_table_add (screen_info->title_cache, entry);
+    g_queue_push_head_link (screen_info->title_cache_lru, &entry->link);
+    *logical_rect = entry->logical_rect;
+
+    return entry->layout;
+}
+
+void
+frameClearTitleCache (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    if (screen_info->title_cache)
+    {
+        /* The links are part of the entries, just forget about them */
+        g_queue_init (screen_info->title_cache_lru);
+        g_queue_free (screen_info->title_cache_lru);
+        screen_info->title_cache_lru = NULL;
+        g_hash_table_destroy (screen_info->title_cache);
+        screen_info->title_cache = NULL;
+    }
+}
+
+static guint
+shapeCacheHash (gconstpointer key)
+{
+    const ShapeCacheEntry *entry = key;
+    guint hash;
+    int i;
+
+    hash = g_str_hash (entry->title ? entry->title : "");
+    hash ^= (entry->state << 28) ^ ((guint) entry->flags) ^
+            (entry->width << 16) ^ entry->height ^ (entry->left << 8) ^ (entry->right << 20);
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        hash = hash * 31 + entry->button_x[i] + (guint) entry->button_pixmap[i];
+    }
+
+    return hash;
+}
+
+static gboolean
+shapeCacheEqual (gconstpointer a, gconstpointer b)
+{
+    const ShapeCacheEntry *entry_a = a;
+    const ShapeCacheEntry *entry_b = b;
+    int i;
+
+    if ((entry_a->state != entry_b->state) || (entry_a->flags != entry_b->flags) ||
+        (entry_a->width != entry_b->width) || (entry_a->height != entry_b->height) ||
+        (entry_a->left != entry_b->left) || (entry_a->right != entry_b->right) ||
+        g_strcmp0 (entry_a->title, entry_b->title))
+    {
+        return FALSE;
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if ((entry_a->button_x[i] != entry_b->button_x[i]) ||
+            (entry_a->button_pixmap[i] != entry_b->button_pixmap[i]))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+shapeCacheEntryFree (gpointer data)
+{
+    ShapeCacheEntry *entry = data;
+
+    XDestroyWindow (entry->dpy, entry->shape_win);
+    g_free (entry->title);
+    g_free (entry);
+}
+
+static void
+shapeCacheKeyInit (ShapeCacheEntry *key, FrameDrawState *drawn)
+{
+    int i;
+
+    key->state = drawn->state;
+    key->flags = drawn->flags;
+    key->width = drawn->width;
+    key->height = drawn->height;
+    key->left = drawn->left;
+    key->right = drawn->right;
+    key->title = drawn->title;
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        key->button_pixmap[i] = drawn->button_pixmap[i];
+        key->button_x[i] = drawn->button_x[i];
+    }
+}
+
+/*
+ * Returns the cached shape of the decoration last drawn, or NULL and then
+ * *new_entry is an empty entry for the caller to build the shape in.
+ */
+static ShapeCacheEntry *
+frameGetCachedShape (ScreenInfo *screen_info, FrameDrawState *drawn, ShapeCacheEntry **new_entry)
+{
+    DisplayInfo *display_info;
+    ShapeCacheEntry key, *entry;
+
+    display_info = screen_info->display_info;
+    if (!screen_info->shape_cache)
+    {
+        screen_info->shape_cache = g_hash_table_new_full (shapeCacheHash, shapeCacheEqual,
+                                                          NULL, shapeCacheEntryFree);
+        screen_info->shape_cache_lru = g_queue_new ();
+    }
+
+    shapeCacheKeyInit (&key, drawn);
+    entry = g_hash_table_lookup (screen_info->shape_cache, &key);
+    if (entry)
+    {
+        /* Most recently used first */
+        g_queue_unlink (screen_info->shape_cache_lru, &entry->link);
+        g_queue_push_head_link (screen_info->shape_cache_lru, &entry->link);
+        *new_entry = NULL;
+
+        return entry;
+    }
+
+    if (g_queue_get_length (screen_info->shape_cache_lru) >= SHAPE_CACHE_SIZE)
+    {
+        ShapeCacheEntry *oldest;
+
+        oldest = g_queue_peek_tail (screen_info->shape_cache_lru);
+        g_queue_unlink (screen_info->shape_cache_lru, &oldest->link);
+        g_hash_table_remove (screen_info->shape_cache, oldest);
+    }
+
+    entry = g_new0 (ShapeCacheEntry, 1);
+    *entry = key;
+    entry->title = g_strdup (key.title);
+    entry->dpy = display_info->dpy;
+    entry->shape_win = XCreateSimpleWindow (display_info->dpy, screen_info->xroot, 0, 0,
+                                            key.width, key.height, 0, 0, 0);
+    entry->serial = ++screen_info->shape_cache_serial;
+    entry->link.data = entry;
+    entry->link.prev = NULL;
+    entry->link.next = NULL;
+
+    g_hash_table_add (screen_info->shape_cache, entry);
+    g_queue_push_head_link (screen_info->shape_cache_lru, &entry->link);
+    *new_entry = entry;
+
+    return NULL;
+}
+
+void
+frameClearShapeCache (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    if (screen_info->shape_cache)
+    {
+        /* The links are part of the entries, just forget about them */
+        g_queue_init (screen_info->shape_cache_lru);
+        g_queue_free (screen_info->shape_cache_lru);
+        screen_info->shape_cache_lru = NULL;
+        g_hash_table_destroy (screen_info->shape_cache);
+        screen_info->shape_cache = NULL;
+    }
+}
+
+static guint
+pixmapCacheHash (gconstpointer key)
+{
+    const FramePixmapKey *k = key;
+
+    return (k->generation << 24) ^ (k->side << 20) ^ (k->state << 16) ^
+           (k->width << 8) ^ k->height;
+}
+
+static gboolean
+pixmapCacheEqual (gconstpointer a, gconstpointer b)
+{
+    const FramePixmapKey *k1 = a;
+    const FramePixmapKey *k2 = b;
+
+    return ((k1->generation == k2->generation) && (k1->side == k2->side) &&
+            (k1->state == k2->state) && (k1->width == k2->width) &&
+            (k1->height == k2->height));
+}
+
+static void
+pixmapCacheEntryFree (FramePixmapCache *cache, FramePixmapEntry *entry)
+{
+    cache->bytes -= entry->size;
+    xfwmPixmapFree (&entry->pm);
+    g_free (entry);
+}
+
+static void
+pixmapCacheTrim (FramePixmapCache *cache, gsize max_bytes)
+{
+    FramePixmapEntry *entry;
+
+    while ((cache->unused_bytes > max_bytes) && (entry = g_queue_peek_tail (&cache->unused)))
+    {
+        g_queue_unlink (&cache->unused, &entry->link);
+        cache->unused_bytes -= entry->size;
+        g_hash_table_remove (cache->entries, &entry->key);
+        pixmapCacheEntryFree (cache, entry);
+    }
+}
+
+/*
+ * Returns the side pixmap for the given theme part, state and size,
+ * shared between all the frames using the same. The reference is to be
+ * given back with framePixmapRelease() once the frame does not show it.
+ */
+static FramePixmapEntry *
+framePixmapAcquire (ScreenInfo *screen_info, int side, int state, int width, int height)
+{
+    FramePixmapCache *cache;
+    FramePixmapEntry *entry;
+    FramePixmapKey key;
+
+    if (!screen_info->pixmap_cache)
+    {
+        screen_info->pixmap_cache = g_new0 (FramePixmapCache, 1);
+        screen_info->pixmap_cache->entries = g_hash_table_new (pixmapCacheHash, pixmapCacheEqual);
+        g_queue_init (&screen_info->pixmap_cache->unused);
+    }
+    cache = screen_info->pixmap_cache;
+
+    key.generation = cache->generation;
+    key.side = side;
+    key.state = state;
+    key.width = width;
+    key.height = height;
+
+    entry = g_hash_table_lookup (cache->entries, &key);
+    if (entry)
+    {
+        cache->hits++;
+        if (entry->ref_count++ == 0)
+        {
+            g_queue_unlink (&cache->unused, &entry->link);
+            cache->unused_bytes -= entry->size;
+        }
+
+        return entry;
+    }
+
+    cache->misses++;
+    entry = g_new0 (FramePixmapEntry, 1);
+    entry->key = key;
+    entry->ref_count = 1;
+    entry->link.data = entry;
+    xfwmPixmapCreate (screen_info, &entry->pm, width, height);
+    xfwmPixmapFill (&screen_info->sides[side][state], &entry->pm, 0, 0, width, height);
+    if (!xfwmPixmapNone (&entry->pm))
+    {
+        /* Color pixmap and its 1 bit mask */
+        entry->size = (gsize) width * height * ((screen_info->depth + 7) / 8) +
+                      (gsize) ((width + 7) / 8) * height;
+    }
+    cache->bytes += entry->size;
+    g_hash_table_insert (cache->entries, &entry->key, entry);
+
+    DBG ("pixmap cache: %u hits, %u misses, %" G_GSIZE_FORMAT " bytes (%" G_GSIZE_FORMAT " unused)",
+         cache->hits, cache->misses, cache->bytes, cache->unused_bytes);
+
+    return entry;
+}
+
+static void
+framePixmapRelease (ScreenInfo *screen_info, FramePixmapEntry *entry)
+{
+    FramePixmapCache *cache;
+
+    cache = screen_info->pixmap_cache;
+    g_return_if_fail (cache != NULL);
+    g_return_if_fail (entry->ref_count > 0);
+
+    if (--entry->ref_count > 0)
+    {
+        return;
+    }
+
+    if (entry->key.generation != cache->generation)
+    {
+        /* From a previous theme, nobody will ask for it again */
+        g_hash_table_remove (cache->entries, &entry->key);
+        pixmapCacheEntryFree (cache, entry);
+        return;
+    }
+
+    g_queue_push_head_link (&cache->unused, &entry->link);
+    cache->unused_bytes += entry->size;
+    pixmapCacheTrim (cache, PIXMAP_CACHE_MAX_BYTES);
+}
+
+void
+frameClearPixmapCache (ScreenInfo *screen_info)
+{
+    FramePixmapCache *cache;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    cache = screen_info->pixmap_cache;
+    if (!cache)
+    {
+        return;
+    }
+
+    /* Pixmaps still shown are freed when their frames let go of them */
+    cache->generation++;
+    pixmapCacheTrim (cache, 0);
+
+    if (g_hash_table_size (cache->entries) == 0)
+    {
+        g_hash_table_destroy (cache->entries);
+        g_free (cache);
+        screen_info->pixmap_cache = NULL;
+    }
+}
+
+void
+frameDumpPixmapCacheStats (ScreenInfo *screen_info)
+{
+    FramePixmapCache *cache;
+    guint lookups;
+
+    g_return_if_fail (screen_info != NULL);
+
+    cache = screen_info->pixmap_cache;
+    if (!cache)
+    {
+        g_print ("Screen %i side pixmap cache: empty\n", screen_info->screen);
+        return;
+    }
+
+    lookups = cache->hits + cache->misses;
+    g_print ("Screen %i side pixmap cache: %u hits, %u misses (%.1f%% hits), "
+             "%u pixmaps, %" G_GSIZE_FORMAT " bytes (%" G_GSIZE_FORMAT " unused)\n",
+             screen_info->screen, cache->hits, cache->misses,
+             100.0 * cache->hits / MAX (lookups, 1), g_hash_table_size (cache->entries),
+             cache->bytes, cache->unused_bytes);
+}
+
+void
+frameReleasePixmaps (Client * c)
+{
+    int i;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        if (c->frame_pixmaps[i])
+        {
+            framePixmapRelease (c->screen_info, c->frame_pixmaps[i]);
+            c->frame_pixmaps[i] = NULL;
+        }
+    }
+}
+
+/* Replace the side pixmap held by the frame, returns the one to use */
+static xfwmPixmap *
+frameUpdateSidePixmap (Client * c, int side, int state, int width, int height)
+{
+    FramePixmapEntry *entry;
+
+    entry = framePixmapAcquire (c->screen_info, side, state, width, height);
+    if (c->frame_pixmaps[side])
+    {
+        framePixmapRelease (c->screen_info, c->frame_pixmaps[side]);
+    }
+    c->frame_pixmaps[side] = entry;
+
+    return &entry->pm;
+}
+
 static void
 frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap * title_pm, xfwmPixmap * top_pm)
 {
@@ -196,14 +770,7 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
         voffset = screen_info->params->title_vertical_offset_inactive;
     }
 
-    layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), c->name);
-    pango_layout_set_font_description (layout, myScreenGetFontDescription (screen_info));
-    pango_layout_set_auto_dir (layout, FALSE);
-    if (screen_info->pango_attr_list != NULL)
-    {
-        pango_layout_set_attributes (layout, screen_info->pango_attr_list);
-    }
-    pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+    layout = frameGetTitleLayout (screen_info, c->name, &logical_rect);
 
     title_height = logical_rect.height;
     title_y = voffset + (frameDecorationTop(screen_info) - title_height) / 2;
@@ -349,7 +916,6 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     }
     cairo_destroy (cr);
     cairo_surface_destroy (surface);
-    g_object_unref (G_OBJECT (layout));
 }
 
 static int
@@ -455,13 +1021,311 @@ getLetterFromButton (int i, Client * c)
     return chr;
 }
 
+/*
+ * Only a button changed, update the frame shape around that button
+ * instead of building it again from all the frame parts.
+ */
 static void
-frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTTON_COUNT])
+frameSetButtonShape (Client * c, int state, int button, int button_x)
 {
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
     XRectangle rect;
     xfwmPixmap *my_pixmap;
+    int y;
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    my_pixmap = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
+    XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->buttons[button]),
+                       ShapeBounding, 0, 0, my_pixmap->mask, ShapeSet);
+
+    /* Same mask in all the theme states, the frame shape stays as it is */
+    if ((screen_info->button_same_mask[button]) &&
+        (my_pixmap >= &screen_info->buttons[button][0]) &&
+        (my_pixmap < &screen_info->buttons[button][STATE_COUNT]))
+    {
+        return;
+    }
+
+    y = (frameTop (c) - screen_info->buttons[button][state].height + 1) / 2;
+    rect.x = button_x;
+    rect.y = y;
+    rect.width = screen_info->buttons[button][state].width;
+    rect.height = screen_info->buttons[button][state].height;
+    XShapeCombineRectangles (display_info->dpy, c->frame, ShapeBounding, 0, 0,
+                             &rect, 1, ShapeSubtract, Unsorted);
+
+    /* Put back the parts the button may overlap */
+    if (xfwmWindowVisible (&c->title))
+    {
+        XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding,
+                            frameTopLeftWidth (c, state), 0,
+                            MYWINDOW_XWINDOW (c->title), ShapeBounding, ShapeUnion);
+    }
+    if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
+    {
+        XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding,
+                            screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                            frameTop (c) - frameBottom (c),
+                            MYWINDOW_XWINDOW (c->sides[SIDE_TOP]), ShapeBounding, ShapeUnion);
+    }
+    if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
+    {
+        XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0,
+                            MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]), ShapeBounding, ShapeUnion);
+    }
+    if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
+    {
+        XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding,
+                            frameWidth (c) - frameTopRightWidth (c, state),
+                            0, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]), ShapeBounding, ShapeUnion);
+    }
+    XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, button_x, y,
+                        MYWINDOW_XWINDOW (c->buttons[button]), ShapeBounding, ShapeUnion);
+}
+
+/* Shape the part windows with the masks of what they show */
+static void
+frameSetPartShapes (Client * c, int state, FramePixmap * frame_pix, guint dirty)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    XRectangle rect;
+    xfwmPixmap *my_pixmap;
+    int i;
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    if (dirty & FRAME_PART_TITLE)
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->title), ShapeBounding,
+                           0, 0, frame_pix->pm_title.mask, ShapeSet);
+    }
+    if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+    {
+        if (xfwmWindowVisible (&c->sides[SIDE_LEFT]) && frame_pix->pm_sides[SIDE_LEFT])
+        {
+            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]),
+                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_LEFT]->mask, ShapeSet);
+        }
+
+        if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]) && frame_pix->pm_sides[SIDE_RIGHT])
+        {
+            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]),
+                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_RIGHT]->mask, ShapeSet);
+        }
+    }
+
+    if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]) && frame_pix->pm_sides[SIDE_BOTTOM])
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]),
+                           ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_BOTTOM]->mask, ShapeSet);
+    }
+
+    if ((dirty & FRAME_PART_TITLE) && xfwmWindowVisible (&c->sides[SIDE_TOP]))
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_TOP]),
+                           ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_TOP]->mask, ShapeSet);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
+                           ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_LEFT][state].mask, ShapeSet);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
+                           ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_RIGHT][state].mask, ShapeSet);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
+                           ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_LEFT][state].mask, ShapeSet);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
+    {
+        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
+                           ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_RIGHT][state].mask, ShapeSet);
+    }
+
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if ((dirty & FRAME_PART_BUTTON (i)) && xfwmWindowVisible (&c->buttons[i]))
+        {
+            my_pixmap = clientGetButtonPixmap (c, i, clientGetButtonState (c, i, state));
+            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->buttons[i]),
+                               ShapeBounding, 0, 0, my_pixmap->mask, ShapeSet);
+        }
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]) &&
+        (screen_info->corners[CORNER_TOP_LEFT][state].height > frameHeight (c) - frameBottom (c) + 1))
+    {
+        rect.x      = 0;
+        rect.y      = frameHeight (c) - frameBottom (c) + 1;
+        rect.width  = frameTopLeftWidth (c, state);
+        rect.height = screen_info->corners[CORNER_TOP_LEFT][state].height
+                       - (frameHeight (c) - frameBottom (c) + 1);
+        XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
+                                 ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]) &&
+        (screen_info->corners[CORNER_TOP_RIGHT][state].height > frameHeight (c) - frameBottom (c) + 1))
+    {
+        rect.x      = 0;
+        rect.y      = frameHeight (c) - frameBottom (c) + 1;
+        rect.width  = frameTopRightWidth (c, state);
+        rect.height = screen_info->corners[CORNER_TOP_RIGHT][state].height
+                       - (frameHeight (c) - frameBottom (c) + 1);
+        XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
+                                 ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]) &&
+        (screen_info->corners[CORNER_BOTTOM_LEFT][state].height > frameHeight (c) - frameTop (c) + 1))
+    {
+        rect.x      = 0;
+        rect.y      = 0;
+        rect.width  = screen_info->corners[CORNER_BOTTOM_LEFT][state].width;
+        rect.height = screen_info->corners[CORNER_BOTTOM_LEFT][state].height
+                       - (frameHeight (c) - frameTop (c) + 1);
+        XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
+                                 ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
+    }
+
+    if ((dirty & (FRAME_PART_CORNERS | FRAME_PART_SHAPE)) &&
+        xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]) &&
+        (screen_info->corners[CORNER_BOTTOM_RIGHT][state].height > frameHeight (c) - frameTop (c) + 1))
+    {
+        rect.x      = 0;
+        rect.y      = 0;
+        rect.width  = screen_info->corners[CORNER_BOTTOM_RIGHT][state].width;
+        rect.height = screen_info->corners[CORNER_BOTTOM_RIGHT][state].height
+                       - (frameHeight (c) - frameTop (c) + 1);
+        XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
+                                 ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
+    }
+}
+
+/* Add the shapes of the part windows to the given window */
+static void
+frameUnionPartShapes (Client * c, int state, Window shape_win, int button_x[BUTTON_COUNT])
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    int i;
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+    {
+        if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
+        {
+            XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, 0, frameTop (c),
+                                MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
+        {
+            XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, frameWidth (c) - frameRight (c), frameTop (c),
+                                MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]), ShapeBounding, ShapeUnion);
+        }
+    }
+
+    if (xfwmWindowVisible (&c->title))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding,
+                            frameTopLeftWidth (c, state), 0,
+                            MYWINDOW_XWINDOW (c->title), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
+    {
+
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, 0, 0,
+                            MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding,
+                            screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                            frameHeight (c) - frameBottom (c),
+                            MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding,
+                            screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                            frameTop (c) - frameBottom (c),
+                            MYWINDOW_XWINDOW (c->sides[SIDE_TOP]), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, 0,
+                            frameHeight (c) - screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
+                            MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding,
+                            frameWidth (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
+                            frameHeight (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
+                            MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]), ShapeBounding, ShapeUnion);
+    }
+
+    if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
+    {
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding,
+                            frameWidth (c) - frameTopRightWidth (c, state),
+                            0, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]), ShapeBounding, ShapeUnion);
+    }
+
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if (xfwmWindowVisible (&c->buttons[i]))
+        {
+            XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, button_x[i],
+                                (frameTop (c) - screen_info->buttons[i][state].height + 1) / 2,
+                                MYWINDOW_XWINDOW (c->buttons[i]), ShapeBounding, ShapeUnion);
+        }
+    }
+}
+
+/*
+ * The frame shape only depends on what frameSaveDrawState() records, for
+ * clients without a shape of their own. Such shapes are kept per screen
+ * so frames already drawn the same way get theirs in one request, and
+ * none at all when it is the shape they already have.
+ */
+static void
+frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTTON_COUNT], guint dirty)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    FrameDrawState *drawn;
+    ShapeCacheEntry *entry, *new_entry;
+    XRectangle rect;
+    Window shape_win;
     int i;
 
     g_return_if_fail (c != NULL);
@@ -469,19 +1333,66 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
 
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
+    drawn = c->frame_state;
 
     if (!display_info->have_shape)
     {
         return;
     }
 
-    if (screen_info->shape_win == None)
+    if ((frame_pix) && !(frame_pix->pm_frame) && !(dirty & ~FRAME_PART_BUTTONS))
     {
-        screen_info->shape_win = XCreateSimpleWindow (display_info->dpy, screen_info->xroot, 0, 0, frameWidth (c), frameHeight (c), 0, 0, 0);
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            if ((dirty & FRAME_PART_BUTTON (i)) && xfwmWindowVisible (&c->buttons[i]))
+            {
+                frameSetButtonShape (c, state, i, button_x[i]);
+                if (drawn)
+                {
+                    drawn->shape_serial = 0;
+                }
+            }
+        }
+        return;
+    }
+
+    if ((frame_pix) && !(frame_pix->pm_frame))
+    {
+        frameSetPartShapes (c, state, frame_pix, dirty);
+    }
+
+    /*
+     * An interactive resize goes through a new size at every step, caching
+     * these would only churn the cache and its server side windows.
+     */
+    new_entry = NULL;
+    if ((frame_pix) && (drawn) && (drawn->valid) && !FLAG_TEST (c->flags, CLIENT_FLAG_HAS_SHAPE) &&
+        !FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING))
+    {
+        entry = frameGetCachedShape (screen_info, drawn, &new_entry);
+        if (entry)
+        {
+            if (drawn->shape_serial != entry->serial)
+            {
+                XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0,
+                                    entry->shape_win, ShapeBounding, ShapeSet);
+                drawn->shape_serial = entry->serial;
+            }
+            return;
+        }
+        shape_win = new_entry->shape_win;
     }
     else
     {
-        XResizeWindow (display_info->dpy, screen_info->shape_win, frameWidth (c), frameHeight (c));
+        if (screen_info->shape_win == None)
+        {
+            screen_info->shape_win = XCreateSimpleWindow (display_info->dpy, screen_info->xroot, 0, 0, frameWidth (c), frameHeight (c), 0, 0, 0);
+        }
+        else
+        {
+            XResizeWindow (display_info->dpy, screen_info->shape_win, frameWidth (c), frameHeight (c));
+        }
+        shape_win = screen_info->shape_win;
     }
 
     if (FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
@@ -490,7 +1401,7 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
         rect.y = 0;
         rect.width  = frameWidth (c);
         rect.height = frameHeight (c);
-        XShapeCombineRectangles (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, Unsorted);
+        XShapeCombineRectangles (display_info->dpy, shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, Unsorted);
     }
     else if (!FLAG_TEST (c->flags, CLIENT_FLAG_HAS_SHAPE))
     {
@@ -498,221 +1409,290 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
         rect.y = frameTop (c);
         rect.width  = c->width;
         rect.height = c->height;
-        XShapeCombineRectangles (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeSet, Unsorted);
+        XShapeCombineRectangles (display_info->dpy, shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeSet, Unsorted);
     }
     else
     {
-        XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, frameLeft (c),
+        XShapeCombineShape (display_info->dpy, shape_win, ShapeBounding, frameLeft (c),
                             frameTop (c), c->window, ShapeBounding, ShapeSet);
     }
-    if (frame_pix)
+    if ((frame_pix) && (frame_pix->pm_frame))
     {
-        XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->title), ShapeBounding,
-                           0, 0, frame_pix->pm_title.mask, ShapeSet);
-        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
-        {
-            if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
-            {
-                XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]),
-                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_LEFT].mask, ShapeSet);
-            }
+        /* The mask of the composed decoration has all the parts already */
+        XShapeCombineMask (display_info->dpy, shape_win, ShapeBounding,
+                           0, 0, frame_pix->pm_frame->mask, ShapeUnion);
+    }
+    else if (frame_pix)
+    {
+        frameUnionPartShapes (c, state, shape_win, button_x);
+    }
+    rect.x = 0;
+    rect.y = 0;
+    rect.width  = frameWidth (c);
+    rect.height = frameHeight (c);
+    XShapeCombineRectangles (display_info->dpy, shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeIntersect, Unsorted);
+    XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0, shape_win, ShapeBounding, ShapeSet);
 
-            if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
-            {
-                XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]),
-                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_RIGHT].mask, ShapeSet);
-            }
-        }
+    if (drawn)
+    {
+        drawn->shape_serial = (new_entry ? new_entry->serial : 0);
+    }
+}
 
-        if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
-        {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]),
-                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_BOTTOM].mask, ShapeSet);
-        }
+static FrameDrawState *
+frameGetDrawState (Client * c)
+{
+    if (!c->frame_state)
+    {
+        c->frame_state = g_new0 (FrameDrawState, 1);
+    }
 
-        if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
-        {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_TOP]),
-                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_TOP].mask, ShapeSet);
-        }
+    return c->frame_state;
+}
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
-        {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_LEFT][state].mask, ShapeSet);
-        }
+/*
+ * Compare what is about to be drawn with what was drawn last time and
+ * return the parts of the frame that need updating.
+ */
+static guint
+frameGetDirtyParts (Client * c, FrameDrawState *drawn, int state, int left, int right,
+                    Pixmap button_pixmap[BUTTON_COUNT], int button_x[BUTTON_COUNT])
+{
+    unsigned long shape_flags;
+    guint dirty;
+    int i;
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
-        {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_RIGHT][state].mask, ShapeSet);
-        }
+    if (!drawn->valid || (drawn->state != state))
+    {
+        return FRAME_PART_ALL;
+    }
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
+    dirty = 0;
+    shape_flags = c->flags & (CLIENT_FLAG_SHADED | CLIENT_FLAG_MAXIMIZED | CLIENT_FLAG_HAS_SHAPE);
+    if (shape_flags != drawn->flags)
+    {
+        dirty |= FRAME_PART_TITLE | FRAME_PART_SIDES | FRAME_PART_CORNERS | FRAME_PART_SHAPE;
+    }
+    if (drawn->width != frameWidth (c))
+    {
+        dirty |= FRAME_PART_TITLE | FRAME_PART_SIDES | FRAME_PART_SHAPE;
+    }
+    if (drawn->height != frameHeight (c))
+    {
+        dirty |= FRAME_PART_SIDES | FRAME_PART_SHAPE;
+    }
+    if ((drawn->left != left) || (drawn->right != right) ||
+        (g_strcmp0 (drawn->title, c->name) != 0))
+    {
+        dirty |= FRAME_PART_TITLE;
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if (drawn->button_x[i] != button_x[i])
         {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_LEFT][state].mask, ShapeSet);
+            dirty |= FRAME_PART_BUTTON (i) | FRAME_PART_TITLE | FRAME_PART_SHAPE;
         }
-
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
+        else if (drawn->button_pixmap[i] != button_pixmap[i])
         {
-            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_RIGHT][state].mask, ShapeSet);
+            dirty |= FRAME_PART_BUTTON (i);
         }
+    }
 
-        for (i = 0; i < BUTTON_COUNT; i++)
-        {
-            if (xfwmWindowVisible (&c->buttons[i]))
-            {
-                my_pixmap = clientGetButtonPixmap (c, i, clientGetButtonState (c, i, state));
-                XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->buttons[i]),
-                                   ShapeBounding, 0, 0, my_pixmap->mask, ShapeSet);
-            }
-        }
+    return dirty;
+}
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]) &&
-            (screen_info->corners[CORNER_TOP_LEFT][state].height > frameHeight (c) - frameBottom (c) + 1))
-        {
-            rect.x      = 0;
-            rect.y      = frameHeight (c) - frameBottom (c) + 1;
-            rect.width  = frameTopLeftWidth (c, state);
-            rect.height = screen_info->corners[CORNER_TOP_LEFT][state].height
-                           - (frameHeight (c) - frameBottom (c) + 1);
-            XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
-                                     ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
-        }
+static void
+frameSaveDrawState (Client * c, FrameDrawState *drawn, int state, int left, int right,
+                    Pixmap button_pixmap[BUTTON_COUNT], int button_x[BUTTON_COUNT])
+{
+    int i;
+
+    drawn->valid = TRUE;
+    drawn->state = state;
+    drawn->flags = c->flags & (CLIENT_FLAG_SHADED | CLIENT_FLAG_MAXIMIZED | CLIENT_FLAG_HAS_SHAPE);
+    drawn->width = frameWidth (c);
+    drawn->height = frameHeight (c);
+    drawn->left = left;
+    drawn->right = right;
+    if (g_strcmp0 (drawn->title, c->name) != 0)
+    {
+        g_free (drawn->title);
+        drawn->title = g_strdup (c->name);
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        drawn->button_pixmap[i] = button_pixmap[i];
+        drawn->button_x[i] = button_x[i];
+    }
+}
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]) &&
-            (screen_info->corners[CORNER_TOP_RIGHT][state].height > frameHeight (c) - frameBottom (c) + 1))
-        {
-            rect.x      = 0;
-            rect.y      = frameHeight (c) - frameBottom (c) + 1;
-            rect.width  = frameTopRightWidth (c, state);
-            rect.height = screen_info->corners[CORNER_TOP_RIGHT][state].height
-                           - (frameHeight (c) - frameBottom (c) + 1);
-            XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
-                                     ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
-        }
+void
+frameFree (Client * c)
+{
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]) &&
-            (screen_info->corners[CORNER_BOTTOM_LEFT][state].height > frameHeight (c) - frameTop (c) + 1))
-        {
-            rect.x      = 0;
-            rect.y      = 0;
-            rect.width  = screen_info->corners[CORNER_BOTTOM_LEFT][state].width;
-            rect.height = screen_info->corners[CORNER_BOTTOM_LEFT][state].height
-                           - (frameHeight (c) - frameTop (c) + 1);
-            XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
-                                     ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
-        }
+    frameReleasePixmaps (c);
+    if (c->frame_state)
+    {
+        g_free (c->frame_state->title);
+        g_free (c->frame_state);
+        c->frame_state = NULL;
+    }
+}
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]) &&
-            (screen_info->corners[CORNER_BOTTOM_RIGHT][state].height > frameHeight (c) - frameTop (c) + 1))
-        {
-            rect.x      = 0;
-            rect.y      = 0;
-            rect.width  = screen_info->corners[CORNER_BOTTOM_RIGHT][state].width;
-            rect.height = screen_info->corners[CORNER_BOTTOM_RIGHT][state].height
-                           - (frameHeight (c) - frameTop (c) + 1);
-            XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
-                                     ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
-        }
+/*
+ * Single window frame: all the parts are composed in one pixmap used as
+ * the frame background, so whatever changed costs one background update
+ * and one shape update instead of one per part window.
+ */
+static void
+frameDrawSingleWin (Client * c, int state, int left, int right,
+                    xfwmPixmap *button_pm[BUTTON_COUNT], int button_x[BUTTON_COUNT], guint dirty)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    FrameDrawState *drawn;
+    FramePixmap frame_pix;
+    xfwmPixmap frame_pm;
+    xfwmPixmap *corner_pm;
+    xfwmWindow frame_win;
+    gint i, h, top_width, bottom_width, left_height, right_height;
 
-        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
-        {
-            if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, frameTop (c),
-                                    MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]), ShapeBounding, ShapeUnion);
-            }
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-            if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, frameWidth (c) - frameRight (c), frameTop (c),
-                                    MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]), ShapeBounding, ShapeUnion);
-            }
-        }
+    if (!dirty)
+    {
+        return;
+    }
 
-        if (xfwmWindowVisible (&c->title))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameTopLeftWidth (c, state), 0,
-                                MYWINDOW_XWINDOW (c->title), ShapeBounding, ShapeUnion);
-        }
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+    drawn = frameGetDrawState (c);
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
-        {
+    xfwmPixmapCreate (screen_info, &frame_pm, frameWidth (c), frameHeight (c));
+    if (xfwmPixmapNone (&frame_pm))
+    {
+        return;
+    }
+    xfwmPixmapClear (&frame_pm);
 
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]), ShapeBounding, ShapeUnion);
-        }
+    top_width = frameWidth (c) - frameTopLeftWidth (c, state) - frameTopRightWidth (c, state);
+    bottom_width = frameWidth (c) -
+        screen_info->corners[CORNER_BOTTOM_LEFT][state].width -
+        screen_info->corners[CORNER_BOTTOM_RIGHT][state].width;
+    left_height = frameHeight (c) - frameTop (c) -
+        screen_info->corners[CORNER_BOTTOM_LEFT][state].height;
+    right_height = frameHeight (c) - frameTop (c) -
+        screen_info->corners[CORNER_BOTTOM_RIGHT][state].height;
 
-        if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                                frameHeight (c) - frameBottom (c),
-                                MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]), ShapeBounding, ShapeUnion);
-        }
+    xfwmPixmapInit (screen_info, &frame_pix.pm_title);
+    xfwmPixmapInit (screen_info, &frame_pix.pm_top);
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        frame_pix.pm_sides[i] = NULL;
+    }
+    frame_pix.pm_frame = &frame_pm;
 
-        if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
+    /* Parts are drawn in the stacking order of the part windows */
+    if (!(FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
+          && (screen_info->params->borderless_maximize)))
+    {
+        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
         {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                                frameTop (c) - frameBottom (c),
-                                MYWINDOW_XWINDOW (c->sides[SIDE_TOP]), ShapeBounding, ShapeUnion);
+            frame_pix.pm_sides[SIDE_LEFT] =
+                frameUpdateSidePixmap (c, SIDE_LEFT, state, frameLeft (c), left_height);
+            xfwmPixmapCopy (frame_pix.pm_sides[SIDE_LEFT], &frame_pm, 0, 0,
+                            0, frameTop (c), frameLeft (c), left_height);
+
+            frame_pix.pm_sides[SIDE_RIGHT] =
+                frameUpdateSidePixmap (c, SIDE_RIGHT, state, frameRight (c), right_height);
+            xfwmPixmapCopy (frame_pix.pm_sides[SIDE_RIGHT], &frame_pm, 0, 0,
+                            frameWidth (c) - frameRight (c), frameTop (c),
+                            frameRight (c), right_height);
         }
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
+        frame_pix.pm_sides[SIDE_BOTTOM] =
+            frameUpdateSidePixmap (c, SIDE_BOTTOM, state, bottom_width, frameBottom (c));
+        xfwmPixmapCopy (frame_pix.pm_sides[SIDE_BOTTOM], &frame_pm, 0, 0,
+                        screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                        frameHeight (c) - frameBottom (c), bottom_width, frameBottom (c));
+
+        /* Top corners stop above the bottom border, as done by frameSetShape() */
+        h = MIN (screen_info->corners[CORNER_TOP_LEFT][state].height,
+                 frameHeight (c) - frameBottom (c) + 1);
+        xfwmPixmapCopy (&screen_info->corners[CORNER_TOP_LEFT][state], &frame_pm, 0, 0,
+                        0, 0, frameTopLeftWidth (c, state), h);
+
+        h = MIN (screen_info->corners[CORNER_TOP_RIGHT][state].height,
+                 frameHeight (c) - frameBottom (c) + 1);
+        xfwmPixmapCopy (&screen_info->corners[CORNER_TOP_RIGHT][state], &frame_pm, 0, 0,
+                        frameWidth (c) - frameTopRightWidth (c, state), 0,
+                        frameTopRightWidth (c, state), h);
+
+        /* and bottom corners start below the title */
+        corner_pm = &screen_info->corners[CORNER_BOTTOM_LEFT][state];
+        h = MIN (corner_pm->height, frameHeight (c) - frameTop (c) + 1);
+        xfwmPixmapCopy (corner_pm, &frame_pm, 0, corner_pm->height - h,
+                        0, frameHeight (c) - h, corner_pm->width, h);
+
+        corner_pm = &screen_info->corners[CORNER_BOTTOM_RIGHT][state];
+        h = MIN (corner_pm->height, frameHeight (c) - frameTop (c) + 1);
+        xfwmPixmapCopy (corner_pm, &frame_pm, 0, corner_pm->height - h,
+                        frameWidth (c) - corner_pm->width, frameHeight (c) - h,
+                        corner_pm->width, h);
+    }
+
+    frameCreateTitlePixmap (c, state, left, right, &frame_pix.pm_title, &frame_pix.pm_top);
+    drawn->top_height = frame_pix.pm_top.height;
+    xfwmPixmapCopy (&frame_pix.pm_title, &frame_pm, 0, 0,
+                    frameTopLeftWidth (c, state), 0 - frameBorderTop (c),
+                    top_width, frameDecorationTop (screen_info));
+    if (!(FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
+          && (screen_info->params->borderless_maximize)))
+    {
+        xfwmPixmapCopy (&frame_pix.pm_top, &frame_pm, 0, 0,
+                        screen_info->corners[CORNER_TOP_LEFT][state].width, 0,
+                        top_width, frame_pix.pm_top.height);
+    }
+
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if ((button_pm[i]) && !xfwmPixmapNone (button_pm[i]))
         {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0,
-                                frameHeight (c) - screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]), ShapeBounding, ShapeUnion);
+            xfwmPixmapCopy (button_pm[i], &frame_pm, 0, 0, button_x[i],
+                ((frameDecorationTop (screen_info) - screen_info->buttons[i][state].height + 1) / 2) - frameBorderTop (c),
+                screen_info->buttons[i][state].width,
+                screen_info->buttons[i][state].height);
         }
+    }
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameWidth (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
-                                frameHeight (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]), ShapeBounding, ShapeUnion);
-        }
+    xfwmWindowAttach (screen_info, c->visual, c->depth, c->frame, &frame_win,
+                      frameWidth (c), frameHeight (c));
+    xfwmWindowSetBG (&frame_win, &frame_pm);
+    XClearWindow (display_info->dpy, c->frame);
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameWidth (c) - frameTopRightWidth (c, state),
-                                0, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]), ShapeBounding, ShapeUnion);
-        }
+    frameSetShape (c, state, &frame_pix, button_x, dirty);
 
-        for (i = 0; i < BUTTON_COUNT; i++)
-        {
-            if (xfwmWindowVisible (&c->buttons[i]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, button_x[i],
-                                    (frameTop (c) - screen_info->buttons[i][state].height + 1) / 2,
-                                    MYWINDOW_XWINDOW (c->buttons[i]), ShapeBounding, ShapeUnion);
-            }
-        }
-    }
-    rect.x = 0;
-    rect.y = 0;
-    rect.width  = frameWidth (c);
-    rect.height = frameHeight (c);
-    XShapeCombineRectangles (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeIntersect, Unsorted);
-    XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0, screen_info->shape_win, ShapeBounding, ShapeSet);
+    xfwmPixmapFree (&frame_pix.pm_title);
+    xfwmPixmapFree (&frame_pix.pm_top);
+    xfwmPixmapFree (&frame_pm);
 }
 
 static void
 frameDrawWin (Client * c)
 {
     ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    FrameDrawState *drawn;
     FramePixmap frame_pix;
     xfwmPixmap *my_pixmap;
+    xfwmPixmap *button_pm[BUTTON_COUNT];
+    Pixmap button_pixmap[BUTTON_COUNT];
     gint state, x, button, left, right;
     gint top_width, bottom_width, left_height, right_height;
     gint button_x[BUTTON_COUNT];
-    guint i, j;
+    guint i, j, dirty;
     gboolean requires_clearing;
     gboolean width_changed;
     gboolean height_changed;
@@ -723,11 +1703,15 @@ frameDrawWin (Client * c)
     frameClearQueueDraw (c);
 
     screen_info = c->screen_info;
+    display_info = screen_info->display_info;
     requires_clearing = FALSE;
     width_changed = FALSE;
     height_changed = FALSE;
     state = ACTIVE;
 
+    /* Account the X requests of each frame update */
+    myDisplayPushRequestTag (display_info, G_STRFUNC);
+
     if (c != clientGetFocus ())
     {
         TRACE ("\"%s\" is not the active window", c->name);
@@ -788,17 +1772,14 @@ frameDrawWin (Client * c)
 
     if (CLIENT_HAS_FRAME (c))
     {
-        /* First, hide the buttons that we don't have... */
         for (i = 0; i < BUTTON_COUNT; i++)
         {
-            char b = getLetterFromButton (i, c);
-            if ((!b) || !strchr (screen_info->params->button_layout, b))
-            {
-                xfwmWindowHide (&c->buttons[i]);
-            }
+            button_pm[i] = NULL;
+            button_pixmap[i] = None;
+            button_x[i] = -1;
         }
 
-        /* Then, show the ones that we do have on left... */
+        /* First, find the buttons that we do have on left... */
         x = frameLeft (c) + frameButtonOffset (c);
         if (x < 0)
         {
@@ -816,23 +1797,11 @@ frameDrawWin (Client * c)
             {
                 if (x + screen_info->buttons[button][state].width + screen_info->params->button_spacing < right)
                 {
-                    my_pixmap = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
-                    if (!xfwmPixmapNone(my_pixmap))
-                    {
-                        xfwmWindowSetBG (&c->buttons[button], my_pixmap);
-                    }
-                    xfwmWindowShow (&c->buttons[button], x,
-                        ((frameDecorationTop(screen_info) - screen_info->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
-                        screen_info->buttons[button][state].width,
-                        screen_info->buttons[button][state].height, TRUE);
+                    button_pm[button] = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
                     button_x[button] = x;
                     x = x + screen_info->buttons[button][state].width +
                         screen_info->params->button_spacing;
                 }
-                else
-                {
-                    xfwmWindowHide (&c->buttons[button]);
-                }
             }
         }
         left = x + screen_info->params->button_spacing;
@@ -851,28 +1820,72 @@ frameDrawWin (Client * c)
             {
                 if (x - screen_info->buttons[button][state].width - screen_info->params->button_spacing > left)
                 {
-                    my_pixmap = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
-                    if (!xfwmPixmapNone(my_pixmap))
-                    {
-                        xfwmWindowSetBG (&c->buttons[button], my_pixmap);
-                    }
+                    button_pm[button] = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
                     x = x - screen_info->buttons[button][state].width -
                         screen_info->params->button_spacing;
-                    xfwmWindowShow (&c->buttons[button], x,
-                        ((frameDecorationTop(screen_info) - screen_info->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
-                        screen_info->buttons[button][state].width,
-                        screen_info->buttons[button][state].height, TRUE);
                     button_x[button] = x;
                 }
-                else
-                {
-                    xfwmWindowHide (&c->buttons[button]);
-                }
             }
         }
         left = left - 2 * screen_info->params->button_spacing;
         right = x;
 
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            if (button_pm[i])
+            {
+                button_pixmap[i] = button_pm[i]->pixmap;
+            }
+        }
+
+        drawn = frameGetDrawState (c);
+        dirty = frameGetDirtyParts (c, drawn, state, left, right, button_pixmap, button_x);
+        if (requires_clearing)
+        {
+            dirty = FRAME_PART_ALL;
+        }
+        if (width_changed)
+        {
+            dirty |= FRAME_PART_TITLE | FRAME_PART_SIDES | FRAME_PART_SHAPE;
+        }
+        if (height_changed)
+        {
+            dirty |= FRAME_PART_SIDES | FRAME_PART_SHAPE;
+        }
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_NEEDS_RESHAPE))
+        {
+            FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_NEEDS_RESHAPE);
+            dirty |= FRAME_PART_SHAPE;
+        }
+        frameSaveDrawState (c, drawn, state, left, right, button_pixmap, button_x);
+        TRACE ("dirty parts 0x%x", dirty);
+
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+        {
+            frameDrawSingleWin (c, state, left, right, button_pm, button_x, dirty);
+            myDisplayPopRequestTag (display_info);
+            return;
+        }
+
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            if (!button_pm[i])
+            {
+                xfwmWindowHide (&c->buttons[i]);
+                continue;
+            }
+
+            my_pixmap = button_pm[i];
+            if ((dirty & FRAME_PART_BUTTON (i)) && !xfwmPixmapNone(my_pixmap))
+            {
+                xfwmWindowSetBG (&c->buttons[i], my_pixmap);
+            }
+            xfwmWindowShow (&c->buttons[i], button_x[i],
+                ((frameDecorationTop(screen_info) - screen_info->buttons[i][state].height + 1) / 2) - frameBorderTop (c),
+                screen_info->buttons[i][state].width,
+                screen_info->buttons[i][state].height, (dirty & FRAME_PART_BUTTON (i)));
+        }
+
         top_width = frameWidth (c) - frameTopLeftWidth (c, state) - frameTopRightWidth (c, state);
         bottom_width = frameWidth (c) -
             screen_info->corners[CORNER_BOTTOM_LEFT][state].width -
@@ -883,20 +1896,26 @@ frameDrawWin (Client * c)
             screen_info->corners[CORNER_BOTTOM_RIGHT][state].height;
 
         xfwmPixmapInit (screen_info, &frame_pix.pm_title);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_TOP]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_BOTTOM]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_LEFT]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_RIGHT]);
+        xfwmPixmapInit (screen_info, &frame_pix.pm_top);
+        frame_pix.pm_sides[SIDE_TOP] = &frame_pix.pm_top;
+        frame_pix.pm_sides[SIDE_BOTTOM] = NULL;
+        frame_pix.pm_sides[SIDE_LEFT] = NULL;
+        frame_pix.pm_sides[SIDE_RIGHT] = NULL;
+        frame_pix.pm_frame = NULL;
 
         /* The title is always visible */
-        frameCreateTitlePixmap (c, state, left, right, &frame_pix.pm_title, &frame_pix.pm_sides[SIDE_TOP]);
-        xfwmWindowSetBG (&c->title, &frame_pix.pm_title);
+        if (dirty & FRAME_PART_TITLE)
+        {
+            frameCreateTitlePixmap (c, state, left, right, &frame_pix.pm_title, &frame_pix.pm_top);
+            drawn->top_height = frame_pix.pm_top.height;
+            xfwmWindowSetBG (&c->title, &frame_pix.pm_title);
+        }
         xfwmWindowShow (&c->title,
             frameTopLeftWidth (c, state), 0 - frameBorderTop (c), top_width,
-            frameDecorationTop(screen_info), (requires_clearing | width_changed));
+            frameDecorationTop(screen_info), (dirty & FRAME_PART_TITLE));
 
         /* Corners are never resized, we need to update them separately */
-        if (requires_clearing)
+        if (dirty & FRAME_PART_CORNERS)
         {
             xfwmWindowSetBG (&c->corners[CORNER_TOP_LEFT],
                 &screen_info->corners[CORNER_TOP_LEFT][state]);
@@ -927,72 +1946,69 @@ frameDrawWin (Client * c)
                 xfwmWindowHide (&c->sides[SIDE_LEFT]);
                 xfwmWindowHide (&c->sides[SIDE_RIGHT]);
             }
-            else
+            else if (dirty & FRAME_PART_SIDES)
             {
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_LEFT],
-                    frameLeft (c), left_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_LEFT][state],
-                    &frame_pix.pm_sides[SIDE_LEFT],
-                    0, 0, frameLeft (c), left_height);
+                frame_pix.pm_sides[SIDE_LEFT] =
+                    frameUpdateSidePixmap (c, SIDE_LEFT, state, frameLeft (c), left_height);
                 xfwmWindowSetBG (&c->sides[SIDE_LEFT],
-                    &frame_pix.pm_sides[SIDE_LEFT]);
+                    frame_pix.pm_sides[SIDE_LEFT]);
                 xfwmWindowShow (&c->sides[SIDE_LEFT], 0, frameTop (c),
-                    frameLeft (c), left_height, (requires_clearing | height_changed));
+                    frameLeft (c), left_height, TRUE);
 
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_RIGHT],
-                    frameRight (c), right_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_RIGHT][state],
-                    &frame_pix.pm_sides[SIDE_RIGHT],
-                    0, 0, frameRight (c), right_height);
+                frame_pix.pm_sides[SIDE_RIGHT] =
+                    frameUpdateSidePixmap (c, SIDE_RIGHT, state, frameRight (c), right_height);
                 xfwmWindowSetBG (&c->sides[SIDE_RIGHT],
-                    &frame_pix.pm_sides[SIDE_RIGHT]);
+                    frame_pix.pm_sides[SIDE_RIGHT]);
                 xfwmWindowShow (&c->sides[SIDE_RIGHT],
                     frameWidth (c) - frameRight (c), frameTop (c), frameRight (c),
-                    right_height, (requires_clearing | height_changed));
+                    right_height, TRUE);
             }
 
-            xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_BOTTOM],
-                bottom_width, frameBottom (c));
-            xfwmPixmapFill (&screen_info->sides[SIDE_BOTTOM][state],
-                &frame_pix.pm_sides[SIDE_BOTTOM],
-                0, 0, bottom_width, frameBottom (c));
-            xfwmWindowSetBG (&c->sides[SIDE_BOTTOM],
-                &frame_pix.pm_sides[SIDE_BOTTOM]);
-            xfwmWindowShow (&c->sides[SIDE_BOTTOM],
-                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                frameHeight (c) - frameBottom (c), bottom_width, frameBottom (c),
-                (requires_clearing | width_changed));
-
-            if (!xfwmPixmapNone(&frame_pix.pm_sides[SIDE_TOP]))
+            if (dirty & FRAME_PART_SIDES)
             {
-                xfwmWindowSetBG (&c->sides[SIDE_TOP], &frame_pix.pm_sides[SIDE_TOP]);
-                xfwmWindowShow (&c->sides[SIDE_TOP],
-                    screen_info->corners[CORNER_TOP_LEFT][state].width,
-                    0, top_width, frame_pix.pm_sides[SIDE_TOP].height,
-                    (requires_clearing | width_changed));
+                frame_pix.pm_sides[SIDE_BOTTOM] =
+                    frameUpdateSidePixmap (c, SIDE_BOTTOM, state, bottom_width, frameBottom (c));
+                xfwmWindowSetBG (&c->sides[SIDE_BOTTOM],
+                    frame_pix.pm_sides[SIDE_BOTTOM]);
+                xfwmWindowShow (&c->sides[SIDE_BOTTOM],
+                    screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                    frameHeight (c) - frameBottom (c), bottom_width, frameBottom (c),
+                    TRUE);
             }
-            else
+
+            /* Top side comes with the title */
+            if (dirty & FRAME_PART_TITLE)
             {
-                xfwmWindowHide (&c->sides[SIDE_TOP]);
+                if (!xfwmPixmapNone(&frame_pix.pm_top))
+                {
+                    xfwmWindowSetBG (&c->sides[SIDE_TOP], &frame_pix.pm_top);
+                    xfwmWindowShow (&c->sides[SIDE_TOP],
+                        screen_info->corners[CORNER_TOP_LEFT][state].width,
+                        0, top_width, frame_pix.pm_top.height, TRUE);
+                }
+                else
+                {
+                    xfwmWindowHide (&c->sides[SIDE_TOP]);
+                }
             }
 
             xfwmWindowShow (&c->corners[CORNER_TOP_LEFT], 0, 0,
                 frameTopLeftWidth (c, state),
                 screen_info->corners[CORNER_TOP_LEFT][state].height,
-                requires_clearing);
+                (dirty & FRAME_PART_CORNERS));
 
             xfwmWindowShow (&c->corners[CORNER_TOP_RIGHT],
                 frameWidth (c) - frameTopRightWidth (c, state),
                 0, frameTopRightWidth (c, state),
                 screen_info->corners[CORNER_TOP_RIGHT][state].height,
-                requires_clearing);
+                (dirty & FRAME_PART_CORNERS));
 
             xfwmWindowShow (&c->corners[CORNER_BOTTOM_LEFT], 0,
                 frameHeight (c) -
                 screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
                 screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
                 screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
-                requires_clearing);
+                (dirty & FRAME_PART_CORNERS));
 
             xfwmWindowShow (&c->corners[CORNER_BOTTOM_RIGHT],
                 frameWidth (c) -
@@ -1001,15 +2017,12 @@ frameDrawWin (Client * c)
                 screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
                 screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
                 screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
-                requires_clearing);
+                (dirty & FRAME_PART_CORNERS));
         }
-        frameSetShape (c, state, &frame_pix, button_x);
+        frameSetShape (c, state, &frame_pix, button_x, dirty);
 
         xfwmPixmapFree (&frame_pix.pm_title);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_TOP]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_BOTTOM]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_LEFT]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_RIGHT]);
+        xfwmPixmapFree (&frame_pix.pm_top);
     }
     else
     {
@@ -1038,7 +2051,199 @@ frameDrawWin (Client * c)
                 xfwmWindowHide (&c->buttons[i]);
             }
         }
-        frameSetShape (c, 0, NULL, 0);
+        frameReleasePixmaps (c);
+        if (c->frame_state)
+        {
+            /* Everything is to be drawn again when the frame comes back */
+            c->frame_state->valid = FALSE;
+        }
+        frameSetShape (c, 0, NULL, 0, FRAME_PART_ALL);
+    }
+
+    myDisplayPopRequestTag (display_info);
+}
+
+/*
+ * Tell which part of the decoration is at the given position, relative to
+ * the frame. Based on what was drawn last, for frames without part windows
+ * to find out where the pointer is.
+ */
+FrameHitType
+frameHitTest (Client * c, int x, int y, int *detail)
+{
+    ScreenInfo *screen_info;
+    FrameDrawState *drawn;
+    int i, state, bx, by, width, height;
+
+    g_return_val_if_fail (c != NULL, FRAME_HIT_NONE);
+    g_return_val_if_fail (detail != NULL, FRAME_HIT_NONE);
+    TRACE ("client \"%s\" (0x%lx) at (%i,%i)", c->name, c->window, x, y);
+
+    screen_info = c->screen_info;
+    drawn = c->frame_state;
+    *detail = 0;
+
+    if (!CLIENT_HAS_FRAME (c) || !(drawn) || !(drawn->valid))
+    {
+        return FRAME_HIT_NONE;
+    }
+
+    width = frameWidth (c);
+    height = frameHeight (c);
+    if ((x < 0) || (y < 0) || (x >= width) || (y >= height))
+    {
+        return FRAME_HIT_NONE;
+    }
+    state = drawn->state;
+
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        if (drawn->button_x[i] < 0)
+        {
+            continue;
+        }
+        bx = drawn->button_x[i];
+        by = ((frameDecorationTop (screen_info) - screen_info->buttons[i][state].height + 1) / 2)
+             - frameBorderTop (c);
+        if ((x >= bx) && (x < bx + screen_info->buttons[i][state].width) &&
+            (y >= by) && (y < by + screen_info->buttons[i][state].height))
+        {
+            *detail = i;
+            return FRAME_HIT_BUTTON;
+        }
+    }
+
+    if (!(FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
+          && (screen_info->params->borderless_maximize)))
+    {
+        if ((y < drawn->top_height) &&
+            (x >= screen_info->corners[CORNER_TOP_LEFT][state].width) &&
+            (x < width - screen_info->corners[CORNER_TOP_RIGHT][state].width))
+        {
+            *detail = CORNER_COUNT + SIDE_TOP;
+            return FRAME_HIT_EDGE;
+        }
+        if ((x < frameTopLeftWidth (c, state)) &&
+            (y < screen_info->corners[CORNER_TOP_LEFT][state].height))
+        {
+            *detail = CORNER_TOP_LEFT;
+            return FRAME_HIT_EDGE;
+        }
+        if ((x >= width - frameTopRightWidth (c, state)) &&
+            (y < screen_info->corners[CORNER_TOP_RIGHT][state].height))
+        {
+            *detail = CORNER_TOP_RIGHT;
+            return FRAME_HIT_EDGE;
+        }
+        if ((x < screen_info->corners[CORNER_BOTTOM_LEFT][state].width) &&
+            (y >= height - screen_info->corners[CORNER_BOTTOM_LEFT][state].height))
+        {
+            *detail = CORNER_BOTTOM_LEFT;
+            return FRAME_HIT_EDGE;
+        }
+        if ((x >= width - screen_info->corners[CORNER_BOTTOM_RIGHT][state].width) &&
+            (y >= height - screen_info->corners[CORNER_BOTTOM_RIGHT][state].height))
+        {
+            *detail = CORNER_BOTTOM_RIGHT;
+            return FRAME_HIT_EDGE;
+        }
+    }
+
+    if (y < frameTop (c))
+    {
+        return FRAME_HIT_TITLE;
+    }
+    if (y >= height - frameBottom (c))
+    {
+        *detail = CORNER_COUNT + SIDE_BOTTOM;
+        return FRAME_HIT_EDGE;
+    }
+    if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+    {
+        if (x < frameLeft (c))
+        {
+            *detail = CORNER_COUNT + SIDE_LEFT;
+            return FRAME_HIT_EDGE;
+        }
+        if (x >= width - frameRight (c))
+        {
+            *detail = CORNER_COUNT + SIDE_RIGHT;
+            return FRAME_HIT_EDGE;
+        }
+    }
+
+    return FRAME_HIT_NONE;
+}
+
+/*
+ * Follow the pointer over a single window frame, doing what the part
+ * windows do otherwise: resize cursors on the edges and button prelight.
+ */
+void
+frameUpdatePointer (Client * c, int x, int y, gboolean inside)
+{
+    DisplayInfo *display_info;
+    FrameDrawState *drawn;
+    FrameHitType hit;
+    Cursor cursor;
+    int b, detail;
+    gboolean need_redraw;
+
+    g_return_if_fail (c != NULL);
+
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SINGLE_WINDOW))
+    {
+        return;
+    }
+
+    display_info = c->screen_info->display_info;
+    drawn = frameGetDrawState (c);
+    hit = FRAME_HIT_NONE;
+    detail = 0;
+    if (inside)
+    {
+        hit = frameHitTest (c, x, y, &detail);
+    }
+
+    cursor = None;
+    if (hit == FRAME_HIT_EDGE)
+    {
+        cursor = myDisplayGetCursorResize (display_info, detail);
+    }
+    if (cursor != drawn->cursor)
+    {
+        if (cursor != None)
+        {
+            XDefineCursor (display_info->dpy, c->frame, cursor);
+        }
+        else
+        {
+            XUndefineCursor (display_info->dpy, c->frame);
+        }
+        drawn->cursor = cursor;
+    }
+
+    need_redraw = FALSE;
+    for (b = 0; b < BUTTON_COUNT; b++)
+    {
+        if ((hit == FRAME_HIT_BUTTON) && (b == detail))
+        {
+            if ((c->button_status[b] == BUTTON_STATE_NORMAL) && (c == clientGetFocus ()) &&
+                !xfwmPixmapNone (clientGetButtonPixmap (c, b, PRELIGHT)))
+            {
+                c->button_status[b] = BUTTON_STATE_PRELIGHT;
+                need_redraw = TRUE;
+            }
+        }
+        else if (c->button_status[b] == BUTTON_STATE_PRELIGHT)
+        {
+            c->button_status[b] = BUTTON_STATE_NORMAL;
+            need_redraw = TRUE;
+        }
+    }
+    if (need_redraw)
+    {
+        frameQueueDraw (c, FALSE);
     }
 }
 
@@ -1057,6 +2262,36 @@ update_frame_idle_cb (gpointer data)
     return (FALSE);
 }
 
+static gboolean
+draw_batch_idle_cb (gpointer data)
+{
+    ScreenInfo *screen_info;
+    Client *c;
+    gint64 start;
+
+    screen_info = (ScreenInfo *) data;
+    TRACE ("%u frames left", g_queue_get_length (screen_info->draw_batch));
+
+    start = g_get_monotonic_time ();
+    while ((c = g_queue_pop_head (screen_info->draw_batch)))
+    {
+        FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED);
+        frameDrawWin (c);
+        if (g_get_monotonic_time () - start > DRAW_BATCH_SLICE)
+        {
+            break;
+        }
+    }
+
+    if (g_queue_is_empty (screen_info->draw_batch))
+    {
+        screen_info->draw_batch_id = 0;
+        return (FALSE);
+    }
+
+    return (TRUE);
+}
+
 int
 frameDecorationLeft (ScreenInfo *screen_info)
 {
@@ -1329,6 +2564,8 @@ frameExtentHeight (Client * c)
 void
 frameClearQueueDraw (Client * c)
 {
+    ScreenInfo *screen_info;
+
     g_return_if_fail (c);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
@@ -1337,6 +2574,17 @@ frameClearQueueDraw (Client * c)
         g_source_remove (c->frame_timeout_id);
         c->frame_timeout_id = 0;
     }
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED))
+    {
+        screen_info = c->screen_info;
+        g_queue_remove (screen_info->draw_batch, c);
+        FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED);
+        if (g_queue_is_empty (screen_info->draw_batch) && (screen_info->draw_batch_id))
+        {
+            g_source_remove (screen_info->draw_batch_id);
+            screen_info->draw_batch_id = 0;
+        }
+    }
 }
 
 void
@@ -1358,8 +2606,8 @@ frameQueueDraw (Client * c, gboolean clear_all)
     g_return_if_fail (c);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    /* Reschedule update */
-    if (c->frame_timeout_id)
+    /* Reschedule update, ahead of the batch if it was in it */
+    if ((c->frame_timeout_id) || FLAG_TEST (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED))
     {
         frameClearQueueDraw (c);
     }
@@ -1375,6 +2623,46 @@ frameQueueDraw (Client * c, gboolean clear_all)
     }
 }
 
+/*
+ * Like frameQueueDraw() for many frames at once, the frames are drawn
+ * in the order given, a slice of them per idle iteration.
+ */
+void
+frameBatchDraw (Client * c, gboolean clear_all)
+{
+    ScreenInfo *screen_info;
+
+    g_return_if_fail (c);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    screen_info = c->screen_info;
+    if (!screen_info->draw_batch)
+    {
+        screen_info->draw_batch = g_queue_new ();
+    }
+
+    /* A redraw already queued for the frame is merged in the batch */
+    if (c->frame_timeout_id)
+    {
+        g_source_remove (c->frame_timeout_id);
+        c->frame_timeout_id = 0;
+    }
+    if (clear_all)
+    {
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_REDRAW);
+    }
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED))
+    {
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_DRAW_BATCHED);
+        g_queue_push_tail (screen_info->draw_batch, c);
+    }
+    if (screen_info->draw_batch_id == 0)
+    {
+        screen_info->draw_batch_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                                      draw_batch_idle_cb, screen_info, NULL);
+    }
+}
+
 void
 frameSetShapeInput (Client * c)
 {
@@ -32,6 +32,15 @@
 #include "mypixmap.h"
 #include "client.h"
 
+typedef enum
+{
+    FRAME_HIT_NONE = 0,
+    FRAME_HIT_TITLE,
+    FRAME_HIT_BUTTON,
+    FRAME_HIT_EDGE
+}
+FrameHitType;
+
 int                      frameDecorationLeft                    (ScreenInfo *);
 int                      frameDecorationRight                   (ScreenInfo *);
 int                      frameDecorationTop                     (ScreenInfo *);
@@ -58,5 +67,21 @@ void                     frameQueueDraw                         (Client *,
                                                                  gboolean);
 void                     frameDraw                              (Client *,
                                                                  gboolean);
+void                     frameBatchDraw                         (Client *,
+                                                                 gboolean);
+void                     frameClearTitleCache                   (ScreenInfo *);
+void                     frameClearPixmapCache                  (ScreenInfo *);
+void                     frameDumpPixmapCacheStats              (ScreenInfo *);
+void                     frameClearShapeCache                   (ScreenInfo *);
+void                     frameReleasePixmaps                    (Client *);
+void                     frameFree                              (Client *);
+FrameHitType             frameHitTest                           (Client *,
+                                                                 int,
+                                                                 int,
+                                                                 int *);
+void                     frameUpdatePointer                     (Client *,
+                                                                 int,
+                                                                 int,
+                                                                 gboolean);
 
 #endif /* INC_FRAME_H */
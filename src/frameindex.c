@@ -0,0 +1,316 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "screen.h"
+#include "client.h"
+#include "frame.h"
+#include "frameindex.h"
+
+/*
+ * Uniform grid of the visible frames, so the placement, snapping and
+ * pointer lookups only look at the frames near the area they care
+ * about. Each frame is indexed with the box around both its window and
+ * its extents, as client side decorations have extents within it.
+ * Frames are only visible on the current workspace (or sticky), so
+ * this indexes the workspace being shown.
+ *
+ * Frames partly or fully off screen are kept in the cells on the border
+ * of the grid.
+ */
+#define FRAME_INDEX_CELL_SHIFT 8
+
+struct _FrameIndex
+{
+    gint width;
+    gint height;
+    gint cols;
+    gint rows;
+    GPtrArray **cells;
+    guint stamp;
+    /* All the frames in the grid */
+    GPtrArray *clients;
+};
+
+static gint
+frameIndexCell (gint pos, gint count)
+{
+    if (pos < 0)
+    {
+        return 0;
+    }
+    return MIN (pos >> FRAME_INDEX_CELL_SHIFT, count - 1);
+}
+
+static void
+frameIndexCells (FrameIndex *index, const GdkRectangle *rect,
+                 gint *col1, gint *row1, gint *col2, gint *row2)
+{
+    *col1 = frameIndexCell (rect->x, index->cols);
+    *row1 = frameIndexCell (rect->y, index->rows);
+    *col2 = frameIndexCell (rect->x + MAX (rect->width, 1) - 1, index->cols);
+    *row2 = frameIndexCell (rect->y + MAX (rect->height, 1) - 1, index->rows);
+}
+
+static void
+frameIndexInsert (FrameIndex *index, Client *c)
+{
+    gint col1, row1, col2, row2, col, row;
+    GPtrArray **cell;
+
+    frameIndexCells (index, &c->index_rect, &col1, &row1, &col2, &row2);
+    for (row = row1; row <= row2; row++)
+    {
+        for (col = col1; col <= col2; col++)
+        {
+            cell = &index->cells[row * index->cols + col];
+            if (!*cell)
+            {
+                *cell = g_ptr_array_new ();
+            }
+            g_ptr_array_add (*cell, c);
+        }
+    }
+}
+
+static void
+frameIndexDelete (FrameIndex *index, Client *c)
+{
+    gint col1, row1, col2, row2, col, row;
+    GPtrArray *cell;
+
+    frameIndexCells (index, &c->index_rect, &col1, &row1, &col2, &row2);
+    for (row = row1; row <= row2; row++)
+    {
+        for (col = col1; col <= col2; col++)
+        {
+            cell = index->cells[row * index->cols + col];
+            if (cell)
+            {
+                g_ptr_array_remove_fast (cell, c);
+            }
+        }
+    }
+}
+
+static void
+frameIndexFreeCells (FrameIndex *index)
+{
+    gint i;
+
+    for (i = 0; i < index->cols * index->rows; i++)
+    {
+        if (index->cells[i])
+        {
+            g_ptr_array_free (index->cells[i], TRUE);
+        }
+    }
+    g_free (index->cells);
+}
+
+/* Creates the grid, or lays it out again if the screen size changed */
+static FrameIndex *
+frameIndexGet (ScreenInfo *screen_info)
+{
+    FrameIndex *index;
+    guint i;
+
+    index = screen_info->frame_index;
+    if (!index)
+    {
+        index = g_new0 (FrameIndex, 1);
+        index->clients = g_ptr_array_new ();
+        screen_info->frame_index = index;
+    }
+    else if ((index->width == screen_info->width) && (index->height == screen_info->height))
+    {
+        return index;
+    }
+    else
+    {
+        frameIndexFreeCells (index);
+    }
+
+    TRACE ("grid for %ix%i", screen_info->width, screen_info->height);
+    index->width = screen_info->width;
+    index->height = screen_info->height;
+    index->cols = MAX (index->width >> FRAME_INDEX_CELL_SHIFT, 0) + 1;
+    index->rows = MAX (index->height >> FRAME_INDEX_CELL_SHIFT, 0) + 1;
+    index->cells = g_new0 (GPtrArray *, index->cols * index->rows);
+    for (i = 0; i < index->clients->len; i++)
+    {
+        frameIndexInsert (index, g_ptr_array_index (index->clients, i));
+    }
+
+    return index;
+}
+
+/* To be called when the frame is mapped, unmapped, moved or resized */
+void
+frameIndexUpdate (Client *c)
+{
+    FrameIndex *index;
+    GdkRectangle rect, extents;
+
+    g_return_if_fail (c != NULL);
+
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE))
+    {
+        frameIndexRemove (c);
+        return;
+    }
+
+    rect.x = frameX (c);
+    rect.y = frameY (c);
+    rect.width = frameWidth (c);
+    rect.height = frameHeight (c);
+    extents.x = frameExtentX (c);
+    extents.y = frameExtentY (c);
+    extents.width = frameExtentWidth (c);
+    extents.height = frameExtentHeight (c);
+    gdk_rectangle_union (&rect, &extents, &rect);
+
+    index = frameIndexGet (c->screen_info);
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_INDEXED))
+    {
+        if (gdk_rectangle_equal (&rect, &c->index_rect))
+        {
+            return;
+        }
+        frameIndexDelete (index, c);
+    }
+    else
+    {
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_INDEXED);
+        g_ptr_array_add (index->clients, c);
+    }
+    TRACE ("client \"%s\" (0x%lx) at (%i,%i) [%ix%i]", c->name, c->window,
+           rect.x, rect.y, rect.width, rect.height);
+
+    c->index_rect = rect;
+    frameIndexInsert (index, c);
+}
+
+void
+frameIndexRemove (Client *c)
+{
+    FrameIndex *index;
+
+    g_return_if_fail (c != NULL);
+
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_INDEXED))
+    {
+        return;
+    }
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    index = frameIndexGet (c->screen_info);
+    frameIndexDelete (index, c);
+    g_ptr_array_remove_fast (index->clients, c);
+    FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_INDEXED);
+}
+
+/*
+ * Adds to the array the visible frames touching the area or within a
+ * pixel of it, callers still check the geometry themselves.
+ */
+void
+frameIndexQuery (ScreenInfo *screen_info, const GdkRectangle *area, GPtrArray *result)
+{
+    FrameIndex *index;
+    GdkRectangle grown;
+    GPtrArray *cell;
+    Client *c;
+    gint col1, row1, col2, row2, col, row;
+    guint i;
+
+    g_return_if_fail (screen_info != NULL);
+    g_return_if_fail (area != NULL);
+    g_return_if_fail (result != NULL);
+
+    grown.x = area->x - 1;
+    grown.y = area->y - 1;
+    grown.width = area->width + 2;
+    grown.height = area->height + 2;
+
+    index = frameIndexGet (screen_info);
+    /* Frames spread over several cells are reported once */
+    index->stamp++;
+
+    frameIndexCells (index, &grown, &col1, &row1, &col2, &row2);
+    for (row = row1; row <= row2; row++)
+    {
+        for (col = col1; col <= col2; col++)
+        {
+            cell = index->cells[row * index->cols + col];
+            if (!cell)
+            {
+                continue;
+            }
+            for (i = 0; i < cell->len; i++)
+            {
+                c = g_ptr_array_index (cell, i);
+                if (c->index_stamp == index->stamp)
+                {
+                    continue;
+                }
+                c->index_stamp = index->stamp;
+                if (gdk_rectangle_intersect (&grown, &c->index_rect, NULL))
+                {
+                    g_ptr_array_add (result, c);
+                }
+            }
+        }
+    }
+}
+
+void
+frameIndexFree (ScreenInfo *screen_info)
+{
+    FrameIndex *index;
+    guint i;
+
+    g_return_if_fail (screen_info != NULL);
+
+    index = screen_info->frame_index;
+    if (!index)
+    {
+        return;
+    }
+
+    for (i = 0; i < index->clients->len; i++)
+    {
+        Client *c = g_ptr_array_index (index->clients, i);
+        FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_INDEXED);
+    }
+    g_ptr_array_free (index->clients, TRUE);
+    frameIndexFreeCells (index);
+    g_free (index);
+    screen_info->frame_index = NULL;
+}
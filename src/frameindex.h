@@ -0,0 +1,43 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifndef INC_FRAMEINDEX_H
+#define INC_FRAMEINDEX_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "screen.h"
+#include "client.h"
+
+void                     frameIndexUpdate                       (Client *);
+void                     frameIndexRemove                       (Client *);
+void                     frameIndexQuery                        (ScreenInfo *,
+                                                                 const GdkRectangle *,
+                                                                 GPtrArray *);
+void                     frameIndexFree                         (ScreenInfo *);
+
+#endif /* INC_FRAMEINDEX_H */
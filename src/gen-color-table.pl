@@ -72,3 +72,48 @@ for $color (@colors) {
 }
 
 print "\n};\n";
+
+# Open addressed table for the lookups, on the FNV-1a hash of the
+# lowercase names, holding the index in xColors plus one.
+$size = 1;
+while ($size < 2 * @colors) {
+    $size <<= 1;
+}
+@table = (0) x $size;
+%seen = ();
+$i = 0;
+for $color (@colors) {
+    $name = lc($color->[3]);
+    $i++;
+    next if $seen{$name}++;
+
+    {
+	use integer;
+	$hash = 2166136261;
+	for $c (unpack("C*", $name)) {
+	    $hash = (($hash ^ $c) * 16777619) & 0xffffffff;
+	}
+    }
+    $slot = $hash & ($size - 1);
+    while ($table[$slot]) {
+	$slot = ($slot + 1) & ($size - 1);
+    }
+    $table[$slot] = $i;
+}
+
+print <<EOT;
+
+#define XPM_COLOR_HASH_SIZE $size
+
+static const guint16 xColorHash[XPM_COLOR_HASH_SIZE] = {
+EOT
+
+for ($i = 0; $i < $size; $i += 12) {
+    if ($i != 0) {
+	print ",\n";
+    }
+    $end = $i + 11 < $size - 1 ? $i + 11 : $size - 1;
+    print "  ", join(", ", @table[$i .. $end]);
+}
+
+print "\n};\n";
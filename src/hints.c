@@ -416,6 +416,14 @@ setNetSupportedHint (DisplayInfo *display_info, Window root, Window check_win)
     atoms[i++] = display_info->atoms[NET_WM_BYPASS_COMPOSITOR];
     atoms[i++] = display_info->atoms[NET_WM_CONTEXT_HELP];
     atoms[i++] = display_info->atoms[NET_WM_DESKTOP];
+#ifdef HAVE_XSYNC
+    if (display_info->have_xsync)
+    {
+        /* Clients then wait for the frame drawn message before drawing again */
+        atoms[i++] = display_info->atoms[NET_WM_FRAME_DRAWN];
+        atoms[i++] = display_info->atoms[NET_WM_FRAME_TIMINGS];
+    }
+#endif /* HAVE_XSYNC */
     atoms[i++] = display_info->atoms[NET_WM_FULLSCREEN_MONITORS];
     atoms[i++] = display_info->atoms[NET_WM_ICON];
     atoms[i++] = display_info->atoms[NET_WM_ICON_GEOMETRY];
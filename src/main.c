@@ -165,6 +165,9 @@ handleSignal (int sig)
             case SIGUSR1:
                 display_info->reload = TRUE;
                 break;
+            case SIGUSR2:
+                display_info->dump_stats = TRUE;
+                break;
             default:
                 break;
         }
@@ -187,6 +190,7 @@ setupHandler (gboolean install)
     sigaction (SIGTERM, &act, NULL);
     sigaction (SIGHUP,  &act, NULL);
     sigaction (SIGUSR1, &act, NULL);
+    sigaction (SIGUSR2, &act, NULL);
 }
 
 static void
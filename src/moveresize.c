@@ -37,10 +37,13 @@
 #include <gdk/gdkx.h>
 #include <gtk/gtk.h>
 
+#include "common/xfwm-common.h"
+
 #include "client.h"
 #include "compositor.h"
 #include "focus.h"
 #include "frame.h"
+#include "frameindex.h"
 #include "moveresize.h"
 #include "netwm.h"
 #include "placement.h"
@@ -66,6 +69,32 @@
 #define BORDER_TILE_LENGTH_RELATIVE 5
 #define use_xor_move(screen_info) (screen_info->params->box_move && !compositorIsActive (screen_info))
 #define use_xor_resize(screen_info) (screen_info->params->box_resize && !compositorIsActive (screen_info))
+/* Minimum delay between two real configures during a lazy move, in microseconds */
+#define LAZY_MOVE_INTERVAL 50000
+
+/*
+ * Edges of the other frames a moved window can snap to. Other windows
+ * do not move during a drag, so the edges are gathered once, sorted by
+ * position along with the span they cover on the other axis, and only
+ * gathered again when a window is configured, mapped or unmapped, or
+ * the workspace changes.
+ */
+typedef struct
+{
+    gint pos;
+    gint start;
+    gint end;
+} SnapEdge;
+
+typedef struct _SnapEdges SnapEdges;
+struct _SnapEdges
+{
+    GArray *left;
+    GArray *right;
+    GArray *top;
+    GArray *bottom;
+    guint workspace;
+};
 
 typedef struct _MoveResizeData MoveResizeData;
 struct _MoveResizeData
@@ -78,6 +107,8 @@ struct _MoveResizeData
     gboolean move_resized;
     gboolean released;
     gboolean client_gone;
+    gboolean translated;
+    gint64 last_configure;
     guint button;
     gint cancel_x, cancel_y;
     gint cancel_w, cancel_h;
@@ -91,6 +122,17 @@ struct _MoveResizeData
     gint oldw, oldh;
     gint handle;
     Poswin *poswin;
+    /* Motion is applied at most once per display frame */
+    XfwmFilter motion_filter;
+    XfwmEventMotion pending_motion;
+    XEvent pending_xevent;
+    gboolean motion_replay;
+    gint64 frame_interval;
+    gint64 last_motion;
+    guint motion_timeout_id;
+    guint motion_received;
+    guint motion_applied;
+    SnapEdges *snap_edges;
 };
 
 static int
@@ -378,6 +420,8 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
 
     Client *c2;
     ScreenInfo *screen_info;
+    GPtrArray *candidates;
+    GdkRectangle area;
     guint i;
     int snap_width, closest;
 
@@ -385,8 +429,18 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
     snap_width = screen_info->params->snap_width;
     closest = edge_pos + snap_width + 2; /* This only needs to be out of the snap range to work. -Cliff */
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    /* Frames with an edge in snapping range, the overlap test below
+       mixes the extents of both frames so leave some room for it */
+    area.x = edge_pos - snap_width - 1;
+    area.width = 2 * (snap_width + 1);
+    area.y = c->y - frameExtentTop (c) - frameExtentBottom (c) - 2;
+    area.height = c->height + 2 * (frameExtentTop (c) + frameExtentBottom (c)) + 4;
+    candidates = g_ptr_array_new ();
+    frameIndexQuery (screen_info, &area, candidates);
+
+    for (i = 0; i < candidates->len; i++)
     {
+        c2 = g_ptr_array_index (candidates, i);
         if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
             (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
              || ((screen_info->params->snap_to_border)
@@ -408,6 +462,8 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
         }
     }
 
+    g_ptr_array_free (candidates, TRUE);
+
     if (abs (closest - edge_pos) > snap_width)
     {
         closest = edge_pos;
@@ -425,6 +481,8 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
 
     Client *c2;
     ScreenInfo *screen_info;
+    GPtrArray *candidates;
+    GdkRectangle area;
     guint i;
     int snap_width, closest;
 
@@ -432,8 +490,16 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
     snap_width = screen_info->params->snap_width;
     closest = edge_pos + snap_width + 1; /* This only needs to be out of the snap range to work. -Cliff */
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    area.x = c->x - frameExtentLeft (c) - frameExtentRight (c) - 2;
+    area.width = c->width + 2 * (frameExtentLeft (c) + frameExtentRight (c)) + 4;
+    area.y = edge_pos - snap_width - 1;
+    area.height = 2 * (snap_width + 1);
+    candidates = g_ptr_array_new ();
+    frameIndexQuery (screen_info, &area, candidates);
+
+    for (i = 0; i < candidates->len; i++)
     {
+        c2 = g_ptr_array_index (candidates, i);
         if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
             (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
              || ((screen_info->params->snap_to_border)
@@ -455,6 +521,8 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
         }
     }
 
+    g_ptr_array_free (candidates, TRUE);
+
     if (abs (closest - edge_pos) > snap_width)
     {
         closest = edge_pos;
@@ -463,28 +531,167 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
     return closest;
 }
 
+static gint
+compare_snap_edges (gconstpointer a, gconstpointer b)
+{
+    gint pos_a = ((const SnapEdge *) a)->pos;
+    gint pos_b = ((const SnapEdge *) b)->pos;
+
+    return (pos_a > pos_b) - (pos_a < pos_b);
+}
+
 static void
-clientSnapPosition (Client * c, int prev_x, int prev_y)
+snapEdgesAdd (GArray *edges, gint pos, gint start, gint end)
+{
+    SnapEdge edge;
+
+    edge.pos = pos;
+    edge.start = start;
+    edge.end = end;
+    g_array_append_val (edges, edge);
+}
+
+static SnapEdges *
+snapEdgesNew (Client *c)
 {
     ScreenInfo *screen_info;
+    SnapEdges *snap_edges;
     Client *c2;
     guint i;
-    int cx, cy, delta;
+    int c_frame_x1, c_frame_x2, c_frame_y1, c_frame_y2;
+
+    screen_info = c->screen_info;
+    snap_edges = g_new0 (SnapEdges, 1);
+    snap_edges->left = g_array_new (FALSE, FALSE, sizeof (SnapEdge));
+    snap_edges->right = g_array_new (FALSE, FALSE, sizeof (SnapEdge));
+    snap_edges->top = g_array_new (FALSE, FALSE, sizeof (SnapEdge));
+    snap_edges->bottom = g_array_new (FALSE, FALSE, sizeof (SnapEdge));
+    snap_edges->workspace = screen_info->current_ws;
+
+    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    {
+        if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
+            (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
+             || ((screen_info->params->snap_to_border)
+                  && FLAG_TEST (c2->flags, CLIENT_FLAG_HAS_STRUT)
+                  && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))))
+        {
+            c_frame_x1 = frameExtentX (c2);
+            c_frame_x2 = c_frame_x1 + frameExtentWidth (c2);
+            c_frame_y1 = frameExtentY (c2);
+            c_frame_y2 = c_frame_y1 + frameExtentHeight (c2);
+
+            snapEdgesAdd (snap_edges->left, c_frame_x1, c_frame_y1, c_frame_y2);
+            snapEdgesAdd (snap_edges->right, c_frame_x2, c_frame_y1, c_frame_y2);
+            snapEdgesAdd (snap_edges->top, c_frame_y1, c_frame_x1, c_frame_x2);
+            snapEdgesAdd (snap_edges->bottom, c_frame_y2, c_frame_x1, c_frame_x2);
+        }
+    }
+
+    g_array_sort (snap_edges->left, compare_snap_edges);
+    g_array_sort (snap_edges->right, compare_snap_edges);
+    g_array_sort (snap_edges->top, compare_snap_edges);
+    g_array_sort (snap_edges->bottom, compare_snap_edges);
+    TRACE ("gathered %u snap edges", snap_edges->left->len);
+
+    return snap_edges;
+}
+
+static void
+snapEdgesFree (SnapEdges *snap_edges)
+{
+    if (snap_edges == NULL)
+    {
+        return;
+    }
+
+    g_array_free (snap_edges->left, TRUE);
+    g_array_free (snap_edges->right, TRUE);
+    g_array_free (snap_edges->top, TRUE);
+    g_array_free (snap_edges->bottom, TRUE);
+    g_free (snap_edges);
+}
+
+/*
+ * Look for the edge closest to frame_pos, within snap_width and covering
+ * [start, end] on the other axis, that is closer than best_delta.
+ * With resist, only edges ahead of frame_pos in that direction count.
+ */
+static void
+snapEdgesFind (GArray *edges, int frame_pos, int start, int end, int snap_width,
+               int resist, int offset, int *best_delta, int *best_frame_pos)
+{
+    SnapEdge *edge;
+    guint low, high, middle;
+    int delta;
+
+    /* First edge at or after frame_pos - snap_width */
+    low = 0;
+    high = edges->len;
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (g_array_index (edges, SnapEdge, middle).pos < frame_pos - snap_width)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (; low < edges->len; low++)
+    {
+        edge = &g_array_index (edges, SnapEdge, low);
+        if (edge->pos > frame_pos + snap_width)
+        {
+            break;
+        }
+        if ((edge->start > end) || (edge->end < start))
+        {
+            continue;
+        }
+        if (((resist < 0) && (frame_pos > edge->pos)) ||
+            ((resist > 0) && (frame_pos < edge->pos)))
+        {
+            continue;
+        }
+
+        delta = abs (edge->pos - frame_pos);
+        if (delta < *best_delta)
+        {
+            *best_delta = delta;
+            *best_frame_pos = edge->pos + offset;
+        }
+    }
+}
+
+static void
+clientSnapPosition (MoveResizeData *passdata, int prev_x, int prev_y)
+{
+    ScreenInfo *screen_info;
+    Client *c;
+    SnapEdges *snap_edges;
+    int cx, cy, snap_width;
     int disp_x, disp_y, disp_max_x, disp_max_y;
     int frame_x, frame_y, frame_height, frame_width;
     int frame_top, frame_left;
     int frame_x2, frame_y2;
     int best_frame_x, best_frame_y;
     int best_delta_x, best_delta_y;
-    int c_frame_x1, c_frame_x2, c_frame_y1, c_frame_y2;
+    gboolean resist;
     GdkRectangle rect;
 
+    c = passdata->c;
     g_return_if_fail (c != NULL);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
     screen_info = c->screen_info;
-    best_delta_x = screen_info->params->snap_width + 1;
-    best_delta_y = screen_info->params->snap_width + 1;
+    snap_width = screen_info->params->snap_width;
+    resist = screen_info->params->snap_resist;
+    best_delta_x = snap_width + 1;
+    best_delta_y = snap_width + 1;
 
     frame_x = frameExtentX (c);
     frame_y = frameExtentY (c);
@@ -545,65 +752,40 @@ clientSnapPosition (Client * c, int prev_x, int prev_y)
         }
     }
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    snap_edges = passdata->snap_edges;
+    if (snap_edges && (snap_edges->workspace != screen_info->current_ws))
     {
-        if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
-            (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
-             || ((screen_info->params->snap_to_border)
-                  && FLAG_TEST (c2->flags, CLIENT_FLAG_HAS_STRUT)
-                  && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))))
-        {
-            c_frame_x1 = frameExtentX (c2);
-            c_frame_x2 = c_frame_x1 + frameExtentWidth (c2);
-            c_frame_y1 = frameExtentY (c2);
-            c_frame_y2 = c_frame_y1 + frameExtentHeight (c2);
-
-            if ((c_frame_y1 <= frame_y2) && (c_frame_y2 >= frame_y))
-            {
-                delta = abs (c_frame_x2 - frame_x);
-                if (delta < best_delta_x)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_x <= c_frame_x2) && (c->x < prev_x)))
-                    {
-                        best_delta_x = delta;
-                        best_frame_x = c_frame_x2;
-                    }
-                }
-
-                delta = abs (c_frame_x1 - frame_x2);
-                if (delta < best_delta_x)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_x2 >= c_frame_x1) && (c->x > prev_x)))
-                    {
-                        best_delta_x = delta;
-                        best_frame_x = c_frame_x1 - frame_width;
-                    }
-                }
-            }
+        snapEdgesFree (snap_edges);
+        snap_edges = NULL;
+    }
+    if (snap_edges == NULL)
+    {
+        snap_edges = snapEdgesNew (c);
+        passdata->snap_edges = snap_edges;
+    }
 
-            if ((c_frame_x1 <= frame_x2) && (c_frame_x2 >= frame_x))
-            {
-                delta = abs (c_frame_y2 - frame_y);
-                if (delta < best_delta_y)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_y <= c_frame_y2) && (c->y < prev_y)))
-                    {
-                        best_delta_y = delta;
-                        best_frame_y = c_frame_y2;
-                    }
-                }
+    /* Our left edge on their right edges, our right edge on their left edges */
+    if (!resist || (c->x < prev_x))
+    {
+        snapEdgesFind (snap_edges->right, frame_x, frame_y, frame_y2, snap_width,
+                       resist ? -1 : 0, 0, &best_delta_x, &best_frame_x);
+    }
+    if (!resist || (c->x > prev_x))
+    {
+        snapEdgesFind (snap_edges->left, frame_x2, frame_y, frame_y2, snap_width,
+                       resist ? 1 : 0, -frame_width, &best_delta_x, &best_frame_x);
+    }
 
-                delta = abs (c_frame_y1 - frame_y2);
-                if (delta < best_delta_y)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_y2 >= c_frame_y1) && (c->y > prev_y)))
-                    {
-                        best_delta_y = delta;
-                        best_frame_y = c_frame_y1 - frame_height;
-                    }
-                }
-            }
-        }
+    /* Same for our top and bottom edges */
+    if (!resist || (c->y < prev_y))
+    {
+        snapEdgesFind (snap_edges->bottom, frame_y, frame_x, frame_x2, snap_width,
+                       resist ? -1 : 0, 0, &best_delta_y, &best_frame_y);
+    }
+    if (!resist || (c->y > prev_y))
+    {
+        snapEdgesFind (snap_edges->top, frame_y2, frame_x, frame_x2, snap_width,
+                       resist ? 1 : 0, -frame_height, &best_delta_y, &best_frame_y);
     }
 
     if (best_delta_x <= screen_info->params->snap_width)
@@ -865,6 +1047,194 @@ clientMoveTile (Client *c, XfwmEventMotion *event)
     return FALSE;
 }
 
+static gboolean
+clientMotionTimeout (gpointer data)
+{
+    MoveResizeData *passdata;
+    XfwmEvent event;
+
+    passdata = (MoveResizeData *) data;
+    passdata->motion_timeout_id = 0;
+
+    event.motion = passdata->pending_motion;
+    passdata->motion_replay = TRUE;
+    passdata->motion_filter (&event, passdata);
+    passdata->motion_replay = FALSE;
+
+    /* Release the data of any XI2 event picked up while replaying */
+    XFreeEventData (passdata->c->screen_info->display_info->dpy,
+                    &passdata->pending_xevent.xcookie);
+
+    return FALSE;
+}
+
+/*
+ * Returns TRUE if the motion event came too early in the current display
+ * frame, it is then kept and applied when the frame ends, unless a more
+ * recent one replaces it meanwhile.
+ */
+static gboolean
+clientMotionDefer (MoveResizeData *passdata, XfwmEvent *event)
+{
+    gint64 now, elapsed;
+    guint delay;
+
+    if (passdata->motion_replay)
+    {
+        passdata->last_motion = g_get_monotonic_time ();
+        passdata->motion_applied++;
+        return FALSE;
+    }
+    passdata->motion_received++;
+
+    now = g_get_monotonic_time ();
+    elapsed = now - passdata->last_motion;
+    if (elapsed >= passdata->frame_interval)
+    {
+        if (passdata->motion_timeout_id)
+        {
+            g_source_remove (passdata->motion_timeout_id);
+            passdata->motion_timeout_id = 0;
+        }
+        passdata->last_motion = now;
+        passdata->motion_applied++;
+        return FALSE;
+    }
+
+    passdata->pending_motion = event->motion;
+    passdata->pending_xevent = *event->meta.xevent;
+    /* The event data belongs to GDK, it is released once we return */
+    passdata->pending_xevent.xcookie.data = NULL;
+    passdata->pending_motion.meta.xevent = &passdata->pending_xevent;
+
+    if (!passdata->motion_timeout_id)
+    {
+        delay = (guint) ((passdata->frame_interval - elapsed + 999) / 1000);
+        passdata->motion_timeout_id = g_timeout_add (delay, clientMotionTimeout, passdata);
+    }
+
+    return TRUE;
+}
+
+/* Apply the pending motion, if any, before the operation ends */
+static void
+clientMotionFlush (MoveResizeData *passdata)
+{
+    if (passdata->motion_timeout_id)
+    {
+        g_source_remove (passdata->motion_timeout_id);
+        clientMotionTimeout (passdata);
+    }
+}
+
+static void
+clientMotionInit (MoveResizeData *passdata, XfwmFilter filter)
+{
+    gint rate;
+
+    rate = xfwm_get_primary_refresh_rate (passdata->c->screen_info->gscr);
+    passdata->motion_filter = filter;
+    passdata->frame_interval = G_USEC_PER_SEC / MAX (rate, 1);
+    passdata->last_motion = 0;
+    passdata->motion_replay = FALSE;
+    passdata->motion_timeout_id = 0;
+    passdata->motion_received = 0;
+    passdata->motion_applied = 0;
+}
+
+static void
+clientMotionStop (MoveResizeData *passdata)
+{
+    ScreenInfo *screen_info;
+
+    if (passdata->motion_timeout_id)
+    {
+        g_source_remove (passdata->motion_timeout_id);
+        passdata->motion_timeout_id = 0;
+    }
+    DBG ("motion events received %u, applied %u",
+         passdata->motion_received, passdata->motion_applied);
+
+    /* Running totals, reported by myDisplayDumpStats() */
+    screen_info = passdata->c->screen_info;
+    screen_info->motion_received += passdata->motion_received;
+    screen_info->motion_applied += passdata->motion_applied;
+}
+
+static gboolean
+clientMoveLazy (MoveResizeData *passdata)
+{
+    ScreenInfo *screen_info;
+    Client *c;
+
+    c = passdata->c;
+    screen_info = c->screen_info;
+
+    if (!screen_info->params->lazy_move ||
+        passdata->move_resized ||
+        (passdata->configure_flags != NO_CFG_FLAG))
+    {
+        return FALSE;
+    }
+
+    /* Let the client know where it is every now and then */
+    if (g_get_monotonic_time () - passdata->last_configure >= LAZY_MOVE_INTERVAL)
+    {
+        return FALSE;
+    }
+
+    if (!compositorTranslateWindow (screen_info->display_info, c->frame, frameX (c), frameY (c)))
+    {
+        return FALSE;
+    }
+    passdata->translated = TRUE;
+
+    return TRUE;
+}
+
+/*
+ * Whether the event tells that another client moved, showed up or went
+ * away. Windows that are not clients, such as the wireframe of this very
+ * move, tooltips or OSDs, have no snap edges.
+ */
+static gboolean
+clientMoveChangesOthers (Client *c, MoveResizeData *passdata, XEvent *xevent)
+{
+    Client *c2;
+    Window w;
+
+    switch (xevent->type)
+    {
+        case ConfigureNotify:
+            w = xevent->xconfigure.window;
+            break;
+        case MapNotify:
+            w = xevent->xmap.window;
+            break;
+        case UnmapNotify:
+            w = xevent->xunmap.window;
+            break;
+        case DestroyNotify:
+            w = xevent->xdestroywindow.window;
+            break;
+        default:
+            return FALSE;
+    }
+
+    if ((w == c->frame) || (w == c->window))
+    {
+        return FALSE;
+    }
+    if ((passdata->wireframe) && (w == passdata->wireframe->xwindow))
+    {
+        return FALSE;
+    }
+
+    c2 = myDisplayGetClientFromWindow (c->screen_info->display_info, w,
+                                       SEARCH_FRAME | SEARCH_WINDOW);
+    return ((c2 != NULL) && (c2 != c));
+}
+
 static eventFilterStatus
 clientMoveEventFilter (XfwmEvent *event, gpointer data)
 {
@@ -995,16 +1365,22 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
     }
     else if (event->meta.type == XFWM_EVENT_BUTTON && !event->button.pressed)
     {
+        clientMotionFlush (passdata);
         moving = FALSE;
         passdata->released = (passdata->use_keys ||
                               passdata->button == AnyButton ||
                               passdata->button == event->button.button);
     }
+    else if (event->meta.type == XFWM_EVENT_MOTION && clientMotionDefer (passdata, event))
+    {
+        /* Applied at the end of the display frame */
+    }
     else if (event->meta.type == XFWM_EVENT_MOTION)
     {
         while (xfwm_device_check_mask_event (display_info->devices, display_info->dpy,
                                              PointerMotionMask | ButtonMotionMask, event))
         {
+            passdata->motion_received++;
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, event);
         }
@@ -1058,7 +1434,7 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
         c->x = passdata->ox + (event->motion.x_root - passdata->mx);
         c->y = passdata->oy + (event->motion.y_root - passdata->my);
 
-        clientSnapPosition (c, prev_x, prev_y);
+        clientSnapPosition (passdata, prev_x, prev_y);
         if (clientMoveTile (c, &event->motion))
         {
             passdata->configure_flags = CFG_FORCE_REDRAW;
@@ -1086,6 +1462,10 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
                 clientDrawOutline (c);
             }
         }
+        else if (clientMoveLazy (passdata))
+        {
+            /* Only the composited picture moved, the window follows later */
+        }
         else
         {
             int changes = CWX | CWY;
@@ -1103,6 +1483,7 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
             clientConfigure (c, &wc, changes, passdata->configure_flags);
             /* Configure applied, clear the flags */
             passdata->configure_flags = NO_CFG_FLAG;
+            passdata->last_configure = g_get_monotonic_time ();
         }
     }
     else if ((event->meta.xevent->type == UnmapNotify) && (event->meta.window == c->window))
@@ -1121,6 +1502,12 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
     }
     else
     {
+        if (passdata->snap_edges && clientMoveChangesOthers (c, passdata, event->meta.xevent))
+        {
+            /* Gather the snap edges again on the next motion */
+            snapEdgesFree (passdata->snap_edges);
+            passdata->snap_edges = NULL;
+        }
         status = EVENT_FILTER_CONTINUE;
     }
 
@@ -1181,7 +1568,10 @@ clientMove (Client * c, XfwmEventButton *event)
     passdata.button = AnyButton;
     passdata.is_transient = clientIsValidTransientOrModal (c);
     passdata.move_resized = FALSE;
+    passdata.translated = FALSE;
+    passdata.last_configure = 0;
     passdata.wireframe = NULL;
+    passdata.snap_edges = NULL;
 
     clientSaveSizePos (c);
 
@@ -1246,12 +1636,18 @@ clientMove (Client * c, XfwmEventButton *event)
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering move loop");
+    clientMotionInit (&passdata, clientMoveEventFilter);
     eventFilterPush (display_info->xfilter, clientMoveEventFilter, &passdata);
     gtk_main ();
     eventFilterPop (display_info->xfilter);
+    clientMotionStop (&passdata);
     TRACE ("leaving move loop");
     if (passdata.client_gone)
     {
+        if (passdata.translated)
+        {
+            compositorEndTranslateWindow (display_info, c->frame);
+        }
         goto move_cleanup;
     }
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
@@ -1276,6 +1672,18 @@ clientMove (Client * c, XfwmEventButton *event)
     }
     clientConfigure (c, &wc, changes, passdata.configure_flags);
 
+    /*
+     * Stop translating only once the frame is configured, and tell the
+     * compositor where it went rather than waiting for the ConfigureNotify,
+     * otherwise it is painted back at its old position for a frame.
+     */
+    if (passdata.translated)
+    {
+        compositorResizeWindow (display_info, c->frame, frameX (c), frameY (c),
+                                frameWidth (c), frameHeight (c));
+        compositorEndTranslateWindow (display_info, c->frame);
+    }
+
     if (passdata.button != AnyButton && !passdata.released)
     {
         /* If this is a drag-move, wait for the button to be released.
@@ -1301,6 +1709,7 @@ move_cleanup:
     {
         wireframeDelete (passdata.wireframe);
     }
+    snapEdgesFree (passdata.snap_edges);
 
     myScreenUngrabKeyboard (screen_info, myDisplayGetCurrentTime (display_info));
     myScreenUngrabPointer (screen_info, myDisplayGetCurrentTime (display_info));
@@ -1354,7 +1763,12 @@ clientResizeConfigure (Client *c, int pw, int ph)
         return;
     }
 #ifdef HAVE_XSYNC
-    if (!FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_WAITING))
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_WAITING))
+    {
+        /* Applied once the client has drawn the previous size */
+        FLAG_SET (c->flags, CLIENT_FLAG_XSYNC_CONFIGURE);
+    }
+    else
     {
         if ((display_info->have_xsync) &&
             (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_ENABLED)) &&
@@ -1535,11 +1949,16 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
             resizing = clientKeyPressIsModifier(&event->key);
         }
     }
+    else if (event->meta.type == XFWM_EVENT_MOTION && clientMotionDefer (passdata, event))
+    {
+        /* Applied at the end of the display frame */
+    }
     else if (event->meta.type == XFWM_EVENT_MOTION)
     {
         while (xfwm_device_check_mask_event (display_info->devices, display_info->dpy,
                                              ButtonMotionMask | PointerMotionMask, event))
         {
+            passdata->motion_received++;
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, event);
         }
@@ -1644,6 +2063,7 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
     }
     else if (event->meta.type == XFWM_EVENT_BUTTON && !event->button.pressed)
     {
+        clientMotionFlush (passdata);
         resizing = FALSE;
         passdata->released = (passdata->use_keys ||
                               passdata->button == AnyButton ||
@@ -1732,6 +2152,7 @@ clientResize (Client * c, int handle, XfwmEventButton *event)
     passdata.button = AnyButton;
     passdata.handle = handle;
     passdata.wireframe = NULL;
+    passdata.snap_edges = NULL;
     w_orig = c->width;
     h_orig = c->height;
 
@@ -1800,9 +2221,11 @@ clientResize (Client * c, int handle, XfwmEventButton *event)
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering resize loop");
+    clientMotionInit (&passdata, clientResizeEventFilter);
     eventFilterPush (display_info->xfilter, clientResizeEventFilter, &passdata);
     gtk_main ();
     eventFilterPop (display_info->xfilter);
+    clientMotionStop (&passdata);
     TRACE ("leaving resize loop");
     if (passdata.client_gone)
     {
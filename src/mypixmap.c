@@ -69,9 +69,10 @@ XPMColor;
 
 struct file_handle
 {
-    FILE *infile;
+    const gchar *pos;
+    const gchar *end;
     gchar *buffer;
-    guint buffer_size;
+    gsize buffer_size;
 };
 
 /* The following 2 routines (parse_color, find_color) come from Tk, via the Win32
@@ -118,20 +119,38 @@ struct file_handle
  * terms specified in this license.
  */
 
-static int
-compare_xcolor_entries (const void *a, const void *b)
+/* Same as the one gen-color-table.pl uses to build xColorHash */
+static guint32
+color_name_hash (const char *name)
 {
-    return g_ascii_strcasecmp ((const char *) a,
-                               color_names + ((const XPMColorEntry *) b)->name_offset);
+    guint32 hash;
+
+    hash = 2166136261U;
+    for (; *name; name++)
+    {
+        hash = (hash ^ (guchar) g_ascii_tolower (*name)) * 16777619U;
+    }
+
+    return hash;
 }
 
 static gboolean
 find_color(const char *name, XPMColor *colorPtr)
 {
-    XPMColorEntry *found;
+    const XPMColorEntry *found;
+    guint slot, index;
 
-    found = bsearch (name, xColors, G_N_ELEMENTS (xColors), sizeof (XPMColorEntry),
-                     compare_xcolor_entries);
+    found = NULL;
+    slot = color_name_hash (name) & (XPM_COLOR_HASH_SIZE - 1);
+    while ((index = xColorHash[slot]) != 0)
+    {
+        if (!g_ascii_strcasecmp (name, color_names + xColors[index - 1].name_offset))
+        {
+            found = &xColors[index - 1];
+            break;
+        }
+        slot = (slot + 1) & (XPM_COLOR_HASH_SIZE - 1);
+    }
     if (found == NULL)
     {
         return FALSE;
@@ -157,6 +176,10 @@ parse_color (const char *spec, XPMColor   *colorPtr)
                 return FALSE;
         }
         i /= 3;
+        if (i > 4)
+        {
+            return FALSE;
+        }
 
         g_snprintf (fmt, 16, "%%%dx%%%dx%%%dx", i, i, i);
 
@@ -200,19 +223,26 @@ parse_color (const char *spec, XPMColor   *colorPtr)
 }
 
 static gint
-xpm_seek_string (FILE *infile, const gchar *str)
+xpm_seek_string (struct file_handle *h, const gchar *str)
 {
-    char instr[1024];
+    const gchar *start;
+    gsize len;
 
-    while (!feof (infile))
+    len = strlen (str);
+    while (h->pos < h->end)
     {
-        if (fscanf (infile, "%1023s", instr) < 0)
+        while (h->pos < h->end && g_ascii_isspace (*h->pos))
         {
-                return FALSE;
+            h->pos++;
         }
-        if (strcmp (instr, str) == 0)
+        start = h->pos;
+        while (h->pos < h->end && !g_ascii_isspace (*h->pos))
         {
-                return TRUE;
+            h->pos++;
+        }
+        if ((gsize) (h->pos - start) == len && !memcmp (start, str, len))
+        {
+            return TRUE;
         }
     }
 
@@ -220,105 +250,62 @@ xpm_seek_string (FILE *infile, const gchar *str)
 }
 
 static gint
-xpm_seek_char (FILE *infile, gchar c)
+xpm_seek_char (struct file_handle *h, gchar c)
 {
-    gint b, oldb;
+    const gchar *p;
 
-    while ((b = getc (infile)) != EOF)
+    for (p = h->pos; p < h->end; p++)
     {
-        if (c != b && b == '/')
+        if (*p == c)
         {
-            b = getc (infile);
-            if (b == EOF)
+            h->pos = p + 1;
+            return TRUE;
+        }
+        else if (*p == '/' && p + 1 < h->end && p[1] == '*')
+        {   /* we have a comment */
+            p += 2;
+            do
             {
-                return FALSE;
-            }
-            else if (b == '*')
-            {   /* we have a comment */
-                 b = -1;
-                 do
-                 {
-                     oldb = b;
-                     b = getc (infile);
-                     if (b == EOF)
-                     {
-                             return FALSE;
-                     }
-                 }
-                 while (!(oldb == '*' && b == '/'));
+                p = memchr (p, '*', h->end - p);
+                if (!p || ++p == h->end)
+                {
+                    h->pos = h->end;
+                    return FALSE;
+                }
             }
-        }
-        else if (c == b)
-        {
-            return TRUE;
+            while (*p != '/');
         }
     }
+    h->pos = h->end;
 
     return FALSE;
 }
 
 static gint
-xpm_read_string (FILE *infile, gchar **buffer, guint *buffer_size)
+xpm_read_string (struct file_handle *h, const gchar **string, gsize *length)
 {
-    gint c;
-    guint cnt = 0, bufsiz, ret;
-    gchar *buf;
+    const gchar *start, *end;
 
-    buf = *buffer;
-    bufsiz = *buffer_size;
-    ret = FALSE;
-
-    if (buf == NULL)
-    {
-        bufsiz = 10 * sizeof (gchar);
-        buf = g_new (gchar, bufsiz);
-    }
-
-    do
+    start = memchr (h->pos, '"', h->end - h->pos);
+    if (!start)
     {
-        c = getc (infile);
+        h->pos = h->end;
+        return FALSE;
     }
-    while (c != EOF && c != '"');
+    start++;
 
-    if (c != '"')
+    end = memchr (start, '"', h->end - start);
+    if (!end)
     {
-        goto out;
+        h->pos = h->end;
+        return FALSE;
     }
-    while ((c = getc (infile)) != EOF)
-    {
-        if (cnt == bufsiz)
-        {
-            guint new_size = bufsiz * 2;
-
-            if (new_size > bufsiz)
-            {
-                bufsiz = new_size;
-            }
-            else
-            {
-                goto out;
-            }
-            buf = g_realloc (buf, bufsiz);
-            buf[bufsiz - 1] = '\0';
-        }
 
-        if (c != '"')
-        {
-            buf[cnt++] = c;
-        }
-        else
-        {
-            buf[cnt] = 0;
-            ret = TRUE;
-            break;
-        }
-    }
+    *string = start;
+    *length = end - start;
+    h->pos = end + 1;
 
-out:
-    buf[bufsiz - 1] = '\0';     /* ensure null termination for errors */
-    *buffer = buf;
-    *buffer_size = bufsiz;
-    return ret;
+    return TRUE;
 }
 
 static const gchar *
@@ -474,20 +461,25 @@ xpm_extract_color (const gchar *buffer, xfwmColorSymbol *color_sym)
     }
 }
 
+/*
+ * Pixel rows point straight into the mapped file and are not nul
+ * terminated, the header and colormap are copied to be parsed.
+ */
 static const gchar *
-file_buffer (enum buf_op op, gpointer handle)
+file_buffer (enum buf_op op, gpointer handle, gsize *length)
 {
     struct file_handle *h;
+    const gchar *string;
 
     h = handle;
     switch (op)
     {
         case op_header:
-            if (xpm_seek_string (h->infile, "XPM") != TRUE)
+            if (xpm_seek_string (h, "XPM") != TRUE)
             {
                 break;
             }
-            if (xpm_seek_char (h->infile, '{') != TRUE)
+            if (xpm_seek_char (h, '{') != TRUE)
             {
                 break;
             }
@@ -495,16 +487,29 @@ file_buffer (enum buf_op op, gpointer handle)
             FALLTHROUGH;
 
         case op_cmap:
-            xpm_seek_char (h->infile, '"');
-            fseek (h->infile, -1, SEEK_CUR);
+            if (xpm_seek_char (h, '"'))
+            {
+                h->pos--;
+            }
             /* Fall through to the xpm_read_string. */
             FALLTHROUGH;
 
         case op_body:
-            if(!xpm_read_string (h->infile, &h->buffer, &h->buffer_size))
+            if (!xpm_read_string (h, &string, length))
             {
                 return NULL;
             }
+            if (op == op_body)
+            {
+                return string;
+            }
+            if (*length >= h->buffer_size)
+            {
+                h->buffer_size = *length + 1;
+                h->buffer = g_realloc (h->buffer, h->buffer_size);
+            }
+            memcpy (h->buffer, string, *length);
+            h->buffer[*length] = '\0';
             return h->buffer;
 
         default:
@@ -523,14 +528,18 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
     gchar *name_buf;
     gint w, h, n_col, cpp, items;
     gint cnt, xcnt, ycnt, wbytes, n;
+    gsize length;
     GHashTable *color_hash;
     XPMColor *colors, *color, *fallbackcolor;
+    guint16 *color_index;
+    guint index;
     guchar *pixtmp;
     GdkPixbuf *pixbuf;
 
     fallbackcolor = NULL;
+    color_index = NULL;
 
-    buffer = file_buffer (op_header, handle);
+    buffer = file_buffer (op_header, handle, &length);
     if (!buffer)
     {
         g_warning ("Cannot read Pixmap header");
@@ -579,7 +588,7 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
     {
         gchar *color_name;
 
-        buffer = file_buffer (op_cmap, handle);
+        buffer = file_buffer (op_cmap, handle, &length);
         if (!buffer)
         {
             g_hash_table_destroy (color_hash);
@@ -617,10 +626,30 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
         }
     }
 
+    /* Pixels of one or two chars index the colors directly */
+    if ((cpp <= 2) && (n_col < G_MAXUINT16))
+    {
+        color_index = g_new0 (guint16, 1 << (8 * cpp));
+        for (cnt = 0; cnt < n_col; cnt++)
+        {
+            buffer = colors[cnt].color_string;
+            if (cpp == 1)
+            {
+                index = (guchar) buffer[0];
+            }
+            else
+            {
+                index = ((guchar) buffer[0] << 8) | (guchar) buffer[1];
+            }
+            color_index[index] = cnt + 1;
+        }
+    }
+
     pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, w, h);
 
     if (!pixbuf)
     {
+        g_free (color_index);
         g_hash_table_destroy (color_hash);
         g_free (colors);
         g_free (name_buf);
@@ -634,18 +663,33 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
     {
         pixtmp = gdk_pixbuf_get_pixels (pixbuf) + ycnt * gdk_pixbuf_get_rowstride(pixbuf);
 
-        buffer = file_buffer (op_body, handle);
-        if ((!buffer) || (wbytes > (gint) strlen (buffer)))
+        buffer = file_buffer (op_body, handle, &length);
+        if ((!buffer) || ((gsize) wbytes > length))
         {
             continue;
         }
 
         for (n = 0, cnt = 0, xcnt = 0; n < wbytes; n += cpp, xcnt++)
         {
-            strncpy (pixel_str, &buffer[n], cpp);
-            pixel_str[cpp] = 0;
+            if (color_index)
+            {
+                if (cpp == 1)
+                {
+                    index = color_index[(guchar) buffer[n]];
+                }
+                else
+                {
+                    index = color_index[((guchar) buffer[n] << 8) | (guchar) buffer[n + 1]];
+                }
+                color = index ? &colors[index - 1] : NULL;
+            }
+            else
+            {
+                strncpy (pixel_str, &buffer[n], cpp);
+                pixel_str[cpp] = 0;
 
-            color = g_hash_table_lookup (color_hash, pixel_str);
+                color = g_hash_table_lookup (color_hash, pixel_str);
+            }
 
             /* Bad XPM...punt */
             if (!color)
@@ -668,6 +712,7 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
         }
     }
 
+    g_free (color_index);
     g_hash_table_destroy (color_hash);
     g_free (colors);
     g_free (name_buf);
@@ -679,33 +724,32 @@ pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
 static GdkPixbuf *
 xpm_image_load (const char *filename, xfwmColorSymbol *color_sym)
 {
-    guchar buffer[1024];
+    GMappedFile *mapped;
     GdkPixbuf *pixbuf;
     struct file_handle h;
-    int size;
-    FILE *f;
+    gsize size;
 
     TRACE ("file %s", filename);
 
-    f = g_fopen (filename, "rb");
-    if (!f)
+    mapped = g_mapped_file_new (filename, FALSE, NULL);
+    if (!mapped)
     {
         return NULL;
     }
 
-    size = fread (&buffer, 1, sizeof (buffer), f);
+    size = g_mapped_file_get_length (mapped);
     if (size == 0)
     {
-        fclose (f);
+        g_mapped_file_unref (mapped);
         return NULL;
     }
 
-    fseek (f, 0, SEEK_SET);
     memset (&h, 0, sizeof (h));
-    h.infile = f;
+    h.pos = g_mapped_file_get_contents (mapped);
+    h.end = h.pos + size;
     pixbuf = pixbuf_create_from_xpm (&h, color_sym);
     g_free (h.buffer);
-    fclose (f);
+    g_mapped_file_unref (mapped);
 
     return pixbuf;
 }
@@ -948,19 +992,20 @@ xfwmPixmapRenderGdkPixbuf (xfwmPixmap * pm, GdkPixbuf *pixbuf)
     return TRUE;
 }
 
-gboolean
-xfwmPixmapLoad (ScreenInfo * screen_info, xfwmPixmap * pm, const gchar * dir, const gchar * file, xfwmColorSymbol * cs)
+/*
+ * Returns the image of a theme part, NULL if the theme has none.
+ */
+GdkPixbuf *
+xfwmPixmapLoadPixbuf (const gchar * dir, const gchar * file, xfwmColorSymbol * cs)
 {
     gchar *filename;
     gchar *filexpm;
     GdkPixbuf *pixbuf;
 
-    g_return_val_if_fail (pm != NULL, FALSE);
-    g_return_val_if_fail (dir != NULL, FALSE);
-    g_return_val_if_fail (file != NULL, FALSE);
-    TRACE ("pixmap %p, dir %s, file %s", pm, dir, file);
+    g_return_val_if_fail (dir != NULL, NULL);
+    g_return_val_if_fail (file != NULL, NULL);
+    TRACE ("dir %s, file %s", dir, file);
 
-    xfwmPixmapInit (screen_info, pm);
     /*
      * Always try to load the XPM first, using our own routine
      * that supports XPM color symbol susbstitution (used to
@@ -973,7 +1018,21 @@ xfwmPixmapLoad (ScreenInfo * screen_info, xfwmPixmap * pm, const gchar * dir, co
     g_free (filename);
 
     /* Compose with other image formats, if any available. */
-    pixbuf = xfwmPixmapCompose (pixbuf, dir, file);
+    return xfwmPixmapCompose (pixbuf, dir, file);
+}
+
+gboolean
+xfwmPixmapLoad (ScreenInfo * screen_info, xfwmPixmap * pm, const gchar * dir, const gchar * file, xfwmColorSymbol * cs)
+{
+    GdkPixbuf *pixbuf;
+
+    g_return_val_if_fail (pm != NULL, FALSE);
+    g_return_val_if_fail (dir != NULL, FALSE);
+    g_return_val_if_fail (file != NULL, FALSE);
+    TRACE ("pixmap %p, dir %s, file %s", pm, dir, file);
+
+    xfwmPixmapInit (screen_info, pm);
+    pixbuf = xfwmPixmapLoadPixbuf (dir, file, cs);
     if (!pixbuf)
     {
         /*
@@ -996,6 +1055,73 @@ xfwmPixmapLoad (ScreenInfo * screen_info, xfwmPixmap * pm, const gchar * dir, co
     return TRUE;
 }
 
+/*
+ * Create the pixmap from premultiplied ARGB32 pixels and its A1 mask,
+ * both laid out as cairo image surfaces of the given size.
+ */
+gboolean
+xfwmPixmapCreateFromData (ScreenInfo * screen_info, xfwmPixmap * pm, gint width, gint height,
+                          guchar *argb, guchar *mask)
+{
+    cairo_surface_t *dest_pixmap;
+    cairo_surface_t *dest_bitmap;
+    cairo_surface_t *src;
+    cairo_t *cr;
+
+    g_return_val_if_fail (pm != NULL, FALSE);
+    g_return_val_if_fail (argb != NULL, FALSE);
+    g_return_val_if_fail (mask != NULL, FALSE);
+    TRACE ("pixmap %p [%i×%i]", pm, width, height);
+
+    xfwmPixmapCreate (screen_info, pm, width, height);
+    if (xfwmPixmapNone (pm))
+    {
+        return FALSE;
+    }
+
+    dest_pixmap = xfwmPixmapCreateSurface (pm, FALSE);
+    dest_bitmap = xfwmPixmapCreateSurface (pm, TRUE);
+    if (!dest_pixmap || !dest_bitmap)
+    {
+        g_warning ("Cannot get pixmap");
+        if (dest_pixmap)
+        {
+            cairo_surface_destroy (dest_pixmap);
+        }
+        if (dest_bitmap)
+        {
+            cairo_surface_destroy (dest_bitmap);
+        }
+        return FALSE;
+    }
+
+    src = cairo_image_surface_create_for_data (argb, CAIRO_FORMAT_ARGB32, width, height,
+                                               cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width));
+    cr = cairo_create (dest_pixmap);
+    cairo_set_source_surface (cr, src, 0, 0);
+    cairo_paint (cr);
+    cairo_destroy (cr);
+    cairo_surface_destroy (src);
+
+    src = cairo_image_surface_create_for_data (mask, CAIRO_FORMAT_A1, width, height,
+                                               cairo_format_stride_for_width (CAIRO_FORMAT_A1, width));
+    cr = cairo_create (dest_bitmap);
+    cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface (cr, src, 0, 0);
+    cairo_paint (cr);
+    cairo_destroy (cr);
+    cairo_surface_destroy (src);
+
+    cairo_surface_destroy (dest_pixmap);
+    cairo_surface_destroy (dest_bitmap);
+
+#ifdef HAVE_RENDER
+    xfwmPixmapRefreshPict (pm);
+#endif
+
+    return TRUE;
+}
+
 void
 xfwmPixmapCreate (ScreenInfo * screen_info, xfwmPixmap * pm,
                   gint width, gint height)
@@ -1078,6 +1204,64 @@ xfwmPixmapNone (xfwmPixmap * pm)
     return (pm->pixmap == None);
 }
 
+/*
+ * Whether both pixmaps have the same shape. This reads the masks back
+ * from the server, so it is meant for theme loading, not drawing.
+ */
+gboolean
+xfwmPixmapSameMask (xfwmPixmap * pm1, xfwmPixmap * pm2)
+{
+    Display *dpy;
+    XImage *image1, *image2;
+    gboolean same;
+    gint x, y;
+
+    g_return_val_if_fail (pm1 != NULL, FALSE);
+    g_return_val_if_fail (pm2 != NULL, FALSE);
+    TRACE ("pixmap %p, pixmap %p", pm1, pm2);
+
+    if ((pm1->width != pm2->width) || (pm1->height != pm2->height))
+    {
+        return FALSE;
+    }
+    if ((pm1->mask == None) || (pm2->mask == None))
+    {
+        return (pm1->mask == pm2->mask);
+    }
+    if (pm1->mask == pm2->mask)
+    {
+        return TRUE;
+    }
+
+    dpy = myScreenGetXDisplay (pm1->screen_info);
+    image1 = XGetImage (dpy, pm1->mask, 0, 0, pm1->width, pm1->height, 1, XYPixmap);
+    image2 = XGetImage (dpy, pm2->mask, 0, 0, pm2->width, pm2->height, 1, XYPixmap);
+
+    same = (image1 && image2);
+    for (y = 0; same && (y < pm1->height); y++)
+    {
+        for (x = 0; x < pm1->width; x++)
+        {
+            if (XGetPixel (image1, x, y) != XGetPixel (image2, x, y))
+            {
+                same = FALSE;
+                break;
+            }
+        }
+    }
+
+    if (image1)
+    {
+        XDestroyImage (image1);
+    }
+    if (image2)
+    {
+        XDestroyImage (image2);
+    }
+
+    return same;
+}
+
 static void
 xfwmPixmapFillRectangle (Display *dpy, int screen, Pixmap pm, Drawable d,
                          int x, int y, int width, int height)
@@ -1132,6 +1316,75 @@ xfwmPixmapFill (xfwmPixmap * src, xfwmPixmap * dst,
 #endif
 }
 
+void
+xfwmPixmapClear (xfwmPixmap * pm)
+{
+    XGCValues gv;
+    GC gc;
+
+    TRACE ("pixmap %p [%i×%i]", pm, pm->width, pm->height);
+
+    if (pm->mask == None)
+    {
+        return;
+    }
+
+    gv.foreground = 0;
+    gc = XCreateGC (myScreenGetXDisplay (pm->screen_info), pm->mask, GCForeground, &gv);
+    XFillRectangle (myScreenGetXDisplay (pm->screen_info), pm->mask, gc,
+                    0, 0, pm->width, pm->height);
+    XFreeGC (myScreenGetXDisplay (pm->screen_info), gc);
+#ifdef HAVE_RENDER
+    xfwmPixmapRefreshPict (pm);
+#endif
+}
+
+void
+xfwmPixmapCopy (xfwmPixmap * src, xfwmPixmap * dst, gint src_x, gint src_y,
+                gint x, gint y, gint width, gint height)
+{
+    Display *dpy;
+    XGCValues gv;
+    GC gc;
+
+    TRACE ("src %p, dst %p, (%i,%i) [%i×%i]", src, dst, x, y, width, height);
+
+    width = MIN (width, src->width - src_x);
+    height = MIN (height, src->height - src_y);
+    if ((width < 1) || (height < 1) || (src->pixmap == None) || (dst->pixmap == None))
+    {
+        return;
+    }
+
+    dpy = myScreenGetXDisplay (src->screen_info);
+    /* Transparent parts of the source leave what is underneath untouched */
+    gv.clip_mask = src->mask;
+    gv.clip_x_origin = x - src_x;
+    gv.clip_y_origin = y - src_y;
+    gc = XCreateGC (dpy, dst->pixmap, GCClipMask | GCClipXOrigin | GCClipYOrigin, &gv);
+    XCopyArea (dpy, src->pixmap, dst->pixmap, gc, src_x, src_y, width, height, x, y);
+    XFreeGC (dpy, gc);
+
+    if (dst->mask == None)
+    {
+        return;
+    }
+
+    gv.foreground = 1;
+    gc = XCreateGC (dpy, dst->mask, GCForeground, &gv);
+    if (src->mask != None)
+    {
+        /* Only the opaque parts of the source are added to the mask */
+        XSetFunction (dpy, gc, GXor);
+        XCopyArea (dpy, src->mask, dst->mask, gc, src_x, src_y, width, height, x, y);
+    }
+    else
+    {
+        XFillRectangle (dpy, dst->mask, gc, x, y, width, height);
+    }
+    XFreeGC (dpy, gc);
+}
+
 void
 xfwmPixmapDuplicate (xfwmPixmap * src, xfwmPixmap * dst)
 {
@@ -58,11 +58,20 @@ struct _xfwmPixmap
 
 gboolean                 xfwmPixmapRenderGdkPixbuf              (xfwmPixmap *,
                                                                  GdkPixbuf *);
+GdkPixbuf               *xfwmPixmapLoadPixbuf                   (const gchar *,
+                                                                 const gchar *,
+                                                                 xfwmColorSymbol *);
 gboolean                 xfwmPixmapLoad                         (ScreenInfo *,
                                                                  xfwmPixmap *,
                                                                  const gchar *,
                                                                  const gchar *,
                                                                  xfwmColorSymbol *);
+gboolean                 xfwmPixmapCreateFromData               (ScreenInfo *,
+                                                                 xfwmPixmap *,
+                                                                 gint,
+                                                                 gint,
+                                                                 guchar *,
+                                                                 guchar *);
 void                     xfwmPixmapCreate                       (ScreenInfo *,
                                                                  xfwmPixmap *,
                                                                  gint,
@@ -71,12 +80,23 @@ void                     xfwmPixmapInit                         (ScreenInfo *,
                                                                  xfwmPixmap *);
 void                     xfwmPixmapFree                         (xfwmPixmap *);
 gboolean                 xfwmPixmapNone                         (xfwmPixmap *);
+gboolean                 xfwmPixmapSameMask                     (xfwmPixmap *,
+                                                                 xfwmPixmap *);
 void                     xfwmPixmapFill                         (xfwmPixmap *,
                                                                  xfwmPixmap *,
                                                                  gint,
                                                                  gint,
                                                                  gint,
                                                                  gint);
+void                     xfwmPixmapClear                        (xfwmPixmap *);
+void                     xfwmPixmapCopy                         (xfwmPixmap *,
+                                                                 xfwmPixmap *,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint);
 void                     xfwmPixmapDuplicate                    (xfwmPixmap *,
                                                                  xfwmPixmap *);
 cairo_surface_t         *xfwmPixmapCreateSurface                (xfwmPixmap *,
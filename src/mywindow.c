@@ -131,6 +131,31 @@ xfwmWindowCreate (ScreenInfo * screen_info, Visual *visual, gint depth, Window p
 #endif
 }
 
+/*
+ * Describe a window created elsewhere so the xfwmWindow helpers can be
+ * used on it. The window is not owned, never call xfwmWindowDelete() on it.
+ */
+void
+xfwmWindowAttach (ScreenInfo * screen_info, Visual *visual, gint depth, Window w,
+                  xfwmWindow * win, int width, int height)
+{
+    TRACE ("window (0x%lx)", w);
+
+    g_return_if_fail (screen_info != NULL);
+
+    win->window = w;
+    win->map = TRUE;
+    win->screen_info = screen_info;
+    win->x = 0;
+    win->y = 0;
+    win->width = width;
+    win->height = height;
+    xfwmWindowSetVisual (win, visual, depth);
+#ifdef HAVE_RENDER
+    win->pict_format = XRenderFindVisualFormat (myScreenGetXDisplay (screen_info), win->visual);
+#endif
+}
+
 void
 xfwmWindowDelete (xfwmWindow * win)
 {
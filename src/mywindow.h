@@ -75,6 +75,13 @@ void                     xfwmWindowTemp                         (ScreenInfo *,
                                                                  int,
                                                                  long,
                                                                  gboolean);
+void                     xfwmWindowAttach                       (ScreenInfo *,
+                                                                 Visual *,
+                                                                 gint,
+                                                                 Window,
+                                                                 xfwmWindow *,
+                                                                 int,
+                                                                 int);
 void                     xfwmWindowDelete                       (xfwmWindow *);
 void                     xfwmWindowShow                         (xfwmWindow *,
                                                                  int,
@@ -42,6 +42,7 @@
 #include "hints.h"
 #include "misc.h"
 #include "netwm.h"
+#include "placement.h"
 #include "screen.h"
 #include "stacking.h"
 #include "terminate.h"
@@ -955,37 +956,137 @@ clientGetInitialNetWmDesktop (Client * c)
     }
 }
 
-void
-clientSetNetClientList (ScreenInfo * screen_info, Atom a, GList * list)
+/*
+ * Only write what changed since the last update: nothing if the list is
+ * the same, the new windows if clients were only added at the end, and
+ * the whole list otherwise.
+ */
+static void
+clientWriteNetClientList (ScreenInfo *screen_info, Atom a, GList *list, GArray **written)
 {
-    Window *listw;
-    Window *index_dest;
+    GArray *listw;
     GList *index_src;
-    gint size, i;
+    Window w;
+    guint prefix;
 
-    TRACE ("entering");
-
-    size = g_list_length (list);
-    if (size < 1)
+    listw = g_array_sized_new (FALSE, FALSE, sizeof (Window), screen_info->client_count);
+    for (index_src = list; index_src; index_src = g_list_next (index_src))
     {
-        XDeleteProperty (myScreenGetXDisplay (screen_info), screen_info->xroot, a);
-        return;
+        Client *c = (Client *) index_src->data;
+        w = c->window;
+        g_array_append_val (listw, w);
     }
+    TRACE ("%i windows in list for %i clients", listw->len, screen_info->client_count);
 
-    listw = g_new (Window, size + 1);
-    if (listw)
+    prefix = 0;
+    if (*written)
     {
-        TRACE ("%i windows in list for %i clients", size, screen_info->client_count);
-        for (i = 0, index_dest = listw, index_src = list; i < size;
-            i++, index_dest++, index_src = g_list_next (index_src))
+        while ((prefix < (*written)->len) && (prefix < listw->len) &&
+               (g_array_index (*written, Window, prefix) == g_array_index (listw, Window, prefix)))
         {
-            Client *c = (Client *) index_src->data;
-            *index_dest = c->window;
+            prefix++;
         }
+    }
+
+    if (listw->len < 1)
+    {
+        XDeleteProperty (myScreenGetXDisplay (screen_info), screen_info->xroot, a);
+    }
+    else if ((*written) && (prefix == (*written)->len) && (prefix == listw->len))
+    {
+        TRACE ("list unchanged");
+    }
+    else if ((*written) && ((*written)->len > 0) && (prefix == (*written)->len))
+    {
         XChangeProperty (myScreenGetXDisplay (screen_info),
                          screen_info->xroot, a, XA_WINDOW, 32,
-                         PropModeReplace, (unsigned char *) listw, size);
-        g_free (listw);
+                         PropModeAppend, (unsigned char *) &g_array_index (listw, Window, prefix),
+                         listw->len - prefix);
+    }
+    else
+    {
+        XChangeProperty (myScreenGetXDisplay (screen_info),
+                         screen_info->xroot, a, XA_WINDOW, 32,
+                         PropModeReplace, (unsigned char *) listw->data, listw->len);
+    }
+
+    if (*written)
+    {
+        g_array_free (*written, TRUE);
+    }
+    *written = listw;
+}
+
+void
+clientFlushNetClientList (ScreenInfo * screen_info)
+{
+    DisplayInfo *display_info;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    display_info = screen_info->display_info;
+    if (screen_info->net_client_list_idle_id)
+    {
+        g_source_remove (screen_info->net_client_list_idle_id);
+        screen_info->net_client_list_idle_id = 0;
+    }
+
+    if (screen_info->net_client_list_dirty)
+    {
+        clientWriteNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST],
+                                  screen_info->windows, &screen_info->net_client_list);
+        screen_info->net_client_list_dirty = FALSE;
+    }
+
+    if (screen_info->net_client_list_stacking_dirty)
+    {
+        clientWriteNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING],
+                                  screen_info->windows_stack, &screen_info->net_client_list_stacking);
+        screen_info->net_client_list_stacking_dirty = FALSE;
+    }
+}
+
+static gboolean
+flush_net_client_list_idle_cb (gpointer data)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = (ScreenInfo *) data;
+    screen_info->net_client_list_idle_id = 0;
+    clientFlushNetClientList (screen_info);
+
+    return FALSE;
+}
+
+/*
+ * Mapping a bunch of windows at once would otherwise rewrite the lists
+ * and have every pager re-read them once per window, so the update is
+ * deferred until the event queue is drained.
+ */
+void
+clientSetNetClientList (ScreenInfo * screen_info, Atom a)
+{
+    DisplayInfo *display_info;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    display_info = screen_info->display_info;
+    if (a == display_info->atoms[NET_CLIENT_LIST])
+    {
+        screen_info->net_client_list_dirty = TRUE;
+    }
+    else if (a == display_info->atoms[NET_CLIENT_LIST_STACKING])
+    {
+        screen_info->net_client_list_stacking_dirty = TRUE;
+    }
+
+    if (screen_info->net_client_list_idle_id == 0)
+    {
+        screen_info->net_client_list_idle_id =
+            g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                             flush_net_client_list_idle_cb, screen_info, NULL);
     }
 }
 
@@ -1027,6 +1128,11 @@ clientValidateNetStrut (Client * c)
        valid = FALSE;
     }
 
+    if (!valid)
+    {
+        strutsInvalidate (screen_info);
+    }
+
     return valid;
 }
 
@@ -1136,6 +1242,7 @@ clientGetNetStruts (Client * c)
     new_flags = c->flags & (CLIENT_FLAG_HAS_STRUT | CLIENT_FLAG_HAS_STRUT_PARTIAL);
     if (old_flags != new_flags)
     {
+        strutsInvalidate (screen_info);
         return TRUE;
     }
 
@@ -1146,6 +1253,7 @@ clientGetNetStruts (Client * c)
         {
             if (old_struts[i] != c->struts[i])
             {
+                strutsInvalidate (screen_info);
                 return TRUE;
             }
         }
@@ -38,13 +38,15 @@
 #include "transients.h"
 #include "workspaces.h"
 #include "frame.h"
+#include "frameindex.h"
 #include "netwm.h"
+#include "smart_placement.h"
 
 #define MAX_VALID_STRUT(n) (n / 4) /* 25% of available space */
 #define USE_CLIENT_STRUTS(c) (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE) && \
                               FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
 
-/* Compute rectangle overlap area */
+/* Compute segment overlap length */
 
 static inline unsigned long
 segment_overlap (int x0, int x1, int tx0, int tx1)
@@ -64,14 +66,6 @@ segment_overlap (int x0, int x1, int tx0, int tx1)
     return (x1 - x0);
 }
 
-static inline unsigned long
-overlap (int x0, int y0, int x1, int y1, int tx0, int ty0, int tx1, int ty1)
-{
-    /* Compute overlapping box */
-    return (segment_overlap (x0, x1, tx0, tx1)
-            * segment_overlap (y0, y1, ty0, ty1));
-}
-
 static void
 set_rectangle (GdkRectangle * rect, gint x, gint y, gint width, gint height)
 {
@@ -83,6 +77,88 @@ set_rectangle (GdkRectangle * rect, gint x, gint y, gint width, gint height)
     rect->height = height;
 }
 
+/*
+ * The struts of the visible clients, in client list order, and the free
+ * space they leave in the areas given to clientMaxSpace(). Built on first
+ * use and dropped by strutsInvalidate() when a strut, its visibility or
+ * the monitors change.
+ */
+struct _StrutsCache
+{
+    GArray *struts;
+    GArray *spaces;
+};
+
+typedef struct
+{
+    Client *c;
+    GdkRectangle left;
+    GdkRectangle right;
+    GdkRectangle top;
+    GdkRectangle bottom;
+} ClientStruts;
+
+typedef struct
+{
+    GdkRectangle area;
+    GdkRectangle space;
+} MaxSpace;
+
+#define STRUTS_CACHE_MAX_SPACES 32
+
+static StrutsCache *
+strutsGetCache (ScreenInfo *screen_info)
+{
+    StrutsCache *cache;
+    ClientStruts entry;
+    Client *c;
+    guint i;
+
+    if (screen_info->struts_cache)
+    {
+        return screen_info->struts_cache;
+    }
+
+    TRACE ("rebuilding struts cache");
+
+    cache = g_new0 (StrutsCache, 1);
+    cache->struts = g_array_new (FALSE, FALSE, sizeof (ClientStruts));
+    cache->spaces = g_array_new (FALSE, FALSE, sizeof (MaxSpace));
+
+    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    {
+        if (strutsToRectangles (c, &entry.left, &entry.right, &entry.top, &entry.bottom))
+        {
+            entry.c = c;
+            g_array_append_val (cache->struts, entry);
+        }
+    }
+    screen_info->struts_cache = cache;
+
+    return cache;
+}
+
+void
+strutsInvalidate (ScreenInfo *screen_info)
+{
+    StrutsCache *cache;
+
+    g_return_if_fail (screen_info != NULL);
+
+    cache = screen_info->struts_cache;
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    TRACE ("dropping struts cache");
+
+    g_array_free (cache->struts, TRUE);
+    g_array_free (cache->spaces, TRUE);
+    g_free (cache);
+    screen_info->struts_cache = NULL;
+}
+
 gboolean
 strutsToRectangles (Client *c,
                     GdkRectangle *left,
@@ -171,9 +247,11 @@ checkValidStruts (GdkRectangle *struts,
 void
 clientMaxSpace (ScreenInfo *screen_info, int *x, int *y, int *w, int *h)
 {
-    Client *c;
+    StrutsCache *cache;
+    ClientStruts *entry;
+    MaxSpace *space, new_space;
     guint i;
-    GdkRectangle top, left, right, bottom, area, initial, intersect;
+    GdkRectangle area, initial, intersect;
 
     g_return_if_fail (x != NULL);
     g_return_if_fail (y != NULL);
@@ -183,50 +261,66 @@ clientMaxSpace (ScreenInfo *screen_info, int *x, int *y, int *w, int *h)
     set_rectangle (&area, *x, *y, *w, *h);
     set_rectangle (&initial, *x, *y, *w, *h);
 
-    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    cache = strutsGetCache (screen_info);
+    for (i = 0; i < cache->spaces->len; i++)
     {
-        if (!USE_CLIENT_STRUTS(c))
+        space = &g_array_index (cache->spaces, MaxSpace, i);
+        if (gdk_rectangle_equal (&space->area, &initial))
         {
-            continue;
+            *x = space->space.x;
+            *y = space->space.y;
+            *w = space->space.width;
+            *h = space->space.height;
+            return;
         }
+    }
 
-        if (strutsToRectangles (c, &left, &right, &top, &bottom))
+    for (i = 0; i < cache->struts->len; i++)
+    {
+        entry = &g_array_index (cache->struts, ClientStruts, i);
+
+        /* Left */
+        if (checkValidStruts (&entry->left, &initial, STRUTS_LEFT) &&
+            gdk_rectangle_intersect (&entry->left, &area, &intersect))
         {
-            /* Left */
-            if (checkValidStruts (&left, &initial, STRUTS_LEFT) &&
-                gdk_rectangle_intersect (&left, &area, &intersect))
-            {
-                *x = *x + intersect.width;
-                *w = *w - intersect.width;
-                 set_rectangle (&area, *x, *y, *w, *h);
-            }
+            *x = *x + intersect.width;
+            *w = *w - intersect.width;
+             set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Right */
-            if (checkValidStruts (&right, &initial, STRUTS_RIGHT) &&
-                gdk_rectangle_intersect (&right, &area, &intersect))
-            {
-                *w = *w - intersect.width;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Right */
+        if (checkValidStruts (&entry->right, &initial, STRUTS_RIGHT) &&
+            gdk_rectangle_intersect (&entry->right, &area, &intersect))
+        {
+            *w = *w - intersect.width;
+            set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Top */
-            if (checkValidStruts (&top, &initial, STRUTS_TOP) &&
-                gdk_rectangle_intersect (&top, &area, &intersect))
-            {
-                *y = *y + intersect.height;
-                *h = *h - intersect.height;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Top */
+        if (checkValidStruts (&entry->top, &initial, STRUTS_TOP) &&
+            gdk_rectangle_intersect (&entry->top, &area, &intersect))
+        {
+            *y = *y + intersect.height;
+            *h = *h - intersect.height;
+            set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Bottom */
-            if (checkValidStruts (&bottom, &initial, STRUTS_BOTTOM) &&
-                gdk_rectangle_intersect (&bottom, &area, &intersect))
-            {
-                *h = *h - intersect.height;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Bottom */
+        if (checkValidStruts (&entry->bottom, &initial, STRUTS_BOTTOM) &&
+            gdk_rectangle_intersect (&entry->bottom, &area, &intersect))
+        {
+            *h = *h - intersect.height;
+            set_rectangle (&area, *x, *y, *w, *h);
         }
     }
+
+    if (cache->spaces->len >= STRUTS_CACHE_MAX_SPACES)
+    {
+        g_array_set_size (cache->spaces, 0);
+    }
+    new_space.area = initial;
+    set_rectangle (&new_space.space, *x, *y, *w, *h);
+    g_array_append_val (cache->spaces, new_space);
 }
 
 /* clientConstrainPos() is used when moving windows
@@ -251,6 +345,8 @@ clientConstrainPos (Client * c, gboolean show_full)
     gint screen_width, screen_height;
     guint ret;
     GdkRectangle top, left, right, bottom, win, monitor;
+    ClientStruts *entry;
+    GArray *struts;
     gint min_visible;
 
     g_return_val_if_fail (c != NULL, 0);
@@ -287,14 +383,22 @@ clientConstrainPos (Client * c, gboolean show_full)
             c->window);
         return 0;
     }
+
+    struts = strutsGetCache (screen_info)->struts;
     if (show_full)
     {
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (i = 0; i < struts->len; i++)
         {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
+            entry = &g_array_index (struts, ClientStruts, i);
+            c2 = entry->c;
+            if (c2 == c)
             {
                 continue;
             }
+            left = entry->left;
+            right = entry->right;
+            top = entry->top;
+            bottom = entry->bottom;
 
             /* right */
             if (checkValidStruts (&right, &monitor, STRUTS_RIGHT) &&
@@ -340,12 +444,18 @@ clientConstrainPos (Client * c, gboolean show_full)
             ret |= CLIENT_CONSTRAINED_TOP;
         }
 
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (i = 0; i < struts->len; i++)
         {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
+            entry = &g_array_index (struts, ClientStruts, i);
+            c2 = entry->c;
+            if (c2 == c)
             {
                 continue;
             }
+            left = entry->left;
+            right = entry->right;
+            top = entry->top;
+            bottom = entry->bottom;
 
             /* Left */
             if (checkValidStruts (&left, &monitor, STRUTS_LEFT) &&
@@ -400,12 +510,18 @@ clientConstrainPos (Client * c, gboolean show_full)
         }
 
         /* Struts and other partial struts */
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (i = 0; i < struts->len; i++)
         {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
+            entry = &g_array_index (struts, ClientStruts, i);
+            c2 = entry->c;
+            if (c2 == c)
             {
                 continue;
             }
+            left = entry->left;
+            right = entry->right;
+            top = entry->top;
+            bottom = entry->bottom;
 
             /* Right */
             if (checkValidStruts (&right, &monitor, STRUTS_RIGHT) &&
@@ -540,16 +656,22 @@ clientAutoMaximize (Client * c, int full_w, int full_h)
     }
 }
 
+/*
+ * Looks for the position with the least overlap with other frames,
+ * see smartPlacementSearch().
+ */
 static void
 smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
 {
     Client *c2;
     ScreenInfo *screen_info;
-    gfloat best_overlaps;
+    GPtrArray *candidates;
+    GArray *others;
+    GdkRectangle area;
     guint i;
-    gint test_x, test_y, xmax, ymax, best_x, best_y;
+    gint xmax, ymax, best_x, best_y;
     gint frame_height, frame_width, frame_left, frame_top;
-    gint c2_x, c2_y;
+    gint c2_x, c2_y, c2_frame_width, c2_frame_height;
     gint xmin, ymin;
 
     g_return_if_fail (c != NULL);
@@ -570,154 +692,48 @@ smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
     xmin = full_x + frameExtentLeft (c);
     ymin = full_y + frameExtentTop (c);
 
-    /* start with worst-case position at top-left */
-    best_overlaps = G_MAXFLOAT;
-    best_x = xmin;
-    best_y = ymin;
-
-    TRACE ("analyzing %i clients", screen_info->client_count);
-
-    test_y = ymin;
-    do
+    /* Frames that can overlap, looked up once for all the positions tested */
+    set_rectangle (&area, full_x, full_y, full_w, full_h);
+    candidates = g_ptr_array_new ();
+    frameIndexQuery (screen_info, &area, candidates);
+    others = g_array_sized_new (FALSE, FALSE, sizeof (GdkRectangle), candidates->len);
+    for (i = 0; i < candidates->len; i++)
     {
-        gint next_test_y = G_MAXINT;
-        gboolean first_test_x = TRUE;
-
-        TRACE ("testing y position %d", test_y);
-
-        test_x = xmin;
-        do
+        c2 = g_ptr_array_index (candidates, i);
+        if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
+            && (c->win_workspace == c2->win_workspace)
+            && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
         {
-            gfloat count_overlaps = 0.0;
-            gint next_test_x = G_MAXINT;
-            gint c2_next_test_x;
-            gint c2_next_test_y;
-            gint c2_frame_height;
-            gint c2_frame_width;
-
-            TRACE ("testing x position %d", test_x);
-
-            for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+            c2_x = frameExtentX (c2);
+            c2_frame_width = frameExtentWidth (c2);
+            if (c2_x >= full_x + full_w
+                || c2_x + c2_frame_width < full_x)
             {
-                if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
-                    && (c->win_workspace == c2->win_workspace)
-                    && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
-                {
-                    c2_x = frameExtentX (c2);
-                    c2_frame_width = frameExtentWidth (c2);
-                    if (c2_x >= full_x + full_w
-                        || c2_x + c2_frame_width < full_x)
-                    {
-                        /* skip clients on right-of or left-of monitor */
-                        continue;
-                    }
-
-                    c2_y = frameExtentY (c2);
-                    c2_frame_height = frameExtentHeight (c2);
-                    if (c2_y >= full_y + full_h
-                        || c2_y + c2_frame_height < full_y)
-                    {
-                        /* skip clients on above-of or below-of monitor */
-                        continue;
-                    }
-
-                    count_overlaps += overlap (test_x - frame_left,
-                                               test_y - frame_top,
-                                               test_x - frame_left + frame_width,
-                                               test_y - frame_top + frame_height,
-                                               c2_x,
-                                               c2_y,
-                                               c2_x + c2_frame_width,
-                                               c2_y + c2_frame_height);
-
-                    /* find the next x boundy for the step */
-                    if (test_x > c2_x)
-                    {
-                        /* test location is beyond the x of the window,
-                         * take the window right corner as next target */
-                        c2_x += c2_frame_width;
-                    }
-                    c2_next_test_x = MIN (c2_x, xmax);
-                    if (c2_next_test_x < next_test_x
-                        && c2_next_test_x > test_x)
-                    {
-                        /* set new optimal next x step position */
-                        next_test_x = c2_next_test_x;
-                    }
-
-                    if (first_test_x)
-                    {
-                        /* find the next y boundry step */
-                        if (test_y > c2_y)
-                        {
-                            /* test location is beyond the y of the window,
-                             * take the window bottom corner as next target */
-                            c2_y += c2_frame_height;
-                        }
-                        c2_next_test_y = MIN (c2_y, ymax);
-                        if (c2_next_test_y < next_test_y
-                            && c2_next_test_y > test_y)
-                        {
-                            /* set new optimal next y step position */
-                            next_test_y = c2_next_test_y;
-                        }
-                    }
-                }
-            }
-
-            /* don't look for the next y boundry this x row */
-            first_test_x = FALSE;
-
-            if (count_overlaps < best_overlaps)
-            {
-                /* found position with less overlap */
-                best_x = test_x;
-                best_y = test_y;
-                best_overlaps = count_overlaps;
-
-                if (count_overlaps == 0.0f)
-                {
-                    /* overlap is ideal, stop searching */
-                    TRACE ("found position without overlap");
-                    goto found_best;
-                }
+                /* skip clients on right-of or left-of monitor */
+                continue;
             }
 
-            if (G_LIKELY (next_test_x != G_MAXINT))
+            c2_y = frameExtentY (c2);
+            c2_frame_height = frameExtentHeight (c2);
+            if (c2_y >= full_y + full_h
+                || c2_y + c2_frame_height < full_y)
             {
-                test_x = MAX (next_test_x, next_test_x + frameExtentLeft (c));
-                if (test_x > xmax)
-                {
-                   /* always clamp on the monitor */
-                   test_x = xmax;
-                }
-            }
-            else
-            {
-                test_x++;
+                /* skip clients on above-of or below-of monitor */
+                continue;
             }
-        }
-        while (test_x <= xmax);
 
-        if (G_LIKELY (next_test_y != G_MAXINT))
-        {
-            test_y = MAX (next_test_y, next_test_y + frameExtentTop (c));
-            if (test_y > ymax)
-            {
-                /* always clamp on the monitor */
-                test_y = ymax;
-            }
-        }
-        else
-        {
-            test_y++;
+            g_array_set_size (others, others->len + 1);
+            set_rectangle (&g_array_index (others, GdkRectangle, others->len - 1),
+                           c2_x, c2_y, c2_frame_width, c2_frame_height);
         }
     }
-    while (test_y <= ymax);
+    g_ptr_array_free (candidates, TRUE);
 
-    found_best:
+    TRACE ("analyzing %i clients", others->len);
 
-    TRACE ("overlaps %f at %d,%d (x,y)", best_overlaps, best_x, best_y);
+    smartPlacementSearch (others, frame_left, frame_top, frame_width, frame_height,
+                          xmin, ymin, xmax, ymax, &best_x, &best_y);
+    g_array_free (others, TRUE);
 
     c->x = best_x;
     c->y = best_y;
@@ -43,6 +43,7 @@ gboolean                 strutsToRectangles                     (Client *,
 gboolean                 checkValidStruts                       (GdkRectangle * /* struts */,
                                                                  GdkRectangle * /* monitor */,
                                                                  int);
+void                     strutsInvalidate                       (ScreenInfo *);
 void                     clientMaxSpace                         (ScreenInfo *,
                                                                  int *,
                                                                  int *,
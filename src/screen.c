@@ -29,6 +29,7 @@
 #include <X11/extensions/shape.h>
 #include <X11/extensions/Xinerama.h>
 #include <glib.h>
+#include <stdlib.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <gtk/gtk.h>
@@ -51,7 +52,10 @@
 #include "misc.h"
 #include "mywindow.h"
 #include "compositor.h"
+#include "netwm.h"
 #include "ui_style.h"
+#include "frameindex.h"
+#include "placement.h"
 
 #ifndef WM_EXITING_TIMEOUT
 #define WM_EXITING_TIMEOUT 15 /*seconds */
@@ -96,7 +100,7 @@ myScreenSetWMAtom (ScreenInfo *screen_info, gboolean replace_wm)
     display_name = xfwm_make_display_name (screen_info->gscr);
     wm_name = gdk_x11_screen_get_window_manager_name (screen_info->gscr);
 
-    XSync (display_info->dpy, FALSE);
+    myDisplaySync (display_info, FALSE);
     current_wm = XGetSelectionOwner (display_info->dpy, wm_sn_atom);
     if (current_wm)
     {
@@ -243,11 +247,20 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     screen_info->workspace_names_items = 0;
 
     screen_info->windows_stack = NULL;
+    screen_info->windows_stack_last = NULL;
+    screen_info->applied_stack = NULL;
     screen_info->last_raise = NULL;
     screen_info->windows = NULL;
     screen_info->clients = NULL;
     screen_info->client_count = 0;
     screen_info->client_serial = 0L;
+    screen_info->motion_received = 0;
+    screen_info->motion_applied = 0;
+    screen_info->net_client_list = NULL;
+    screen_info->net_client_list_stacking = NULL;
+    screen_info->net_client_list_dirty = FALSE;
+    screen_info->net_client_list_stacking_dirty = FALSE;
+    screen_info->net_client_list_idle_id = 0;
     screen_info->button_handler_id = 0L;
 
     screen_info->key_grabs = 0;
@@ -306,6 +319,9 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
 
     screen_info->font_desc = NULL;
     screen_info->pango_attr_list = NULL;
+    screen_info->title_cache = NULL;
+    screen_info->title_cache_lru = NULL;
+    screen_info->pixmap_cache = NULL;
     screen_info->box_gc = None;
 
     for (i = 0; i < SIDE_COUNT; i++)
@@ -351,6 +367,7 @@ myScreenClose (ScreenInfo *screen_info)
     display_info = screen_info->display_info;
 
     clientUnframeAll (screen_info);
+    clientFlushNetClientList (screen_info);
     compositorUnmanageScreen (screen_info);
     closeSettings (screen_info);
 
@@ -373,6 +390,19 @@ myScreenClose (ScreenInfo *screen_info)
     xfwmWindowDelete (&screen_info->sidewalk[3]);
     XSetInputFocus (display_info->dpy, screen_info->xroot, RevertToPointerRoot, CurrentTime);
 
+    frameIndexFree (screen_info);
+    strutsInvalidate (screen_info);
+    if (screen_info->draw_batch_id)
+    {
+        g_source_remove (screen_info->draw_batch_id);
+        screen_info->draw_batch_id = 0;
+    }
+    if (screen_info->draw_batch)
+    {
+        g_queue_free (screen_info->draw_batch);
+        screen_info->draw_batch = NULL;
+    }
+
     g_free (screen_info->params);
     screen_info->params = NULL;
 
@@ -381,15 +411,35 @@ myScreenClose (ScreenInfo *screen_info)
 
     g_list_free (screen_info->windows_stack);
     screen_info->windows_stack = NULL;
+    screen_info->windows_stack_last = NULL;
+
+    if (screen_info->applied_stack)
+    {
+        g_array_free (screen_info->applied_stack, TRUE);
+        screen_info->applied_stack = NULL;
+    }
 
     g_list_free (screen_info->windows);
     screen_info->windows = NULL;
 
+    if (screen_info->net_client_list)
+    {
+        g_array_free (screen_info->net_client_list, TRUE);
+        screen_info->net_client_list = NULL;
+    }
+
+    if (screen_info->net_client_list_stacking)
+    {
+        g_array_free (screen_info->net_client_list_stacking, TRUE);
+        screen_info->net_client_list_stacking = NULL;
+    }
+
     if (screen_info->monitors_index)
     {
         g_array_free (screen_info->monitors_index, TRUE);
         screen_info->monitors_index = NULL;
     }
+    myScreenInvalidateMonitorCache (screen_info);
 
     if (screen_info->pango_attr_list)
     {
@@ -695,11 +745,186 @@ myScreenGetMonitorIndex (ScreenInfo *screen_info, gint idx)
     return (g_array_index (screen_info->monitors_index, gint, idx));
 }
 
+/*
+ * Monitor lookups run on every move, resize and placement, so the
+ * geometry of the logical monitors is taken from GDK once, when they
+ * change. Their edges cut the screen in a grid of cells, each holding
+ * the first monitor that covers it, found by bisecting the edges.
+ */
+struct _MonitorGrid
+{
+    GdkRectangle *monitors;
+    gint n_monitors;
+    gint *xs;
+    gint n_xs;
+    gint *ys;
+    gint n_ys;
+    gint *cells;
+};
+
+static gint
+compare_edges (gconstpointer a, gconstpointer b)
+{
+    gint edge_a = *((const gint *) a);
+    gint edge_b = *((const gint *) b);
+
+    return (edge_a > edge_b) - (edge_a < edge_b);
+}
+
+static gint
+sortEdges (gint *edges, gint n_edges)
+{
+    gint i, n;
+
+    qsort (edges, n_edges, sizeof (gint), compare_edges);
+    for (i = 0, n = 0; i < n_edges; i++)
+    {
+        if ((n == 0) || (edges[i] != edges[n - 1]))
+        {
+            edges[n++] = edges[i];
+        }
+    }
+
+    return n;
+}
+
+/* Index of the interval [edges[i], edges[i + 1]) holding value, or -1 */
+static gint
+findEdgeInterval (const gint *edges, gint n_edges, gint value)
+{
+    gint low, high, middle;
+
+    if ((n_edges < 2) || (value < edges[0]) || (value >= edges[n_edges - 1]))
+    {
+        return -1;
+    }
+
+    low = 0;
+    high = n_edges - 1;
+    while (high - low > 1)
+    {
+        middle = (low + high) / 2;
+        if (edges[middle] <= value)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static void
+myScreenFreeMonitorGrid (ScreenInfo *screen_info)
+{
+    MonitorGrid *grid;
+
+    grid = screen_info->monitor_grid;
+    if (grid == NULL)
+    {
+        return;
+    }
+
+    g_free (grid->monitors);
+    g_free (grid->xs);
+    g_free (grid->ys);
+    g_free (grid->cells);
+    g_free (grid);
+    screen_info->monitor_grid = NULL;
+}
+
+static void
+myScreenBuildMonitorGrid (ScreenInfo *screen_info, const GdkRectangle *monitors, gint n_monitors)
+{
+    MonitorGrid *grid;
+    const GdkRectangle *monitor;
+    gint i, col, row, col0, col1, row0, row1, n_cols;
+
+    myScreenFreeMonitorGrid (screen_info);
+
+    grid = g_new0 (MonitorGrid, 1);
+    grid->n_monitors = n_monitors;
+    grid->monitors = g_new (GdkRectangle, MAX (n_monitors, 1));
+    grid->xs = g_new (gint, MAX (2 * n_monitors, 1));
+    grid->ys = g_new (gint, MAX (2 * n_monitors, 1));
+    for (i = 0; i < n_monitors; i++)
+    {
+        grid->monitors[i] = monitors[i];
+        grid->xs[2 * i] = monitors[i].x;
+        grid->xs[2 * i + 1] = monitors[i].x + monitors[i].width;
+        grid->ys[2 * i] = monitors[i].y;
+        grid->ys[2 * i + 1] = monitors[i].y + monitors[i].height;
+    }
+    grid->n_xs = sortEdges (grid->xs, 2 * n_monitors);
+    grid->n_ys = sortEdges (grid->ys, 2 * n_monitors);
+
+    n_cols = MAX (grid->n_xs - 1, 0);
+    grid->cells = g_new (gint, MAX (n_cols * (grid->n_ys - 1), 1));
+    for (i = 0; i < n_cols * (grid->n_ys - 1); i++)
+    {
+        grid->cells[i] = -1;
+    }
+
+    for (i = 0; i < n_monitors; i++)
+    {
+        monitor = &grid->monitors[i];
+        if ((monitor->width <= 0) || (monitor->height <= 0))
+        {
+            continue;
+        }
+
+        col0 = findEdgeInterval (grid->xs, grid->n_xs, monitor->x);
+        col1 = findEdgeInterval (grid->xs, grid->n_xs, monitor->x + monitor->width - 1);
+        row0 = findEdgeInterval (grid->ys, grid->n_ys, monitor->y);
+        row1 = findEdgeInterval (grid->ys, grid->n_ys, monitor->y + monitor->height - 1);
+        for (row = row0; row <= row1; row++)
+        {
+            for (col = col0; col <= col1; col++)
+            {
+                if (grid->cells[row * n_cols + col] < 0)
+                {
+                    grid->cells[row * n_cols + col] = i;
+                }
+            }
+        }
+    }
+
+    TRACE ("%i monitors in a %ix%i grid", n_monitors, n_cols, MAX (grid->n_ys - 1, 0));
+    screen_info->monitor_grid = grid;
+}
+
+/* Snapshot the geometry of the current logical monitors */
+static void
+myScreenSnapshotMonitors (ScreenInfo *screen_info)
+{
+    GdkRectangle *monitors;
+    gint i, num_monitors;
+
+    num_monitors = 0;
+    if (screen_info->monitors_index)
+    {
+        num_monitors = screen_info->monitors_index->len;
+    }
+
+    monitors = g_new (GdkRectangle, MAX (num_monitors, 1));
+    for (i = 0; i < num_monitors; i++)
+    {
+        xfwm_get_monitor_geometry (screen_info->gscr,
+                                   myScreenGetMonitorIndex (screen_info, i),
+                                   &monitors[i], TRUE);
+    }
+    myScreenBuildMonitorGrid (screen_info, monitors, num_monitors);
+    g_free (monitors);
+}
+
 gboolean
 myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
 {
     gint i, j, num_monitors, previous_num_monitors;
-    GdkRectangle monitor, previous;
+    GdkRectangle *monitors;
     gboolean cloned;
 
     g_return_val_if_fail (screen_info != NULL, FALSE);
@@ -718,16 +943,18 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
      * over wider monitors)
      */
     num_monitors = xfwm_get_n_monitors (screen_info->gscr);
+    monitors = g_new (GdkRectangle, MAX (num_monitors, 1));
     for (i = 0; i < num_monitors; i++)
     {
-        xfwm_get_monitor_geometry (screen_info->gscr, i, &monitor, TRUE);
+        xfwm_get_monitor_geometry (screen_info->gscr, i, &monitors[screen_info->num_monitors], TRUE);
         cloned = FALSE;
-        for (j = 0; j < (gint) screen_info->monitors_index->len; j++)
+        for (j = 0; j < screen_info->num_monitors; j++)
         {
-            xfwm_get_monitor_geometry (screen_info->gscr, j, &previous, TRUE);
-            if ((previous.x == monitor.x) && (previous.y == monitor.y))
+            if ((monitors[j].x == monitors[screen_info->num_monitors].x) &&
+                (monitors[j].y == monitors[screen_info->num_monitors].y))
             {
                 cloned = TRUE;
+                break;
             }
         }
         if (!cloned)
@@ -736,6 +963,8 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
             g_array_append_val (screen_info->monitors_index , i);
         }
     }
+    myScreenBuildMonitorGrid (screen_info, monitors, screen_info->num_monitors);
+    g_free (monitors);
 
     TRACE ("physical monitor reported.: %i", num_monitors);
     TRACE ("logical views found.......: %i", screen_info->num_monitors);
@@ -753,6 +982,12 @@ myScreenInvalidateMonitorCache (ScreenInfo *screen_info)
     screen_info->cache_monitor.y = -1;
     screen_info->cache_monitor.width = 0;
     screen_info->cache_monitor.height = 0;
+
+    /* Taken again from GDK on the next lookup */
+    myScreenFreeMonitorGrid (screen_info);
+
+    /* Struts are clipped against the monitors and the screen size */
+    strutsInvalidate (screen_info);
 }
 
 /*
@@ -762,9 +997,10 @@ myScreenInvalidateMonitorCache (ScreenInfo *screen_info)
 void
 myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangle *rect)
 {
-    gint dx, dy, center_x, center_y, num_monitors, i;
+    MonitorGrid *grid;
+    gint dx, dy, center_x, center_y, col, row, i;
     guint32 distsquare, min_distsquare;
-    GdkRectangle monitor, nearest_monitor = { G_MAXINT, G_MAXINT, 0, 0 };
+    GdkRectangle *monitor, nearest_monitor = { G_MAXINT, G_MAXINT, 0, 0 };
 
     g_return_if_fail (screen_info != NULL);
     g_return_if_fail (rect != NULL);
@@ -779,26 +1015,33 @@ myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangl
         return;
     }
 
-    min_distsquare = G_MAXUINT32;
-    num_monitors = myScreenGetNumMonitors (screen_info);
-
-    for (i = 0; i < num_monitors; i++)
+    if (screen_info->monitor_grid == NULL)
     {
-        gint monitor_index;
-
-        monitor_index = myScreenGetMonitorIndex (screen_info, i);
-        xfwm_get_monitor_geometry (screen_info->gscr, monitor_index, &monitor, TRUE);
+        myScreenSnapshotMonitors (screen_info);
+    }
+    grid = screen_info->monitor_grid;
 
-        if ((x >= monitor.x) && (x < (monitor.x + monitor.width)) &&
-            (y >= monitor.y) && (y < (monitor.y + monitor.height)))
+    col = findEdgeInterval (grid->xs, grid->n_xs, x);
+    row = findEdgeInterval (grid->ys, grid->n_ys, y);
+    if ((col >= 0) && (row >= 0))
+    {
+        i = grid->cells[row * (grid->n_xs - 1) + col];
+        if (i >= 0)
         {
-            screen_info->cache_monitor = monitor;
+            screen_info->cache_monitor = grid->monitors[i];
             *rect = screen_info->cache_monitor;
             return;
         }
+    }
+
+    /* Off all monitors, use the one with the closest center */
+    min_distsquare = G_MAXUINT32;
+    for (i = 0; i < grid->n_monitors; i++)
+    {
+        monitor = &grid->monitors[i];
 
-        center_x = monitor.x + (monitor.width / 2);
-        center_y = monitor.y + (monitor.height / 2);
+        center_x = monitor->x + (monitor->width / 2);
+        center_y = monitor->y + (monitor->height / 2);
 
         dx = x - center_x;
         dy = y - center_y;
@@ -808,7 +1051,7 @@ myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangl
         if (distsquare < min_distsquare)
         {
             min_distsquare = distsquare;
-            nearest_monitor = monitor;
+            nearest_monitor = *monitor;
         }
     }
 
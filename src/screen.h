@@ -94,10 +94,19 @@ struct _ScreenInfo
 
     /* Window stacking, per screen */
     GList *windows_stack;
+    GList *windows_stack_last;
+    GArray *applied_stack;
     Client *last_raise;
     GList *windows;
     Client *clients;
     guint client_count;
+
+    /* _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING as last written */
+    GArray *net_client_list;
+    GArray *net_client_list_stacking;
+    gboolean net_client_list_dirty;
+    gboolean net_client_list_stacking_dirty;
+    guint net_client_list_idle_id;
     unsigned long client_serial;
     gint key_grabs;
     gint pointer_grabs;
@@ -106,6 +115,7 @@ struct _ScreenInfo
     GdkRGBA title_colors[2];
     GdkRGBA title_shadow_colors[2];
     xfwmPixmap buttons[BUTTON_COUNT][STATE_COUNT];
+    gboolean button_same_mask[BUTTON_COUNT];
     xfwmPixmap corners[CORNER_COUNT][2];
     xfwmPixmap sides[SIDE_COUNT][2];
     xfwmPixmap title[TITLE_COUNT][2];
@@ -117,6 +127,27 @@ struct _ScreenInfo
     /* Title font */
     PangoFontDescription *font_desc;
     PangoAttrList *pango_attr_list;
+    GHashTable *title_cache;
+    GQueue *title_cache_lru;
+
+    /* Side pixmaps shared between frames */
+    FramePixmapCache *pixmap_cache;
+
+    /* Frame shapes, kept on unmapped windows */
+    GHashTable *shape_cache;
+    GQueue *shape_cache_lru;
+    guint shape_cache_serial;
+
+    /* Pointer motion during moves and resizes, applied or merged */
+    guint motion_received;
+    guint motion_applied;
+
+    /* Frames waiting for a batched redraw */
+    GQueue *draw_batch;
+    guint draw_batch_id;
+
+    /* Where the visible frames are */
+    FrameIndex *frame_index;
 
     /* Screen data */
     Colormap cmap;
@@ -135,6 +166,7 @@ struct _ScreenInfo
 
     gint gnome_margins[4];
     gint margins[4];
+    StrutsCache *struts_cache;
     gint screen;
     guint current_ws;
     guint previous_ws;
@@ -143,6 +175,7 @@ struct _ScreenInfo
     GdkRectangle cache_monitor;
     gint num_monitors;
     GArray *monitors_index;
+    MonitorGrid *monitor_grid;
 
     /* Workspace definitions */
     guint workspace_count;
@@ -209,6 +242,9 @@ struct _ScreenInfo
     gint cursorOffsetX;
     gint cursorOffsetY;
     XRectangle cursorLocation;
+    XRectangle outlineLocation;
+    GdkRGBA outlineColor;
+    gboolean outlineVisible;
 
     guint wins_unredirected;
     gboolean compositor_active;
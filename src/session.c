@@ -72,6 +72,8 @@ typedef struct _match
     int screen;
     unsigned long flags;
     gboolean used;
+    /* Client window the entry was used for */
+    unsigned long used_by;
 }
 Match;
 
@@ -438,6 +440,7 @@ sessionLoadWindowStates (const gchar * filename)
                 matches[num_match - 1].desktop = 0;
                 matches[num_match - 1].screen = 0;
                 matches[num_match - 1].used = FALSE;
+                matches[num_match - 1].used_by = None;
                 matches[num_match - 1].flags = 0;
             }
             else if (!strcmp (s1, "[GEOMETRY]"))
@@ -657,6 +660,7 @@ matchWin (Client * c, Match * m)
                                 && (matches[i].client_leader == m->client_leader))
                             {
                                 matches[i].used = TRUE;
+                                matches[i].used_by = c->window;
                             }
                         }
                     }
@@ -698,6 +702,7 @@ sessionMatchWinToSM (Client * c)
         if (!matches[i].used && (c->screen_info->screen == matches[i].screen) && matchWin (c, &matches[i]))
         {
             matches[i].used = TRUE;
+            matches[i].used_by = c->window;
             c->x = matches[i].x;
             c->y = matches[i].y;
             c->width = matches[i].width;
@@ -719,6 +724,22 @@ sessionMatchWinToSM (Client * c)
     return FALSE;
 }
 
+void
+sessionUnmatchWin (Client * c)
+{
+    gint i;
+
+    g_return_if_fail (c != NULL);
+    for (i = 0; i < num_match; i++)
+    {
+        if (matches[i].used && (matches[i].used_by == c->window))
+        {
+            matches[i].used = FALSE;
+            matches[i].used_by = None;
+        }
+    }
+}
+
 static void
 sessionLoad (DisplayInfo *display_info)
 {
@@ -54,6 +54,12 @@ void                    sessionFreeWindowStates                 (void);
  */
 gboolean                sessionMatchWinToSM                     (Client *);
 
+/*
+ * Give back the saved session entries matched by a client that
+ * never got managed, so that another window can match them.
+ */
+void                    sessionUnmatchWin                       (Client *);
+
 /*
  * Initiate session, connect to session manager and
  * load saved states if the connection succeeds.
@@ -42,7 +42,9 @@
 #include "focus.h"
 #include "workspaces.h"
 #include "compositor.h"
+#include "frame.h"
 #include "ui_style.h"
+#include "themecache.h"
 
 #define CHANNEL_XFWM            "xfwm4"
 #define THEMERC                 "themerc"
@@ -383,6 +385,7 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     GValue tmp_val = { 0, };
     GValue tmp_val2 = { 0, };
     DisplayInfo *display_info;
+    ThemeCache *cache;
     xfwmColorSymbol colsym[ XPM_COLOR_SYMBOL_SIZE + 1 ];
     GtkWidget *widget;
     gchar *theme;
@@ -476,46 +479,73 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     gdk_rgba_parse (&screen_info->title_shadow_colors[ACTIVE], getStringValue ("active_text_shadow_color", rc));
     gdk_rgba_parse (&screen_info->title_shadow_colors[INACTIVE], getStringValue ("inactive_text_shadow_color", rc));
 
+    cache = themeCacheOpen (screen_info, theme, colsym);
     for (i = 0; i < SIDE_COUNT; i++)
     {
         if (i == SIDE_TOP)
             continue;  /* There is no top decoration per se. */
 
         g_snprintf(imagename, sizeof (imagename), "%s-active", side_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->sides[i][ACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->sides[i][ACTIVE], imagename);
 
         g_snprintf(imagename, sizeof (imagename), "%s-inactive", side_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->sides[i][INACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->sides[i][INACTIVE], imagename);
     }
     for (i = 0; i < CORNER_COUNT; i++)
     {
         g_snprintf(imagename, sizeof (imagename), "%s-active", corner_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->corners[i][ACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->corners[i][ACTIVE], imagename);
 
         g_snprintf(imagename, sizeof (imagename), "%s-inactive", corner_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->corners[i][INACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->corners[i][INACTIVE], imagename);
     }
     for (i = 0; i < BUTTON_COUNT; i++)
     {
         for (j = 0; j < STATE_COUNT; j++)
         {
             g_snprintf(imagename, sizeof (imagename), "%s-%s", button_names[i], button_state_names[j]);
-            xfwmPixmapLoad (screen_info, &screen_info->buttons[i][j], theme, imagename, colsym);
+            themeCacheLoadPixmap (cache, &screen_info->buttons[i][j], imagename);
         }
     }
     for (i = 0; i < TITLE_COUNT; i++)
     {
         g_snprintf(imagename, sizeof (imagename), "title-%d-active", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->title[i][ACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->title[i][ACTIVE], imagename);
 
         g_snprintf(imagename, sizeof (imagename), "title-%d-inactive", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->title[i][INACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->title[i][INACTIVE], imagename);
 
         g_snprintf(imagename, sizeof (imagename), "top-%d-active", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->top[i][ACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->top[i][ACTIVE], imagename);
 
         g_snprintf(imagename, sizeof (imagename), "top-%d-inactive", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->top[i][INACTIVE], theme, imagename, colsym);
+        themeCacheLoadPixmap (cache, &screen_info->top[i][INACTIVE], imagename);
+    }
+    /* Uploads the parts still being decoded */
+    themeCacheClose (cache);
+
+    /* Buttons shaped the same in every state need no reshape on hover */
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        xfwmPixmap *first = NULL;
+
+        screen_info->button_same_mask[i] = TRUE;
+        for (j = 0; j < STATE_COUNT; j++)
+        {
+            if (xfwmPixmapNone (&screen_info->buttons[i][j]))
+            {
+                continue;
+            }
+            if (!first)
+            {
+                first = &screen_info->buttons[i][j];
+            }
+            else if (!xfwmPixmapSameMask (first, &screen_info->buttons[i][j]))
+            {
+                screen_info->button_same_mask[i] = FALSE;
+                break;
+            }
+        }
     }
 
     screen_info->box_gc = createGC (screen_info, "#FFFFFF", GXxor, NULL, 2, TRUE);
@@ -691,6 +721,7 @@ loadSettings (ScreenInfo *screen_info)
         {"full_width_title", NULL, G_TYPE_BOOLEAN, TRUE},
         {"horiz_scroll_opacity", NULL, G_TYPE_BOOLEAN, FALSE},
         {"inactive_opacity", NULL, G_TYPE_INT, TRUE},
+        {"lazy_move", NULL, G_TYPE_BOOLEAN, TRUE},
         {"margin_bottom", NULL, G_TYPE_INT, FALSE},
         {"margin_left", NULL, G_TYPE_INT, FALSE},
         {"margin_right", NULL, G_TYPE_INT, FALSE},
@@ -718,6 +749,7 @@ loadSettings (ScreenInfo *screen_info)
         {"show_dock_shadow", NULL, G_TYPE_BOOLEAN, TRUE},
         {"show_frame_shadow", NULL, G_TYPE_BOOLEAN, TRUE},
         {"show_popup_shadow", NULL, G_TYPE_BOOLEAN, TRUE},
+        {"single_window_frame", NULL, G_TYPE_BOOLEAN, TRUE},
         {"snap_resist", NULL, G_TYPE_BOOLEAN, TRUE},
         {"snap_to_border", NULL, G_TYPE_BOOLEAN, TRUE},
         {"snap_to_windows", NULL, G_TYPE_BOOLEAN, TRUE},
@@ -764,6 +796,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("box_resize", rc);
     screen_info->params->box_move =
         getBoolValue ("box_move", rc);
+    screen_info->params->lazy_move =
+        getBoolValue ("lazy_move", rc);
     screen_info->params->click_to_focus =
         getBoolValue ("click_to_focus", rc);
     screen_info->params->cycle_apps_only =
@@ -828,6 +862,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("show_frame_shadow", rc);
     screen_info->params->show_popup_shadow =
         getBoolValue ("show_popup_shadow", rc);
+    screen_info->params->single_window_frame =
+        getBoolValue ("single_window_frame", rc);
     screen_info->params->snap_to_border =
         getBoolValue ("snap_to_border", rc);
     screen_info->params->snap_to_windows =
@@ -917,6 +953,9 @@ unloadTheme (ScreenInfo *screen_info)
 
     TRACE ("entering");
 
+    frameClearTitleCache (screen_info);
+    frameClearPixmapCache (screen_info);
+    frameClearShapeCache (screen_info);
     if (screen_info->font_desc != NULL)
     {
         pango_font_description_free (screen_info->font_desc);
@@ -1256,6 +1295,10 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->box_resize = g_value_get_boolean (value);
                 }
+                else if (!strcmp (name, "lazy_move"))
+                {
+                    screen_info->params->lazy_move = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "click_to_focus"))
                 {
                     screen_info->params->click_to_focus = g_value_get_boolean (value);
@@ -1381,6 +1424,11 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                     screen_info->params->show_popup_shadow = g_value_get_boolean (value);
                     reloadScreenSettings (screen_info, UPDATE_FRAME);
                 }
+                else if (!strcmp (name, "single_window_frame"))
+                {
+                    /* Only affects the windows framed from now on */
+                    screen_info->params->single_window_frame = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "snap_resist"))
                 {
                     screen_info->params->snap_resist = g_value_get_boolean (value);
@@ -219,6 +219,7 @@ struct _XfwmParams
     gboolean focus_new;
     gboolean full_width_title;
     gboolean horiz_scroll_opacity;
+    gboolean lazy_move;
     gboolean mousewheel_rollup;
     gboolean prevent_focus_stealing;
     gboolean raise_on_click;
@@ -230,6 +231,7 @@ struct _XfwmParams
     gboolean show_dock_shadow;
     gboolean show_frame_shadow;
     gboolean show_popup_shadow;
+    gboolean single_window_frame;
     gboolean snap_resist;
     gboolean snap_to_border;
     gboolean snap_to_windows;
@@ -0,0 +1,240 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <gdk/gdk.h>
+#include <stdlib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "smart_placement.h"
+
+typedef struct
+{
+    gint pos;
+    guint index;
+    gint slope;
+} OverlapEvent;
+
+static gint
+compare_overlap_events (gconstpointer a, gconstpointer b)
+{
+    gint pos_a = ((const OverlapEvent *) a)->pos;
+    gint pos_b = ((const OverlapEvent *) b)->pos;
+
+    return (pos_a > pos_b) - (pos_a < pos_b);
+}
+
+/* Compute segment overlap length */
+static gint
+segment_overlap (gint x0, gint x1, gint tx0, gint tx1)
+{
+    if (tx0 > x0)
+    {
+        x0 = tx0;
+    }
+    if (tx1 < x1)
+    {
+        x1 = tx1;
+    }
+    if (x1 <= x0)
+    {
+        return 0;
+    }
+    return (x1 - x0);
+}
+
+/*
+ * Positions to test along one axis. From each position, the next one
+ * puts the frame edge on the closest edge ahead of the other frames,
+ * their start or, once past it, their end. With no such edge, the next
+ * position is one pixel further. The positions do not depend on the
+ * other axis.
+ */
+static GArray *
+smartPlacementSteps (GArray *others, gboolean vertical, gint min, gint max, gint offset)
+{
+    GArray *steps;
+    GdkRectangle *rect;
+    gint test, next, edge;
+    guint i;
+
+    steps = g_array_new (FALSE, FALSE, sizeof (gint));
+    test = min;
+    do
+    {
+        g_array_append_val (steps, test);
+
+        next = G_MAXINT;
+        for (i = 0; i < others->len; i++)
+        {
+            rect = &g_array_index (others, GdkRectangle, i);
+            edge = vertical ? rect->y : rect->x;
+            if (test > edge)
+            {
+                edge += vertical ? rect->height : rect->width;
+            }
+            edge = MIN (edge, max);
+            if (edge < next && edge > test)
+            {
+                next = edge;
+            }
+        }
+
+        if (G_LIKELY (next != G_MAXINT))
+        {
+            /* always clamp on the monitor */
+            test = MIN (MAX (next, next + offset), max);
+        }
+        else
+        {
+            test++;
+        }
+    }
+    while (test <= max);
+
+    return steps;
+}
+
+/*
+ * Tests the positions row by row, from the top left, and stops at the
+ * first one without any overlap.
+ *
+ * Along a row, the overlap with each frame is a trapezoid function of
+ * the position, zero until our frame reaches it, growing, flat, then
+ * back to zero once past it. So the sum is swept along the row from
+ * the points where the slope changes, each frame weighted by how much
+ * it overlaps vertically with the row. The overlap is summed in exact
+ * integers, where it used to be summed in floats, which could round
+ * apart positions of nearly the same overlap.
+ */
+guint64
+smartPlacementSearch (GArray *others, gint frame_left, gint frame_top,
+                      gint frame_width, gint frame_height,
+                      gint xmin, gint ymin, gint xmax, gint ymax,
+                      gint *best_x, gint *best_y)
+{
+    GArray *steps_x, *steps_y;
+    GdkRectangle *rect;
+    OverlapEvent *events;
+    guint64 best_overlaps, count_overlaps;
+    gint64 *weights;
+    gint64 value, slope, pos;
+    guint i, j, k, n_events;
+    gint test_x, test_y;
+
+    g_return_val_if_fail (others != NULL, 0);
+    g_return_val_if_fail (best_x != NULL, 0);
+    g_return_val_if_fail (best_y != NULL, 0);
+
+    /* start with worst-case position at top-left */
+    best_overlaps = G_MAXUINT64;
+    *best_x = xmin;
+    *best_y = ymin;
+
+    steps_x = smartPlacementSteps (others, FALSE, xmin, xmax, frame_left);
+    steps_y = smartPlacementSteps (others, TRUE, ymin, ymax, frame_top);
+
+    /* Where the horizontal overlap with each frame changes slope,
+       in frame coordinates */
+    n_events = 4 * others->len;
+    events = g_new (OverlapEvent, MAX (n_events, 1));
+    for (i = 0; i < others->len; i++)
+    {
+        rect = &g_array_index (others, GdkRectangle, i);
+        events[4 * i].pos = rect->x - frame_width;
+        events[4 * i].slope = 1;
+        events[4 * i + 1].pos = rect->x;
+        events[4 * i + 1].slope = -1;
+        events[4 * i + 2].pos = rect->x + rect->width - frame_width;
+        events[4 * i + 2].slope = -1;
+        events[4 * i + 3].pos = rect->x + rect->width;
+        events[4 * i + 3].slope = 1;
+        for (j = 4 * i; j < 4 * i + 4; j++)
+        {
+            events[j].index = i;
+        }
+    }
+    qsort (events, n_events, sizeof (OverlapEvent), compare_overlap_events);
+    weights = g_new (gint64, MAX (others->len, 1));
+
+    for (j = 0; j < steps_y->len; j++)
+    {
+        test_y = g_array_index (steps_y, gint, j);
+        TRACE ("testing y position %d", test_y);
+
+        for (i = 0; i < others->len; i++)
+        {
+            rect = &g_array_index (others, GdkRectangle, i);
+            weights[i] = segment_overlap (test_y - frame_top,
+                                          test_y - frame_top + frame_height,
+                                          rect->y,
+                                          rect->y + rect->height);
+        }
+
+        value = 0;
+        slope = 0;
+        pos = 0;
+        k = 0;
+        for (i = 0; i < steps_x->len; i++)
+        {
+            test_x = g_array_index (steps_x, gint, i);
+
+            while ((k < n_events) && (events[k].pos <= test_x - frame_left))
+            {
+                value += slope * (events[k].pos - pos);
+                pos = events[k].pos;
+                slope += events[k].slope * weights[events[k].index];
+                k++;
+            }
+            count_overlaps = value + slope * (test_x - frame_left - pos);
+
+            if (count_overlaps < best_overlaps)
+            {
+                /* found position with less overlap */
+                *best_x = test_x;
+                *best_y = test_y;
+                best_overlaps = count_overlaps;
+
+                if (count_overlaps == 0)
+                {
+                    /* overlap is ideal, stop searching */
+                    TRACE ("found position without overlap");
+                    goto found_best;
+                }
+            }
+        }
+    }
+
+    found_best:
+
+    g_free (weights);
+    g_free (events);
+    g_array_free (steps_x, TRUE);
+    g_array_free (steps_y, TRUE);
+    TRACE ("overlaps %" G_GUINT64_FORMAT " at %d,%d (x,y)", best_overlaps, *best_x, *best_y);
+
+    return best_overlaps;
+}
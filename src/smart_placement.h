@@ -0,0 +1,53 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+#ifndef INC_SMART_PLACEMENT_H
+#define INC_SMART_PLACEMENT_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <gdk/gdk.h>
+
+/*
+ * The search behind the smart placement, on plain rectangles so that it
+ * does not depend on the rest of the window manager. The frame extends
+ * left and top of the client position, for width and height. Positions
+ * are tested from (xmin, ymin) to (xmax, ymax), others is an array of
+ * GdkRectangle, the frames to avoid. Returns the overlap at the best
+ * position found.
+ */
+guint64                  smartPlacementSearch                   (GArray * /* others */,
+                                                                 gint /* frame_left */,
+                                                                 gint /* frame_top */,
+                                                                 gint /* frame_width */,
+                                                                 gint /* frame_height */,
+                                                                 gint /* xmin */,
+                                                                 gint /* ymin */,
+                                                                 gint /* xmax */,
+                                                                 gint /* ymax */,
+                                                                 gint * /* best_x */,
+                                                                 gint * /* best_y */);
+
+#endif /* INC_SMART_PLACEMENT_H */
@@ -38,42 +38,251 @@
 #include "netwm.h"
 #include "transients.h"
 #include "frame.h"
+#include "frameindex.h"
+#include "placement.h"
 #include "focus.h"
 
 static guint raise_timeout = 0;
 
+/*
+ * screen_info->windows_stack holds the clients from bottom to top.
+ * Each client keeps its own link in there and the screen keeps the
+ * top most one, so that clients are found, moved and removed in the
+ * stack without walking it.
+ */
+static void
+clientStackUnlink (Client *c)
+{
+    ScreenInfo *screen_info;
+    GList *link;
+
+    screen_info = c->screen_info;
+    link = c->stack_link;
+    if (link == NULL)
+    {
+        return;
+    }
+
+    if (link == screen_info->windows_stack_last)
+    {
+        screen_info->windows_stack_last = g_list_previous (link);
+    }
+    screen_info->windows_stack = g_list_delete_link (screen_info->windows_stack, link);
+    c->stack_link = NULL;
+}
+
+/* Place the client right below sibling, or on top of the stack */
+static void
+clientStackInsertBelow (Client *c, Client *sibling)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = c->screen_info;
+    if (sibling && sibling->stack_link)
+    {
+        screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack,
+                                                           sibling->stack_link, c);
+        c->stack_link = g_list_previous (sibling->stack_link);
+    }
+    else if (screen_info->windows_stack_last)
+    {
+        c->stack_link = g_list_alloc ();
+        c->stack_link->data = c;
+        c->stack_link->prev = screen_info->windows_stack_last;
+        screen_info->windows_stack_last->next = c->stack_link;
+        screen_info->windows_stack_last = c->stack_link;
+    }
+    else
+    {
+        screen_info->windows_stack = g_list_append (NULL, c);
+        c->stack_link = screen_info->windows_stack;
+        screen_info->windows_stack_last = c->stack_link;
+    }
+}
+
+/* Place the client right above sibling, or at the bottom of the stack */
+static void
+clientStackInsertAbove (Client *c, Client *sibling)
+{
+    ScreenInfo *screen_info;
+    GList *above;
+
+    screen_info = c->screen_info;
+    if (sibling && sibling->stack_link)
+    {
+        above = g_list_next (sibling->stack_link);
+        clientStackInsertBelow (c, above ? (Client *) above->data : NULL);
+    }
+    else
+    {
+        screen_info->windows_stack = g_list_prepend (screen_info->windows_stack, c);
+        c->stack_link = screen_info->windows_stack;
+        if (screen_info->windows_stack_last == NULL)
+        {
+            screen_info->windows_stack_last = c->stack_link;
+        }
+    }
+}
+
+/* Move the client right below sibling, or on top of the stack */
+static void
+clientStackMoveBelow (Client *c, Client *sibling)
+{
+    clientStackUnlink (c);
+    clientStackInsertBelow (c, sibling);
+}
+
+/*
+ * Find which windows of the new stack can stay where they are, that is
+ * the longest run of windows already in the same relative order in the
+ * stack previously applied. Returns the number of windows to move.
+ */
+static guint
+clientGetStackUnchanged (GArray *applied, Window *xwinstack, guint nwindows, gboolean *keep)
+{
+    GHashTable *positions;
+    gint *seq, *tails, *prev;
+    guint i, length, lo, hi, mid;
+    gint k;
+
+    positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < applied->len; i++)
+    {
+        g_hash_table_insert (positions,
+                             GUINT_TO_POINTER (g_array_index (applied, Window, i)),
+                             GUINT_TO_POINTER (i + 1));
+    }
+
+    seq = g_new (gint, nwindows);
+    tails = g_new (gint, nwindows);
+    prev = g_new (gint, nwindows);
+    for (i = 0; i < nwindows; i++)
+    {
+        seq[i] = GPOINTER_TO_INT (g_hash_table_lookup (positions, GUINT_TO_POINTER (xwinstack[i]))) - 1;
+        keep[i] = FALSE;
+    }
+    g_hash_table_destroy (positions);
+
+    /* Longest increasing subsequence of the previous positions */
+    length = 0;
+    for (i = 0; i < nwindows; i++)
+    {
+        if (seq[i] < 0)
+        {
+            /* Not stacked by us so far */
+            continue;
+        }
+        lo = 0;
+        hi = length;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (seq[tails[mid]] < seq[i])
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        prev[i] = (lo > 0) ? tails[lo - 1] : -1;
+        tails[lo] = i;
+        if (lo == length)
+        {
+            length++;
+        }
+    }
+
+    for (k = (length > 0) ? tails[length - 1] : -1; k >= 0; k = prev[k])
+    {
+        keep[k] = TRUE;
+    }
+
+    g_free (seq);
+    g_free (tails);
+    g_free (prev);
+
+    return nwindows - length;
+}
+
+/*
+ * Restacking all the frames makes the server send a ConfigureNotify for
+ * each and every one of them, so only move the windows that are not in
+ * the same relative order as the last time, each one right below the
+ * window that precedes it in the new stack.
+ */
 void
 clientApplyStackList (ScreenInfo *screen_info)
 {
+    XWindowChanges wc;
     Window *xwinstack;
-    guint nwindows;
+    gboolean *keep;
+    guint nwindows, moved;
     gint i;
 
     DBG ("applying stack list");
-    nwindows = g_list_length (screen_info->windows_stack);
+    nwindows = screen_info->client_count + 4;
 
     i = 0;
-    xwinstack = g_new (Window, nwindows + 4);
+    xwinstack = g_new (Window, nwindows);
     xwinstack[i++] = MYWINDOW_XWINDOW (screen_info->sidewalk[0]);
     xwinstack[i++] = MYWINDOW_XWINDOW (screen_info->sidewalk[1]);
     xwinstack[i++] = MYWINDOW_XWINDOW (screen_info->sidewalk[2]);
     xwinstack[i++] = MYWINDOW_XWINDOW (screen_info->sidewalk[3]);
 
-    if (nwindows)
+    if (screen_info->windows_stack)
     {
         GList *list;
         Client *c = NULL;
 
-        for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+        for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
         {
             c = (Client *) list->data;
+            g_assert (i < (gint) nwindows);
             xwinstack[i++] = c->frame;
             DBG ("  [%i] \"%s\" (0x%lx)", i, c->name, c->window);
         }
     }
+    /* clientAddToList() and clientRemoveFromList() keep both in step */
+    g_assert (i == (gint) nwindows);
 
-    XRestackWindows (myScreenGetXDisplay (screen_info), xwinstack, (int) nwindows + 4);
+    keep = g_new (gboolean, nwindows);
+    moved = nwindows;
+    if (screen_info->applied_stack)
+    {
+        moved = clientGetStackUnchanged (screen_info->applied_stack, xwinstack, nwindows, keep);
+    }
 
+    /* The top most window is the reference the others are stacked against */
+    if ((moved + 1 >= nwindows) || !keep[0])
+    {
+        DBG ("restacking all %i windows", nwindows);
+        XRestackWindows (myScreenGetXDisplay (screen_info), xwinstack, (int) nwindows);
+    }
+    else
+    {
+        DBG ("restacking %i of %i windows", moved, nwindows);
+        wc.stack_mode = Below;
+        for (i = 1; i < (gint) nwindows; i++)
+        {
+            if (!keep[i])
+            {
+                wc.sibling = xwinstack[i - 1];
+                XConfigureWindow (myScreenGetXDisplay (screen_info), xwinstack[i],
+                                  CWSibling | CWStackMode, &wc);
+            }
+        }
+    }
+
+    if (screen_info->applied_stack == NULL)
+    {
+        screen_info->applied_stack = g_array_sized_new (FALSE, FALSE, sizeof (Window), nwindows);
+    }
+    g_array_set_size (screen_info->applied_stack, 0);
+    g_array_append_vals (screen_info->applied_stack, xwinstack, nwindows);
+
+    g_free (keep);
     g_free (xwinstack);
 }
 
@@ -163,7 +372,6 @@ clientGetTopMostForGroup (Client * c)
 gboolean
 clientIsTopMost (Client *c)
 {
-    ScreenInfo *screen_info;
     GList *list, *l2;
     Client *c2;
 
@@ -171,9 +379,7 @@ clientIsTopMost (Client *c)
 
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    screen_info = c->screen_info;
-
-    list = g_list_find (screen_info->windows_stack, (gconstpointer) c);
+    list = c->stack_link;
     if (list)
     {
         l2 = g_list_next (list);
@@ -257,13 +463,37 @@ clientAtPosition (ScreenInfo *screen_info, int x, int y, GList * exclude_list)
 {
     GList *list;
     Client *c, *c2;
+    GPtrArray *candidates;
+    GdkRectangle area;
+    guint i;
 
     TRACE ("(%i,%i)", x, y);
 
     c = NULL;
-    for (list = g_list_last (screen_info->windows_stack); list; list = g_list_previous (list))
+    area.x = x;
+    area.y = y;
+    area.width = 1;
+    area.height = 1;
+    candidates = g_ptr_array_new ();
+    frameIndexQuery (screen_info, &area, candidates);
+
+    /* Walk down the stack until all the frames near the point are seen */
+    for (list = screen_info->windows_stack_last; list && (candidates->len > 0); list = g_list_previous (list))
     {
         c2 = (Client *) list->data;
+        for (i = 0; i < candidates->len; i++)
+        {
+            if (g_ptr_array_index (candidates, i) == c2)
+            {
+                break;
+            }
+        }
+        if (i == candidates->len)
+        {
+            continue;
+        }
+        g_ptr_array_remove_index_fast (candidates, i);
+
         if ((frameX (c2) <= x) && (frameX (c2) + frameWidth (c2) >= x)
             && (frameY (c2) <= y) && (frameY (c2) + frameHeight (c2) >= y))
         {
@@ -275,64 +505,59 @@ clientAtPosition (ScreenInfo *screen_info, int x, int y, GList * exclude_list)
             }
         }
     }
+    g_ptr_array_free (candidates, TRUE);
 
     return c;
 }
 
+/*
+ * Raise the client right below client_sibling, or on top of the stack,
+ * along with its transients, transients of transients, etc. The raised
+ * windows end up next to each other, in the same order as before, the
+ * stack is walked in place around them.
+ */
 static void
 clientRaiseInternal (Client * c, Client * client_sibling)
 {
-    ScreenInfo *screen_info;
     Client *c2, *c3;
-    GList *l1, *l2;
+    GList *l1, *l2, *next;
     GList *transients;
-    GList *windows_stack_copy;
-    GList *sibling;
+    Client *sibling;
 
-    screen_info = c->screen_info;
     transients = NULL;
-
-    /* Copy the existing window stack temporarily as reference */
-    windows_stack_copy = g_list_copy (screen_info->windows_stack);
-    screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c);
+    clientStackUnlink (c);
     sibling = NULL;
 
-    if (client_sibling)
+    if (client_sibling && client_sibling->stack_link)
     {
-        /* If there is one, look for its place in the list */
-        sibling = g_list_find (screen_info->windows_stack, (gconstpointer) client_sibling);
-        /* Place the raised window just before it */
-        screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c);
-    }
-    else
-    {
-        /* There will be no window on top of the raised window, so place it at the end of list */
-        screen_info->windows_stack = g_list_append (screen_info->windows_stack, c);
+        /* If there is one, place the raised window just before it */
+        sibling = client_sibling;
     }
+    /* Without it, there will be no window on top of the raised window */
+    clientStackInsertBelow (c, sibling);
+
     /* Now, look for transients, transients of transients, etc. */
-    for (l1 = windows_stack_copy; l1; l1 = g_list_next (l1))
+    for (l1 = c->screen_info->windows_stack; l1; l1 = next)
     {
+        next = g_list_next (l1);
+        if (l1 == c->stack_link)
+        {
+            /* Skip the windows raised so far, they sit right below sibling */
+            next = (sibling ? sibling->stack_link : NULL);
+            continue;
+        }
+
         c2 = (Client *) l1->data;
         if (c2)
         {
             if ((c2 != c) && clientIsTransientOrModalFor (c2, c) && (c2->win_layer <= c->win_layer))
             {
-                transients = g_list_append (transients, c2);
-                if (sibling)
-                {
-                    /* Make sure client_sibling is not c2 otherwise we create a circular linked list */
-                    if (client_sibling != c2)
-                    {
-                        /* Place the transient window just before sibling */
-                        screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                        screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c2);
-                    }
-                }
-                else
+                transients = g_list_prepend (transients, c2);
+                /* Make sure client_sibling is not c2 otherwise we create a circular linked list */
+                if (!sibling || (client_sibling != c2))
                 {
-                    /* There will be no window on top of the transient window, so place it at the end of list */
-                    screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                    screen_info->windows_stack = g_list_append (screen_info->windows_stack, c2);
+                    /* Place the transient window just before sibling, or at the end of list */
+                    clientStackMoveBelow (c2, sibling);
                 }
             }
             else
@@ -342,22 +567,12 @@ clientRaiseInternal (Client * c, Client * client_sibling)
                     c3 = (Client *) l2->data;
                     if ((c3 != c2) && clientIsTransientOrModalFor (c2, c3))
                     {
-                        transients = g_list_append (transients, c2);
-                        if (sibling)
-                        {
-                            /* Again, make sure client_sibling is not c2 to avoid a circular linked list */
-                            if (client_sibling != c2)
-                            {
-                                /* Place the transient window just before sibling */
-                                screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                                screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c2);
-                            }
-                        }
-                        else
+                        transients = g_list_prepend (transients, c2);
+                        /* Again, make sure client_sibling is not c2 to avoid a circular linked list */
+                        if (!sibling || (client_sibling != c2))
                         {
-                            /* There will be no window on top of the transient window, so place it at the end of list */
-                            screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                            screen_info->windows_stack = g_list_append (screen_info->windows_stack, c2);
+                            /* Place the transient window just before sibling, or at the end of list */
+                            clientStackMoveBelow (c2, sibling);
                         }
                         break;
                     }
@@ -370,11 +585,6 @@ clientRaiseInternal (Client * c, Client * client_sibling)
     {
         g_list_free (transients);
     }
-
-    if (windows_stack_copy)
-    {
-        g_list_free (windows_stack_copy);
-    }
 }
 
 void
@@ -406,7 +616,7 @@ clientRaise (Client * c, Window wsibling)
         return;
     }
 
-    if (g_list_length (screen_info->windows_stack) < 2)
+    if (screen_info->client_count < 2)
     {
         return;
     }
@@ -418,7 +628,7 @@ clientRaise (Client * c, Window wsibling)
         c2 = myDisplayGetClientFromWindow (display_info, wsibling, SEARCH_FRAME | SEARCH_WINDOW);
         if (c2)
         {
-            sibling = g_list_find (screen_info->windows_stack, (gconstpointer) c2);
+            sibling = c2->stack_link;
             if (sibling)
             {
                 above_sibling = g_list_next (sibling);
@@ -451,7 +661,7 @@ clientRaise (Client * c, Window wsibling)
        We still need to tell the X Server to reflect the changes
      */
     clientApplyStackList (screen_info);
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
     screen_info->last_raise = c;
 }
 
@@ -463,7 +673,6 @@ clientLower (Client * c, Window wsibling)
     Client *c2, *client_sibling;
     GList *sibling;
     GList *list;
-    gint position;
 
     g_return_if_fail (c != NULL);
 
@@ -480,7 +689,7 @@ clientLower (Client * c, Window wsibling)
     sibling = NULL;
     c2 = NULL;
 
-    if (g_list_length (screen_info->windows_stack) < 2)
+    if (screen_info->client_count < 2)
     {
         return;
     }
@@ -498,7 +707,7 @@ clientLower (Client * c, Window wsibling)
         c2 = myDisplayGetClientFromWindow (display_info, wsibling, SEARCH_FRAME | SEARCH_WINDOW);
         if (c2)
         {
-            sibling = g_list_find (screen_info->windows_stack, (gconstpointer) c2);
+            sibling = c2->stack_link;
             if (sibling)
             {
                 list = g_list_previous (sibling);
@@ -523,28 +732,21 @@ clientLower (Client * c, Window wsibling)
 
     if (client_sibling != c)
     {
-        screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c);
-        /* Paranoid check to avoid circular linked list */
+        clientStackUnlink (c);
         if (client_sibling)
         {
-            sibling = g_list_find (screen_info->windows_stack, (gconstpointer) client_sibling);
-            position = g_list_position (screen_info->windows_stack, sibling) + 1;
-
-            screen_info->windows_stack = g_list_insert (screen_info->windows_stack, c, position);
-            TRACE ("lowest client is \"%s\" (0x%lx) at position %i",
-                    client_sibling->name, client_sibling->window, position);
-        }
-        else
-        {
-            screen_info->windows_stack = g_list_prepend (screen_info->windows_stack, c);
+            TRACE ("lowest client is \"%s\" (0x%lx)",
+                    client_sibling->name, client_sibling->window);
         }
+        /* Place it right above the sibling, or at the bottom without one */
+        clientStackInsertAbove (c, client_sibling);
     }
 
     /* Now, screen_info->windows_stack contains the correct window stack
        We still need to tell the X Server to reflect the changes
      */
     clientApplyStackList (screen_info);
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
     clientPassFocus (screen_info, c, NULL);
     if (screen_info->last_raise == c)
     {
@@ -607,10 +809,15 @@ clientAddToList (Client * c)
         c->prev = c;
     }
 
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+    {
+        strutsInvalidate (screen_info);
+    }
+
     screen_info->windows = g_list_append (screen_info->windows, c);
-    screen_info->windows_stack = g_list_append (screen_info->windows_stack, c);
+    clientStackInsertBelow (c, NULL);
 
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
+    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST]);
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MANAGED);
 }
@@ -646,11 +853,16 @@ clientRemoveFromList (Client * c)
         }
     }
 
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+    {
+        strutsInvalidate (screen_info);
+    }
+
     screen_info->windows = g_list_remove (screen_info->windows, c);
-    screen_info->windows_stack = g_list_remove (screen_info->windows_stack, c);
+    clientStackUnlink (c);
 
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST]);
+    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
 
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MANAGED);
 }
@@ -0,0 +1,610 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo/cairo.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "screen.h"
+#include "mypixmap.h"
+#include "themecache.h"
+
+/*
+ * The theme parts once loaded are kept in a file per theme directory and
+ * set of color symbols, in the user cache directory. The file is a header,
+ * a table of entries and then the data of each part: premultiplied ARGB32
+ * pixels followed by a A1 mask, as cairo image surfaces, so the parts are
+ * uploaded to the X server straight from the mapped file.
+ *
+ * The stamp is computed from the names, sizes and modification times of
+ * the files in the theme directory, a cache file with a different stamp
+ * is built again. Data is in the byte order of the machine.
+ *
+ * Each theme and color change gets a new file, so only the files used
+ * most recently are kept, going by their modification time, which is
+ * updated whenever a file is used.
+ */
+#define THEME_CACHE_MAGIC       "XFWMTHC1"
+#define THEME_CACHE_NAME_SIZE   32
+#define THEME_CACHE_STAMP_SIZE  48
+/* Parts are small, anything larger is a corrupted file */
+#define THEME_CACHE_MAX_SIZE    4096
+#define THEME_CACHE_MAX_FILES   8
+
+typedef struct
+{
+    gchar magic[8];
+    guint32 byte_order;
+    guint32 n_entries;
+    gchar stamp[THEME_CACHE_STAMP_SIZE];
+} ThemeCacheHeader;
+
+typedef struct
+{
+    gchar name[THEME_CACHE_NAME_SIZE];
+    /* Both 0 when the theme has no such part */
+    guint32 width;
+    guint32 height;
+    guint32 offset;
+    guint32 padding;
+} ThemeCacheEntry;
+
+typedef struct
+{
+    xfwmPixmap *pm;
+    gchar name[THEME_CACHE_NAME_SIZE];
+    GdkPixbuf *pixbuf;
+} ThemeCacheJob;
+
+typedef struct
+{
+    gchar *filename;
+    gint64 mtime;
+} ThemeCacheFile;
+
+struct _ThemeCache
+{
+    ScreenInfo *screen_info;
+    gchar *dir;
+    xfwmColorSymbol *colsym;
+    gchar *filename;
+    gchar *stamp;
+    /* Reading a valid cache file */
+    GMappedFile *mapped;
+    GHashTable *entries;
+    /* or building a new one */
+    GArray *new_entries;
+    GByteArray *new_data;
+    GThreadPool *pool;
+    GPtrArray *jobs;
+};
+
+static gsize
+themeCacheDataSize (guint32 width, guint32 height)
+{
+    return (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width) * height +
+           (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_A1, width) * height;
+}
+
+static gint
+compareNames (gconstpointer a, gconstpointer b)
+{
+    return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+static gchar *
+themeCacheStamp (const gchar *dir)
+{
+    GChecksum *checksum;
+    GPtrArray *names;
+    GDir *gdir;
+    GStatBuf st;
+    const gchar *name;
+    gchar *path, *stamp;
+    gint64 mtime, size;
+    guint i;
+
+    names = g_ptr_array_new_with_free_func (g_free);
+    gdir = g_dir_open (dir, 0, NULL);
+    if (gdir)
+    {
+        while ((name = g_dir_read_name (gdir)))
+        {
+            g_ptr_array_add (names, g_strdup (name));
+        }
+        g_dir_close (gdir);
+    }
+    g_ptr_array_sort (names, compareNames);
+
+    checksum = g_checksum_new (G_CHECKSUM_SHA1);
+    for (i = 0; i < names->len; i++)
+    {
+        name = g_ptr_array_index (names, i);
+        path = g_build_filename (dir, name, NULL);
+        if (g_stat (path, &st) == 0)
+        {
+            mtime = st.st_mtime;
+            size = st.st_size;
+            g_checksum_update (checksum, (const guchar *) name, strlen (name) + 1);
+            g_checksum_update (checksum, (const guchar *) &mtime, sizeof (mtime));
+            g_checksum_update (checksum, (const guchar *) &size, sizeof (size));
+        }
+        g_free (path);
+    }
+    stamp = g_strdup (g_checksum_get_string (checksum));
+    g_checksum_free (checksum);
+    g_ptr_array_free (names, TRUE);
+
+    return stamp;
+}
+
+static gchar *
+themeCacheFilename (const gchar *dir, xfwmColorSymbol *colsym)
+{
+    GChecksum *checksum;
+    gchar *basename, *filename;
+    guint i;
+
+    checksum = g_checksum_new (G_CHECKSUM_SHA1);
+    g_checksum_update (checksum, (const guchar *) dir, strlen (dir) + 1);
+    for (i = 0; colsym[i].name; i++)
+    {
+        g_checksum_update (checksum, (const guchar *) colsym[i].name, strlen (colsym[i].name) + 1);
+        if (colsym[i].value)
+        {
+            g_checksum_update (checksum, (const guchar *) colsym[i].value, strlen (colsym[i].value));
+        }
+        g_checksum_update (checksum, (const guchar *) "", 1);
+    }
+    basename = g_strdup_printf ("%s.theme", g_checksum_get_string (checksum));
+    filename = g_build_filename (g_get_user_cache_dir (), "xfwm4", basename, NULL);
+    g_free (basename);
+    g_checksum_free (checksum);
+
+    return filename;
+}
+
+static gboolean
+themeCacheValidate (ThemeCache *cache)
+{
+    const ThemeCacheHeader *header;
+    const ThemeCacheEntry *entry;
+    const gchar *contents;
+    gsize length;
+    guint32 i;
+
+    contents = g_mapped_file_get_contents (cache->mapped);
+    length = g_mapped_file_get_length (cache->mapped);
+    if (length < sizeof (ThemeCacheHeader))
+    {
+        return FALSE;
+    }
+
+    header = (const ThemeCacheHeader *) contents;
+    if ((memcmp (header->magic, THEME_CACHE_MAGIC, sizeof (header->magic))) ||
+        (header->byte_order != G_BYTE_ORDER) ||
+        (strncmp (header->stamp, cache->stamp, THEME_CACHE_STAMP_SIZE)) ||
+        (header->n_entries > (length - sizeof (ThemeCacheHeader)) / sizeof (ThemeCacheEntry)))
+    {
+        return FALSE;
+    }
+
+    cache->entries = g_hash_table_new (g_str_hash, g_str_equal);
+    entry = (const ThemeCacheEntry *) (contents + sizeof (ThemeCacheHeader));
+    for (i = 0; i < header->n_entries; i++, entry++)
+    {
+        if ((entry->name[THEME_CACHE_NAME_SIZE - 1] != '\0') ||
+            (entry->width > THEME_CACHE_MAX_SIZE) || (entry->height > THEME_CACHE_MAX_SIZE) ||
+            ((entry->width > 0) &&
+             ((entry->offset % 4) || (entry->offset > length) ||
+              (themeCacheDataSize (entry->width, entry->height) > length - entry->offset))))
+        {
+            g_hash_table_destroy (cache->entries);
+            cache->entries = NULL;
+            return FALSE;
+        }
+        g_hash_table_insert (cache->entries, (gpointer) entry->name, (gpointer) entry);
+    }
+
+    return TRUE;
+}
+
+/* Runs in the thread pool, must not touch the X connection */
+static void
+themeCacheDecode (gpointer data, gpointer user_data)
+{
+    ThemeCacheJob *job;
+    ThemeCache *cache;
+
+    job = (ThemeCacheJob *) data;
+    cache = (ThemeCache *) user_data;
+    job->pixbuf = xfwmPixmapLoadPixbuf (cache->dir, job->name, cache->colsym);
+}
+
+/*
+ * Opens the cache of the given theme and colors, to load the theme
+ * parts from. When there is no valid cache file yet, the parts are
+ * loaded from the theme and the cache file is written on close.
+ */
+ThemeCache *
+themeCacheOpen (ScreenInfo *screen_info, const gchar *dir, xfwmColorSymbol *colsym)
+{
+    ThemeCache *cache;
+
+    g_return_val_if_fail (screen_info != NULL, NULL);
+    g_return_val_if_fail (dir != NULL, NULL);
+    g_return_val_if_fail (colsym != NULL, NULL);
+    TRACE ("dir %s", dir);
+
+    cache = g_new0 (ThemeCache, 1);
+    cache->screen_info = screen_info;
+    cache->dir = g_strdup (dir);
+    cache->colsym = colsym;
+    cache->filename = themeCacheFilename (dir, colsym);
+    cache->stamp = themeCacheStamp (dir);
+
+    cache->mapped = g_mapped_file_new (cache->filename, FALSE, NULL);
+    if ((cache->mapped) && !themeCacheValidate (cache))
+    {
+        DBG ("theme cache %s is outdated", cache->filename);
+        g_mapped_file_unref (cache->mapped);
+        cache->mapped = NULL;
+    }
+    else if (cache->mapped)
+    {
+        /* Most recently used, not to be pruned */
+        g_utime (cache->filename, NULL);
+    }
+
+    if (!cache->mapped)
+    {
+        cache->new_entries = g_array_new (FALSE, TRUE, sizeof (ThemeCacheEntry));
+        cache->new_data = g_byte_array_new ();
+        cache->jobs = g_ptr_array_new_with_free_func (g_free);
+        cache->pool = g_thread_pool_new (themeCacheDecode, cache,
+                                         g_get_num_processors (), FALSE, NULL);
+    }
+
+    return cache;
+}
+
+/* Premultiplied ARGB32 and A1 mask of the opaque pixels, as cairo wants them */
+static void
+themeCacheAppendPixbuf (GByteArray *data, GdkPixbuf *pixbuf)
+{
+    const guchar *pixels, *src;
+    guchar *argb, *mask;
+    guint32 *dst, *bits;
+    gint width, height, rowstride, n_channels, argb_stride, mask_stride;
+    gint x, y;
+    guint r, g, b, a, t;
+    gsize offset, size;
+
+    width = gdk_pixbuf_get_width (pixbuf);
+    height = gdk_pixbuf_get_height (pixbuf);
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+    argb_stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+    mask_stride = cairo_format_stride_for_width (CAIRO_FORMAT_A1, width);
+
+    offset = data->len;
+    size = themeCacheDataSize (width, height);
+    g_byte_array_set_size (data, offset + size);
+    memset (data->data + offset, 0, size);
+    argb = data->data + offset;
+    mask = argb + (gsize) argb_stride * height;
+
+    for (y = 0; y < height; y++)
+    {
+        src = pixels + y * rowstride;
+        dst = (guint32 *) (argb + y * argb_stride);
+        bits = (guint32 *) (mask + y * mask_stride);
+        for (x = 0; x < width; x++, src += n_channels)
+        {
+            r = src[0];
+            g = src[1];
+            b = src[2];
+            a = gdk_pixbuf_get_has_alpha (pixbuf) ? src[3] : 0xff;
+            if (a != 0xff)
+            {
+#define MULT(c) (t = (c) * a + 0x80, ((t >> 8) + t) >> 8)
+                r = MULT (r);
+                g = MULT (g);
+                b = MULT (b);
+#undef MULT
+            }
+            else
+            {
+                /* The mask holds what is fully opaque only */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                bits[x >> 5] |= 1U << (x & 31);
+#else
+                bits[x >> 5] |= 0x80000000U >> (x & 31);
+#endif
+            }
+            dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+}
+
+/*
+ * Parts found in the cache file are uploaded right away. Otherwise they
+ * are decoded on a pool of threads, the pixmap is only created once
+ * themeCacheClose() is called. Returns FALSE when the part is known to
+ * be missing, a part still to be decoded is only known to be missing
+ * once closed, its pixmap is then left empty.
+ */
+gboolean
+themeCacheLoadPixmap (ThemeCache *cache, xfwmPixmap *pm, const gchar *name)
+{
+    const ThemeCacheEntry *cached;
+    ThemeCacheJob *job;
+    guchar *data;
+
+    g_return_val_if_fail (cache != NULL, FALSE);
+    g_return_val_if_fail (pm != NULL, FALSE);
+    g_return_val_if_fail (name != NULL, FALSE);
+    TRACE ("pixmap %p, name %s", pm, name);
+
+    xfwmPixmapInit (cache->screen_info, pm);
+    if (strlen (name) >= THEME_CACHE_NAME_SIZE)
+    {
+        return xfwmPixmapLoad (cache->screen_info, pm, cache->dir, name, cache->colsym);
+    }
+
+    if (cache->mapped)
+    {
+        cached = g_hash_table_lookup (cache->entries, name);
+        if (!cached)
+        {
+            /* Not a part the cache was built with */
+            return xfwmPixmapLoad (cache->screen_info, pm, cache->dir, name, cache->colsym);
+        }
+        if (cached->width == 0)
+        {
+            /* Known to be missing from the theme */
+            return FALSE;
+        }
+        data = (guchar *) g_mapped_file_get_contents (cache->mapped) + cached->offset;
+        return xfwmPixmapCreateFromData (cache->screen_info, pm, cached->width, cached->height,
+                                         data, data + (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32,
+                                                                                             cached->width) * cached->height);
+    }
+
+    /* Decoded by the pool, uploaded in themeCacheClose() */
+    job = g_new0 (ThemeCacheJob, 1);
+    job->pm = pm;
+    g_strlcpy (job->name, name, THEME_CACHE_NAME_SIZE);
+    g_ptr_array_add (cache->jobs, job);
+    if (cache->pool)
+    {
+        g_thread_pool_push (cache->pool, job, NULL);
+    }
+    else
+    {
+        themeCacheDecode (job, cache);
+    }
+
+    return TRUE;
+}
+
+/* Waits for the pool and uploads the decoded parts, in request order */
+static void
+themeCacheUpload (ThemeCache *cache)
+{
+    ThemeCacheJob *job;
+    ThemeCacheEntry entry;
+    guchar *data;
+    guint i;
+
+    if (cache->pool)
+    {
+        g_thread_pool_free (cache->pool, FALSE, TRUE);
+        cache->pool = NULL;
+    }
+
+    for (i = 0; i < cache->jobs->len; i++)
+    {
+        job = g_ptr_array_index (cache->jobs, i);
+
+        memset (&entry, 0, sizeof (entry));
+        g_strlcpy (entry.name, job->name, THEME_CACHE_NAME_SIZE);
+        if (!job->pixbuf)
+        {
+            /* Missing from the theme, left as xfwmPixmapLoad() would */
+            xfwmPixmapFree (job->pm);
+            g_array_append_val (cache->new_entries, entry);
+            continue;
+        }
+
+        if ((gdk_pixbuf_get_width (job->pixbuf) > THEME_CACHE_MAX_SIZE) ||
+            (gdk_pixbuf_get_height (job->pixbuf) > THEME_CACHE_MAX_SIZE))
+        {
+            /* Too large for the cache file, which then does not list it */
+            xfwmPixmapLoad (cache->screen_info, job->pm, cache->dir, job->name, cache->colsym);
+            g_object_unref (job->pixbuf);
+            continue;
+        }
+
+        entry.width = gdk_pixbuf_get_width (job->pixbuf);
+        entry.height = gdk_pixbuf_get_height (job->pixbuf);
+        entry.offset = cache->new_data->len;
+        themeCacheAppendPixbuf (cache->new_data, job->pixbuf);
+        g_object_unref (job->pixbuf);
+
+        data = cache->new_data->data + entry.offset;
+        xfwmPixmapCreateFromData (cache->screen_info, job->pm, entry.width, entry.height,
+                                  data, data + (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32,
+                                                                                      entry.width) * entry.height);
+        g_array_append_val (cache->new_entries, entry);
+    }
+    g_ptr_array_set_size (cache->jobs, 0);
+}
+
+static gint
+themeCacheCompareFiles (gconstpointer a, gconstpointer b)
+{
+    const ThemeCacheFile *file_a = a;
+    const ThemeCacheFile *file_b = b;
+
+    /* Most recent first */
+    return (file_a->mtime < file_b->mtime) - (file_a->mtime > file_b->mtime);
+}
+
+/* Removes the cache files but the THEME_CACHE_MAX_FILES most recently used */
+static void
+themeCachePrune (const gchar *dirname)
+{
+    ThemeCacheFile file;
+    GStatBuf st;
+    GArray *files;
+    const gchar *name;
+    GDir *dir;
+    guint i;
+
+    dir = g_dir_open (dirname, 0, NULL);
+    if (!dir)
+    {
+        return;
+    }
+
+    files = g_array_new (FALSE, FALSE, sizeof (ThemeCacheFile));
+    while ((name = g_dir_read_name (dir)))
+    {
+        if (!g_str_has_suffix (name, ".theme"))
+        {
+            continue;
+        }
+        file.filename = g_build_filename (dirname, name, NULL);
+        if (g_stat (file.filename, &st) != 0)
+        {
+            g_free (file.filename);
+            continue;
+        }
+        file.mtime = (gint64) st.st_mtime;
+        g_array_append_val (files, file);
+    }
+    g_dir_close (dir);
+
+    g_array_sort (files, themeCacheCompareFiles);
+    for (i = 0; i < files->len; i++)
+    {
+        ThemeCacheFile *f = &g_array_index (files, ThemeCacheFile, i);
+
+        if (i >= THEME_CACHE_MAX_FILES)
+        {
+            DBG ("removing theme cache %s", f->filename);
+            g_unlink (f->filename);
+        }
+        g_free (f->filename);
+    }
+    g_array_free (files, TRUE);
+}
+
+static void
+themeCacheSave (ThemeCache *cache)
+{
+    ThemeCacheHeader header;
+    ThemeCacheEntry *entry;
+    GByteArray *contents;
+    GError *error;
+    gchar *dirname;
+    gsize base;
+    guint i;
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, THEME_CACHE_MAGIC, sizeof (header.magic));
+    header.byte_order = G_BYTE_ORDER;
+    header.n_entries = cache->new_entries->len;
+    g_strlcpy (header.stamp, cache->stamp, THEME_CACHE_STAMP_SIZE);
+
+    /* Offsets were relative to the data, make them relative to the file */
+    base = sizeof (ThemeCacheHeader) + cache->new_entries->len * sizeof (ThemeCacheEntry);
+    for (i = 0; i < cache->new_entries->len; i++)
+    {
+        entry = &g_array_index (cache->new_entries, ThemeCacheEntry, i);
+        if (entry->width > 0)
+        {
+            entry->offset += base;
+        }
+    }
+
+    contents = g_byte_array_sized_new (base + cache->new_data->len);
+    g_byte_array_append (contents, (guint8 *) &header, sizeof (header));
+    g_byte_array_append (contents, (guint8 *) cache->new_entries->data,
+                         cache->new_entries->len * sizeof (ThemeCacheEntry));
+    g_byte_array_append (contents, cache->new_data->data, cache->new_data->len);
+
+    dirname = g_path_get_dirname (cache->filename);
+    g_mkdir_with_parents (dirname, 0700);
+
+    /* Written aside and renamed, a running xfwm4 may have it mapped */
+    error = NULL;
+    if (!g_file_set_contents (cache->filename, (const gchar *) contents->data, contents->len, &error))
+    {
+        g_warning ("Cannot write theme cache: %s", error->message);
+        g_error_free (error);
+    }
+    else
+    {
+        themeCachePrune (dirname);
+    }
+    g_byte_array_free (contents, TRUE);
+    g_free (dirname);
+}
+
+void
+themeCacheClose (ThemeCache *cache)
+{
+    g_return_if_fail (cache != NULL);
+    TRACE ("entering");
+
+    if (cache->mapped)
+    {
+        g_hash_table_destroy (cache->entries);
+        g_mapped_file_unref (cache->mapped);
+    }
+    else
+    {
+        themeCacheUpload (cache);
+        if (cache->new_entries->len > 0)
+        {
+            themeCacheSave (cache);
+        }
+        g_ptr_array_free (cache->jobs, TRUE);
+        g_array_free (cache->new_entries, TRUE);
+        g_byte_array_free (cache->new_data, TRUE);
+    }
+    g_free (cache->stamp);
+    g_free (cache->filename);
+    g_free (cache->dir);
+    g_free (cache);
+}
@@ -0,0 +1,45 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+#ifndef INC_THEMECACHE_H
+#define INC_THEMECACHE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include "screen.h"
+#include "mypixmap.h"
+
+typedef struct _ThemeCache ThemeCache;
+
+ThemeCache              *themeCacheOpen                         (ScreenInfo *,
+                                                                 const gchar *,
+                                                                 xfwmColorSymbol *);
+gboolean                 themeCacheLoadPixmap                   (ThemeCache *,
+                                                                 xfwmPixmap *,
+                                                                 const gchar *);
+void                     themeCacheClose                        (ThemeCache *);
+
+#endif /* INC_THEMECACHE_H */
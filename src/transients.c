@@ -309,7 +309,7 @@ clientGetModalFor (Client * c)
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
     screen_info = c->screen_info;
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
     {
         c2 = (Client *) list->data;
         if (c2)
@@ -339,7 +339,7 @@ clientGetTransientFor (Client * c)
     parents = g_list_append (NULL, c);
 
     screen_info = c->screen_info;
-    for (l1 = g_list_last(screen_info->windows_stack); l1; l1 = g_list_previous (l1))
+    for (l1 = screen_info->windows_stack_last; l1; l1 = g_list_previous (l1))
     {
         Client *c2 = (Client *) l1->data;
         if (c2 == c)
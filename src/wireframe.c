@@ -44,10 +44,6 @@
 #define OUTLINE_WIDTH 5
 #endif
 
-#ifndef OUTLINE_WIDTH_CAIRO
-#define OUTLINE_WIDTH_CAIRO 2
-#endif
-
 static void
 wireframeDrawXlib (WireFrame *wireframe, int width, int height)
 {
@@ -118,46 +114,31 @@ wireframeDrawXlib (WireFrame *wireframe, int width, int height)
 }
 
 static void
-wireframeDrawCairo (WireFrame *wireframe, int width, int height)
+wireframeCreateWindow (WireFrame *wireframe)
 {
-    ScreenInfo *screen_info = wireframe->screen_info;
-
-    XMoveResizeWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow,
-                       wireframe->x, wireframe->y, width, height);
-    if (!wireframe->mapped)
-    {
-        XMapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-        wireframe->mapped = TRUE;
-    }
-    if ((width == wireframe->width) && (height == wireframe->height))
-    {
-        /* Moving only */
-        return;
-    }
-    wireframe->width = width;
-    wireframe->height = height;
+    ScreenInfo *screen_info;
+    XSetWindowAttributes attrs;
 
-    cairo_xlib_surface_set_size(wireframe->surface, wireframe->width, wireframe->height);
-    XClearWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-    cairo_set_source_rgba (wireframe->cr, wireframe->red, wireframe->green, wireframe->blue, wireframe->alpha);
-    cairo_paint (wireframe->cr);
-
-    cairo_set_source_rgba (wireframe->cr, wireframe->red, wireframe->green, wireframe->blue, 1.0);
-    cairo_rectangle (wireframe->cr,
-                     OUTLINE_WIDTH_CAIRO / 2, OUTLINE_WIDTH_CAIRO / 2,
-                     wireframe->width - OUTLINE_WIDTH_CAIRO,
-                     wireframe->height - OUTLINE_WIDTH_CAIRO);
-    cairo_stroke (wireframe->cr);
-    /* Force a resize of the compositor window to avoid flickering */
-    compositorResizeWindow (screen_info->display_info, wireframe->xwindow,
-                            wireframe->x, wireframe->y,
-                            wireframe->width, wireframe->height);
+    screen_info = wireframe->screen_info;
+    attrs.override_redirect = True;
+    attrs.colormap = screen_info->cmap;
+    attrs.background_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
+                                         screen_info->screen);
+    attrs.border_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
+                                     screen_info->screen);
+    wireframe->xwindow = XCreateWindow (myScreenGetXDisplay (screen_info), screen_info->xroot,
+                                        wireframe->x, wireframe->y, 1, 1,
+                                        0, screen_info->depth, InputOutput, screen_info->visual,
+                                        CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel,
+                                        &attrs);
 }
 
 void
 wireframeUpdate (Client *c, WireFrame *wireframe)
 {
     ScreenInfo *screen_info;
+    XRectangle location;
+    GdkRGBA color;
 
     g_return_if_fail (c != NULL);
     g_return_if_fail (wireframe != NULL);
@@ -167,14 +148,29 @@ wireframeUpdate (Client *c, WireFrame *wireframe)
     wireframe->y = frameExtentY (c);
 
     screen_info = wireframe->screen_info;
-    if (compositorIsActive (screen_info))
+    if (wireframe->xwindow == None)
     {
-         wireframeDrawCairo (wireframe, frameExtentWidth (c), frameExtentHeight (c));
-    }
-    else
-    {
-         wireframeDrawXlib (wireframe, frameExtentWidth (c), frameExtentHeight (c));
+        location.x = wireframe->x;
+        location.y = wireframe->y;
+        location.width = frameExtentWidth (c);
+        location.height = frameExtentHeight (c);
+
+        color.red = wireframe->red;
+        color.green = wireframe->green;
+        color.blue = wireframe->blue;
+        color.alpha = wireframe->alpha;
+
+        /* The compositor draws the outline itself, no window to move around */
+        if (compositorSetOutline (screen_info, &location, &color))
+        {
+            wireframe->width = location.width;
+            wireframe->height = location.height;
+            return;
+        }
+        wireframeCreateWindow (wireframe);
     }
+
+    wireframeDrawXlib (wireframe, frameExtentWidth (c), frameExtentHeight (c));
     XFlush (myScreenGetXDisplay (screen_info));
 }
 
@@ -196,10 +192,6 @@ wireframeCreate (Client *c)
 {
     ScreenInfo *screen_info;
     WireFrame *wireframe;
-    XSetWindowAttributes attrs;
-    XVisualInfo xvisual_info;
-    Visual *xvisual;
-    int depth;
 
     g_return_val_if_fail (c != NULL, None);
 
@@ -208,55 +200,17 @@ wireframeCreate (Client *c)
     screen_info = c->screen_info;
     wireframe = g_new0 (WireFrame, 1);
     wireframe->screen_info = screen_info;
+    wireframe->xwindow = None;
     wireframe->mapped = FALSE;
     wireframe->width = 0;
     wireframe->height = 0;
-    wireframe->cr = NULL;
-    wireframe->surface = NULL;
-    wireframe->alpha = (compositorIsActive (screen_info) ? 0.5 : 1.0);
+    wireframe->alpha = 0.5;
+    wireframeInitColor (wireframe);
 
-    if (compositorIsActive (screen_info) &&
-        XMatchVisualInfo (myScreenGetXDisplay (screen_info), screen_info->screen,
-                          32, TrueColor, &xvisual_info))
+    if (!compositorIsActive (screen_info))
     {
-        xvisual = xvisual_info.visual;
-        depth = xvisual_info.depth;
-        wireframe->xcolormap = XCreateColormap (myScreenGetXDisplay (screen_info),
-                                                screen_info->xroot,
-                                                xvisual, AllocNone);
+        wireframeCreateWindow (wireframe);
     }
-    else
-    {
-        xvisual = screen_info->visual;
-        depth = screen_info->depth;
-        wireframe->xcolormap = screen_info->cmap;
-    }
-
-    attrs.override_redirect = True;
-    attrs.colormap = wireframe->xcolormap;
-    attrs.background_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
-                                         screen_info->screen);
-    attrs.border_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
-                                     screen_info->screen);
-    wireframe->xwindow = XCreateWindow (myScreenGetXDisplay (screen_info), screen_info->xroot,
-                                        frameExtentX (c), frameExtentY (c),
-                                        frameExtentWidth (c), frameExtentHeight (c),
-                                        0, depth, InputOutput, xvisual,
-                                        CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel,
-                                        &attrs);
-
-    if (compositorIsActive (screen_info))
-    {
-        /* Cairo */
-        wireframeInitColor (wireframe);
-        wireframe->surface = cairo_xlib_surface_create (myScreenGetXDisplay (screen_info),
-                                                        wireframe->xwindow, xvisual,
-                                                        frameExtentWidth (c), frameExtentHeight (c));
-        wireframe->cr = cairo_create (wireframe->surface);
-        cairo_set_line_width (wireframe->cr, OUTLINE_WIDTH_CAIRO);
-        cairo_set_line_join (wireframe->cr, CAIRO_LINE_JOIN_MITER);
-    }
-
     wireframeUpdate (c, wireframe);
 
     return (wireframe);
@@ -271,19 +225,14 @@ wireframeDelete (WireFrame *wireframe)
     TRACE ("entering");
 
     screen_info = wireframe->screen_info;
-    XUnmapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-    if (wireframe->cr)
+    if (wireframe->xwindow == None)
     {
-        cairo_destroy (wireframe->cr);
+        compositorSetOutline (screen_info, NULL, NULL);
     }
-    if (wireframe->surface)
-    {
-        cairo_surface_destroy (wireframe->surface);
-    }
-    if (wireframe->xcolormap != screen_info->cmap)
+    else
     {
-        XFreeColormap (myScreenGetXDisplay (screen_info), wireframe->xcolormap);
+        XUnmapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
+        XDestroyWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
     }
-    XDestroyWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
     g_free (wireframe);
 }
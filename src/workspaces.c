@@ -305,7 +305,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     }
 
     /* First pass: Show, from top to bottom */
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
     {
         c = (Client *) list->data;
         if (FLAG_TEST (c->flags, CLIENT_FLAG_STICKY))
@@ -347,7 +347,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     }
 
     /* Third pass: Check for focus, from top to bottom */
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
     {
         c = (Client *) list->data;
 
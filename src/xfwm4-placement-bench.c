@@ -0,0 +1,380 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+
+/*
+ * Compares smartPlacementSearch() with the loop the smart placement used
+ * before, which summed the overlap of every frame at every position in
+ * floats, on random layouts, and times both for 10 to 1000 windows:
+ *
+ *   xfwm4-placement-bench [--layouts=n] [--seed=n] [--budget=ms]
+ *
+ * Both test the same positions in the same order. They can only pick
+ * different positions where float rounding confused two overlaps, the
+ * exact overlap of both picks is then reported. Any layout where the
+ * new search picks a position with more overlap than the old one is an
+ * error.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gdk/gdk.h>
+
+#include "smart_placement.h"
+
+#define SCREEN_WIDTH    1920
+#define SCREEN_HEIGHT   1080
+#define FRAME_LEFT      4
+#define FRAME_RIGHT     4
+#define FRAME_TOP       24
+#define FRAME_BOTTOM    4
+
+typedef struct
+{
+    GArray *others;
+    gint frame_width;
+    gint frame_height;
+    gint xmin, ymin, xmax, ymax;
+} Layout;
+
+static unsigned long
+segment_overlap (int x0, int x1, int tx0, int tx1)
+{
+    if (tx0 > x0)
+    {
+        x0 = tx0;
+    }
+    if (tx1 < x1)
+    {
+        x1 = tx1;
+    }
+    if (x1 <= x0)
+    {
+        return 0;
+    }
+    return (x1 - x0);
+}
+
+static unsigned long
+overlap (int x0, int y0, int x1, int y1, int tx0, int ty0, int tx1, int ty1)
+{
+    return (segment_overlap (x0, x1, tx0, tx1)
+            * segment_overlap (y0, y1, ty0, ty1));
+}
+
+/* Exact overlap of the frame at the given position */
+static guint64
+layoutOverlap (Layout *layout, gint x, gint y)
+{
+    GdkRectangle *rect;
+    guint64 total;
+    guint i;
+
+    total = 0;
+    for (i = 0; i < layout->others->len; i++)
+    {
+        rect = &g_array_index (layout->others, GdkRectangle, i);
+        total += (guint64) segment_overlap (x - FRAME_LEFT, x - FRAME_LEFT + layout->frame_width,
+                                            rect->x, rect->x + rect->width) *
+                 segment_overlap (y - FRAME_TOP, y - FRAME_TOP + layout->frame_height,
+                                  rect->y, rect->y + rect->height);
+    }
+
+    return total;
+}
+
+/* The search as smartPlacement() did it before the sweep, float sums included */
+static void
+referenceSearch (Layout *layout, gint *best_x, gint *best_y)
+{
+    GdkRectangle *rect;
+    gfloat best_overlaps;
+    guint i;
+    gint test_x, test_y, xmax, ymax, xmin, ymin;
+    gint frame_height, frame_width, frame_left, frame_top;
+    gint c2_x, c2_y, c2_frame_width, c2_frame_height;
+
+    frame_height = layout->frame_height;
+    frame_width = layout->frame_width;
+    frame_left = FRAME_LEFT;
+    frame_top = FRAME_TOP;
+    xmin = layout->xmin;
+    ymin = layout->ymin;
+    xmax = layout->xmax;
+    ymax = layout->ymax;
+
+    best_overlaps = G_MAXFLOAT;
+    *best_x = xmin;
+    *best_y = ymin;
+
+    test_y = ymin;
+    do
+    {
+        gint next_test_y = G_MAXINT;
+        gboolean first_test_x = TRUE;
+
+        test_x = xmin;
+        do
+        {
+            gfloat count_overlaps = 0.0;
+            gint next_test_x = G_MAXINT;
+            gint c2_next_test_x;
+            gint c2_next_test_y;
+
+            for (i = 0; i < layout->others->len; i++)
+            {
+                rect = &g_array_index (layout->others, GdkRectangle, i);
+                c2_x = rect->x;
+                c2_y = rect->y;
+                c2_frame_width = rect->width;
+                c2_frame_height = rect->height;
+
+                count_overlaps += overlap (test_x - frame_left,
+                                           test_y - frame_top,
+                                           test_x - frame_left + frame_width,
+                                           test_y - frame_top + frame_height,
+                                           c2_x,
+                                           c2_y,
+                                           c2_x + c2_frame_width,
+                                           c2_y + c2_frame_height);
+
+                if (test_x > c2_x)
+                {
+                    c2_x += c2_frame_width;
+                }
+                c2_next_test_x = MIN (c2_x, xmax);
+                if (c2_next_test_x < next_test_x
+                    && c2_next_test_x > test_x)
+                {
+                    next_test_x = c2_next_test_x;
+                }
+
+                if (first_test_x)
+                {
+                    if (test_y > c2_y)
+                    {
+                        c2_y += c2_frame_height;
+                    }
+                    c2_next_test_y = MIN (c2_y, ymax);
+                    if (c2_next_test_y < next_test_y
+                        && c2_next_test_y > test_y)
+                    {
+                        next_test_y = c2_next_test_y;
+                    }
+                }
+            }
+
+            first_test_x = FALSE;
+
+            if (count_overlaps < best_overlaps)
+            {
+                *best_x = test_x;
+                *best_y = test_y;
+                best_overlaps = count_overlaps;
+
+                if (count_overlaps == 0.0f)
+                {
+                    return;
+                }
+            }
+
+            if (G_LIKELY (next_test_x != G_MAXINT))
+            {
+                test_x = MAX (next_test_x, next_test_x + frame_left);
+                if (test_x > xmax)
+                {
+                   test_x = xmax;
+                }
+            }
+            else
+            {
+                test_x++;
+            }
+        }
+        while (test_x <= xmax);
+
+        if (G_LIKELY (next_test_y != G_MAXINT))
+        {
+            test_y = MAX (next_test_y, next_test_y + frame_top);
+            if (test_y > ymax)
+            {
+                test_y = ymax;
+            }
+        }
+        else
+        {
+            test_y++;
+        }
+    }
+    while (test_y <= ymax);
+}
+
+static void
+layoutInit (Layout *layout, GRand *rand, guint n_windows)
+{
+    GdkRectangle rect;
+    gint width, height;
+    guint i;
+
+    layout->others = g_array_sized_new (FALSE, FALSE, sizeof (GdkRectangle), n_windows);
+    for (i = 0; i < n_windows; i++)
+    {
+        rect.width = g_rand_int_range (rand, 100, 1000);
+        rect.height = g_rand_int_range (rand, 80, 800);
+        rect.x = g_rand_int_range (rand, 0, SCREEN_WIDTH - rect.width / 2);
+        rect.y = g_rand_int_range (rand, 0, SCREEN_HEIGHT - rect.height / 2);
+        g_array_append_val (layout->others, rect);
+    }
+
+    width = g_rand_int_range (rand, 200, 1200);
+    height = g_rand_int_range (rand, 150, 900);
+    layout->frame_width = FRAME_LEFT + width + FRAME_RIGHT;
+    layout->frame_height = FRAME_TOP + height + FRAME_BOTTOM;
+    layout->xmin = FRAME_LEFT;
+    layout->ymin = FRAME_TOP;
+    layout->xmax = SCREEN_WIDTH - width - FRAME_RIGHT;
+    layout->ymax = SCREEN_HEIGHT - height - FRAME_BOTTOM;
+}
+
+int
+main (int argc, char **argv)
+{
+    static const guint sizes[] = { 10, 30, 100, 300, 1000 };
+    Layout *layouts;
+    GRand *rand;
+    gint64 start, budget, elapsed_ref, elapsed_new;
+    guint64 overlap_ref, overlap_new;
+    guint n_layouts, n_ref, seed, same, better, worse;
+    guint i, j;
+    gint ref_x, ref_y, new_x, new_y;
+
+    n_layouts = 200;
+    seed = 1;
+    budget = 2000;
+    for (i = 1; i < (guint) argc; i++)
+    {
+        if (g_str_has_prefix (argv[i], "--layouts="))
+        {
+            n_layouts = (guint) MAX (atoi (argv[i] + strlen ("--layouts=")), 1);
+        }
+        else if (g_str_has_prefix (argv[i], "--seed="))
+        {
+            seed = (guint) atoi (argv[i] + strlen ("--seed="));
+        }
+        else if (g_str_has_prefix (argv[i], "--budget="))
+        {
+            budget = MAX (atoi (argv[i] + strlen ("--budget=")), 1);
+        }
+        else
+        {
+            g_printerr ("Usage: %s [--layouts=n] [--seed=n] [--budget=ms]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    rand = g_rand_new_with_seed (seed);
+    layouts = g_new0 (Layout, n_layouts);
+    worse = 0;
+
+    g_print ("%8s %8s %8s %8s %8s %14s %14s\n",
+             "windows", "layouts", "same", "better", "worse", "old (us)", "new (us)");
+    for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+        for (j = 0; j < n_layouts; j++)
+        {
+            layoutInit (&layouts[j], rand, sizes[i]);
+        }
+
+        /* The old loop gets slow with many windows, it is given a time budget */
+        same = 0;
+        better = 0;
+        n_ref = 0;
+        elapsed_ref = 0;
+        elapsed_new = 0;
+        for (j = 0; j < n_layouts && elapsed_ref < budget * 1000; j++)
+        {
+            start = g_get_monotonic_time ();
+            referenceSearch (&layouts[j], &ref_x, &ref_y);
+            elapsed_ref += g_get_monotonic_time () - start;
+            n_ref++;
+
+            start = g_get_monotonic_time ();
+            smartPlacementSearch (layouts[j].others, FRAME_LEFT, FRAME_TOP,
+                                  layouts[j].frame_width, layouts[j].frame_height,
+                                  layouts[j].xmin, layouts[j].ymin,
+                                  layouts[j].xmax, layouts[j].ymax, &new_x, &new_y);
+            elapsed_new += g_get_monotonic_time () - start;
+
+            if ((ref_x == new_x) && (ref_y == new_y))
+            {
+                same++;
+                continue;
+            }
+
+            overlap_ref = layoutOverlap (&layouts[j], ref_x, ref_y);
+            overlap_new = layoutOverlap (&layouts[j], new_x, new_y);
+            if (overlap_new <= overlap_ref)
+            {
+                better++;
+            }
+            else
+            {
+                worse++;
+            }
+            g_print ("  %u windows, layout %u: old %d,%d overlap %" G_GUINT64_FORMAT
+                     ", new %d,%d overlap %" G_GUINT64_FORMAT "\n",
+                     sizes[i], j, ref_x, ref_y, overlap_ref, new_x, new_y, overlap_new);
+        }
+
+        /* The new search alone on the layouts left */
+        for (; j < n_layouts; j++)
+        {
+            start = g_get_monotonic_time ();
+            smartPlacementSearch (layouts[j].others, FRAME_LEFT, FRAME_TOP,
+                                  layouts[j].frame_width, layouts[j].frame_height,
+                                  layouts[j].xmin, layouts[j].ymin,
+                                  layouts[j].xmax, layouts[j].ymax, &new_x, &new_y);
+            elapsed_new += g_get_monotonic_time () - start;
+        }
+
+        g_print ("%8u %8u %8u %8u %8u %14.1f %14.1f\n", sizes[i], n_ref, same, better,
+                 n_ref - same - better, (gdouble) elapsed_ref / n_ref,
+                 (gdouble) elapsed_new / n_layouts);
+
+        for (j = 0; j < n_layouts; j++)
+        {
+            g_array_free (layouts[j].others, TRUE);
+        }
+    }
+
+    g_free (layouts);
+    g_rand_free (rand);
+
+    return (worse ? 1 : 0);
+}
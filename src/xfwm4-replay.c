@@ -0,0 +1,669 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+
+/*
+ * Replays an X event recording made by xfwm4 with XFWM4_RECORD_FILE
+ * set, see event_record.h for the file format. The driver plays the
+ * part of the clients: it creates and maps windows, changes their
+ * properties and sends the client messages that were recorded, then
+ * maps a last window and waits for the window manager to show it, so
+ * that the elapsed time covers everything the window manager had to
+ * process. Typically run against a window manager on a nested or
+ * virtual server:
+ *
+ *   Xvfb :5 & DISPLAY=:5 xfwm4 --replace & pid=$!
+ *   xfwm4-replay --display=:5 --pid=$pid session.rec
+ *
+ * Timestamps in client messages are replayed as recorded, so focus
+ * stealing prevention may decide differently than in the original
+ * session.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+
+#include "event_record.h"
+
+typedef struct
+{
+    Window xwindow;
+    gboolean override_redirect;
+} ReplayWindow;
+
+typedef struct
+{
+    Display *dpy;
+    Window root;
+    Window recorded_root;
+    GHashTable *windows;
+    GHashTable *created;
+    guint32 replayed;
+    guint32 skipped;
+} Replay;
+
+static guint32 replay_errors = 0;
+
+/*
+ * Properties the window manager writes itself, replaying its own
+ * updates would only race with the ones it makes for the replayed
+ * session. A client may still set _NET_WM_STATE and _NET_WM_DESKTOP
+ * before mapping, those initial values are replayed.
+ */
+static const struct
+{
+    const gchar *name;
+    gboolean initial;
+} replay_wm_properties[] =
+{
+    { "WM_STATE",                    FALSE },
+    { "_NET_WM_STATE",               TRUE  },
+    { "_NET_WM_DESKTOP",             TRUE  },
+    { "_NET_WM_ALLOWED_ACTIONS",     FALSE },
+    { "_NET_FRAME_EXTENTS",          FALSE },
+    { "_NET_WM_FULLSCREEN_MONITORS", FALSE },
+    { "XFWM4_TIMESTAMP_PROP",        FALSE },
+    { "_NET_SUPPORTED",              FALSE },
+    { "_NET_SUPPORTING_WM_CHECK",    FALSE },
+    { "_NET_CLIENT_LIST",            FALSE },
+    { "_NET_CLIENT_LIST_STACKING",   FALSE },
+    { "_NET_ACTIVE_WINDOW",          FALSE },
+    { "_NET_WORKAREA",               FALSE },
+    { "_NET_NUMBER_OF_DESKTOPS",     FALSE },
+    { "_NET_CURRENT_DESKTOP",        FALSE },
+    { "_NET_DESKTOP_GEOMETRY",       FALSE },
+    { "_NET_DESKTOP_VIEWPORT",       FALSE },
+    { "_NET_SHOWING_DESKTOP",        FALSE },
+};
+
+static int
+replayErrorHandler (Display *dpy, XErrorEvent *ev)
+{
+    /* Windows come and go, the window manager may have beaten us to it */
+    replay_errors++;
+    return 0;
+}
+
+static void
+replayPrintMemory (gint pid, const gchar *when)
+{
+    gchar *filename;
+    gchar *contents;
+    gchar **lines;
+    gint i;
+
+    if (pid <= 0)
+    {
+        return;
+    }
+
+    filename = g_strdup_printf ("/proc/%d/status", pid);
+    if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+        lines = g_strsplit (contents, "\n", -1);
+        for (i = 0; lines[i]; i++)
+        {
+            if (g_str_has_prefix (lines[i], "VmRSS:") ||
+                g_str_has_prefix (lines[i], "VmHWM:"))
+            {
+                g_print ("%s %s\n", when, lines[i]);
+            }
+        }
+        g_strfreev (lines);
+        g_free (contents);
+    }
+    g_free (filename);
+}
+
+static Window
+replayTranslateWindow (Replay *replay, Window w)
+{
+    ReplayWindow *rw;
+
+    if (w == replay->recorded_root)
+    {
+        return replay->root;
+    }
+
+    rw = g_hash_table_lookup (replay->windows, GUINT_TO_POINTER ((guint) w));
+    return rw ? rw->xwindow : None;
+}
+
+/*
+ * Windows are created from their recorded CreateNotify geometry the
+ * first time a client would have used them, this keeps the window
+ * manager's own windows, which are also reported, out of the replay.
+ */
+static Window
+replayEnsureWindow (Replay *replay, Window w, gboolean override_redirect)
+{
+    XSetWindowAttributes attrs;
+    XCreateWindowEvent *create;
+    ReplayWindow *rw;
+    int x, y, width, height, border;
+
+    rw = g_hash_table_lookup (replay->windows, GUINT_TO_POINTER ((guint) w));
+    if (rw)
+    {
+        return rw->xwindow;
+    }
+
+    create = g_hash_table_lookup (replay->created, GUINT_TO_POINTER ((guint) w));
+    if (create)
+    {
+        x = create->x;
+        y = create->y;
+        width = MAX (create->width, 1);
+        height = MAX (create->height, 1);
+        border = create->border_width;
+        override_redirect = create->override_redirect;
+    }
+    else
+    {
+        x = y = 0;
+        width = height = 100;
+        border = 0;
+    }
+
+    attrs.background_pixel = BlackPixel (replay->dpy, DefaultScreen (replay->dpy));
+    attrs.override_redirect = override_redirect;
+
+    rw = g_new0 (ReplayWindow, 1);
+    rw->override_redirect = override_redirect;
+    rw->xwindow = XCreateWindow (replay->dpy, replay->root, x, y, width, height, border,
+                                 CopyFromParent, InputOutput, CopyFromParent,
+                                 CWBackPixel | CWOverrideRedirect, &attrs);
+    g_hash_table_insert (replay->windows, GUINT_TO_POINTER ((guint) w), rw);
+
+    return rw->xwindow;
+}
+
+static gboolean
+replayIsWindowManagerProperty (const gchar *atom_name, gboolean initial)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (replay_wm_properties); i++)
+    {
+        if (strcmp (atom_name, replay_wm_properties[i].name) == 0)
+        {
+            return !(initial && replay_wm_properties[i].initial);
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+replayProperty (Replay *replay, eventRecordEntry *entry,
+                const gchar *atom_name, const gchar *type_name, const guchar *data)
+{
+    XPropertyEvent *ev;
+    Window w;
+    Atom atom, type;
+    unsigned long *values;
+    const gchar *name;
+    guint32 value;
+    int nitems, i;
+
+    ev = &entry->xevent.xproperty;
+    if (ev->send_event)
+    {
+        /* Initial properties recorded with the map request */
+        w = replayEnsureWindow (replay, ev->window, FALSE);
+    }
+    else
+    {
+        w = replayTranslateWindow (replay, ev->window);
+    }
+
+    /* Root properties are set by the window manager itself, and so are some others */
+    if ((w == None) || (w == replay->root) || !atom_name ||
+        replayIsWindowManagerProperty (atom_name, ev->send_event))
+    {
+        replay->skipped++;
+        return;
+    }
+
+    atom = XInternAtom (replay->dpy, atom_name, FALSE);
+    if (ev->state == PropertyDelete)
+    {
+        XDeleteProperty (replay->dpy, w, atom);
+        replay->replayed++;
+        return;
+    }
+
+    if (!type_name)
+    {
+        /* The property was gone by the time it was recorded */
+        replay->skipped++;
+        return;
+    }
+
+    type = XInternAtom (replay->dpy, type_name, FALSE);
+    if (entry->format == 32)
+    {
+        if (type == XA_ATOM)
+        {
+            nitems = 0;
+            for (i = 0; i < (int) entry->data_length; i++)
+            {
+                nitems += (data[i] == '\0');
+            }
+            values = g_new0 (unsigned long, MAX (nitems, 1));
+            name = (const gchar *) data;
+            for (i = 0; i < nitems; i++)
+            {
+                values[i] = *name ? XInternAtom (replay->dpy, name, FALSE) : None;
+                name += strlen (name) + 1;
+            }
+        }
+        else
+        {
+            nitems = entry->data_length / sizeof (guint32);
+            values = g_new0 (unsigned long, MAX (nitems, 1));
+            for (i = 0; i < nitems; i++)
+            {
+                memcpy (&value, data + i * sizeof (guint32), sizeof (guint32));
+                values[i] = value;
+                if (type == XA_WINDOW)
+                {
+                    values[i] = replayTranslateWindow (replay, value);
+                }
+            }
+        }
+        XChangeProperty (replay->dpy, w, atom, type, 32, PropModeReplace,
+                         (unsigned char *) values, nitems);
+        g_free (values);
+    }
+    else if ((entry->format == 8) || (entry->format == 16))
+    {
+        nitems = entry->data_length / (entry->format / 8);
+        XChangeProperty (replay->dpy, w, atom, type, entry->format, PropModeReplace,
+                         data, nitems);
+    }
+    else
+    {
+        replay->skipped++;
+        return;
+    }
+    replay->replayed++;
+}
+
+static void
+replayClientMessage (Replay *replay, eventRecordEntry *entry,
+                     const gchar *atom_name, const guchar *data)
+{
+    XEvent ev;
+    Window w, translated;
+    const gchar *name;
+    int i;
+
+    w = replayTranslateWindow (replay, entry->xevent.xclient.window);
+    if ((w == None) || !atom_name)
+    {
+        replay->skipped++;
+        return;
+    }
+
+    ev = entry->xevent;
+    ev.xclient.display = replay->dpy;
+    ev.xclient.send_event = True;
+    ev.xclient.window = w;
+    ev.xclient.message_type = XInternAtom (replay->dpy, atom_name, FALSE);
+
+    if (ev.xclient.format == 32)
+    {
+        name = (const gchar *) data;
+        for (i = 0; i < 5; i++)
+        {
+            if (name && (name < (const gchar *) data + entry->data_length) && *name)
+            {
+                ev.xclient.data.l[i] = XInternAtom (replay->dpy, name, FALSE);
+            }
+            else if ((translated = replayTranslateWindow (replay, ev.xclient.data.l[i])))
+            {
+                ev.xclient.data.l[i] = translated;
+            }
+            if (name && (name < (const gchar *) data + entry->data_length))
+            {
+                name += strlen (name) + 1;
+            }
+        }
+    }
+
+    XSendEvent (replay->dpy, replay->root, False,
+                SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+    replay->replayed++;
+}
+
+static void
+replayEntry (Replay *replay, eventRecordEntry *entry,
+             const gchar *atom_name, const gchar *type_name, const guchar *data)
+{
+    XCreateWindowEvent *create;
+    XEvent *xevent;
+    XWindowChanges wc;
+    ReplayWindow *rw;
+    unsigned long mask;
+    Window w;
+
+    xevent = &entry->xevent;
+    switch (xevent->type)
+    {
+        case CreateNotify:
+            /* Only top level windows are of interest to the window manager */
+            if (xevent->xcreatewindow.parent != replay->recorded_root)
+            {
+                replay->skipped++;
+                break;
+            }
+            create = g_new (XCreateWindowEvent, 1);
+            *create = xevent->xcreatewindow;
+            g_hash_table_insert (replay->created,
+                                 GUINT_TO_POINTER ((guint) create->window), create);
+            if (xevent->xcreatewindow.override_redirect)
+            {
+                replayEnsureWindow (replay, xevent->xcreatewindow.window, TRUE);
+            }
+            replay->replayed++;
+            break;
+        case MapRequest:
+            w = replayEnsureWindow (replay, xevent->xmaprequest.window, FALSE);
+            XMapWindow (replay->dpy, w);
+            replay->replayed++;
+            break;
+        case MapNotify:
+            /* Override redirect windows are mapped without asking */
+            rw = g_hash_table_lookup (replay->windows,
+                                      GUINT_TO_POINTER ((guint) xevent->xmap.window));
+            if (rw && rw->override_redirect)
+            {
+                XMapWindow (replay->dpy, rw->xwindow);
+                replay->replayed++;
+                break;
+            }
+            replay->skipped++;
+            break;
+        case UnmapNotify:
+            rw = g_hash_table_lookup (replay->windows,
+                                      GUINT_TO_POINTER ((guint) xevent->xunmap.window));
+            if (rw && xevent->xunmap.send_event)
+            {
+                /* ICCCM withdrawal, the real unmap may be caused by the window manager */
+                XWithdrawWindow (replay->dpy, rw->xwindow, DefaultScreen (replay->dpy));
+                replay->replayed++;
+                break;
+            }
+            else if (rw && rw->override_redirect)
+            {
+                XUnmapWindow (replay->dpy, rw->xwindow);
+                replay->replayed++;
+                break;
+            }
+            replay->skipped++;
+            break;
+        case DestroyNotify:
+            rw = g_hash_table_lookup (replay->windows,
+                                      GUINT_TO_POINTER ((guint) xevent->xdestroywindow.window));
+            if (rw)
+            {
+                XDestroyWindow (replay->dpy, rw->xwindow);
+                g_hash_table_remove (replay->windows,
+                                     GUINT_TO_POINTER ((guint) xevent->xdestroywindow.window));
+                replay->replayed++;
+                break;
+            }
+            replay->skipped++;
+            break;
+        case ConfigureRequest:
+            w = replayEnsureWindow (replay, xevent->xconfigurerequest.window, FALSE);
+            mask = xevent->xconfigurerequest.value_mask;
+            wc.x = xevent->xconfigurerequest.x;
+            wc.y = xevent->xconfigurerequest.y;
+            wc.width = xevent->xconfigurerequest.width;
+            wc.height = xevent->xconfigurerequest.height;
+            wc.border_width = xevent->xconfigurerequest.border_width;
+            wc.stack_mode = xevent->xconfigurerequest.detail;
+            wc.sibling = None;
+            if (mask & CWSibling)
+            {
+                wc.sibling = replayTranslateWindow (replay, xevent->xconfigurerequest.above);
+                if (wc.sibling == None)
+                {
+                    mask &= ~CWSibling;
+                }
+            }
+            XConfigureWindow (replay->dpy, w, mask, &wc);
+            replay->replayed++;
+            break;
+        case PropertyNotify:
+            replayProperty (replay, entry, atom_name, type_name, data);
+            break;
+        case ClientMessage:
+            replayClientMessage (replay, entry, atom_name, data);
+            break;
+        default:
+            replay->skipped++;
+            break;
+    }
+}
+
+static gchar *
+replayReadString (FILE *f, guint32 length)
+{
+    gchar *str;
+
+    if (length == 0)
+    {
+        return NULL;
+    }
+
+    str = g_malloc (length + 1);
+    if (fread (str, length, 1, f) != 1)
+    {
+        g_free (str);
+        return NULL;
+    }
+    str[length] = '\0';
+
+    return str;
+}
+
+/*
+ * The window manager handles requests in order, so once it has mapped
+ * this last window, it has gone through everything sent before.
+ */
+static void
+replayWaitForWindowManager (Replay *replay)
+{
+    XSetWindowAttributes attrs;
+    XEvent ev;
+    Window w;
+
+    attrs.event_mask = StructureNotifyMask;
+    w = XCreateWindow (replay->dpy, replay->root, 0, 0, 10, 10, 0,
+                       CopyFromParent, InputOutput, CopyFromParent,
+                       CWEventMask, &attrs);
+    XStoreName (replay->dpy, w, "xfwm4-replay");
+    XMapWindow (replay->dpy, w);
+
+    do
+    {
+        XWindowEvent (replay->dpy, w, StructureNotifyMask, &ev);
+    }
+    while (ev.type != MapNotify);
+
+    XDestroyWindow (replay->dpy, w);
+}
+
+int
+main (int argc, char **argv)
+{
+    eventRecordHeader header;
+    eventRecordEntry entry;
+    Replay replay;
+    const gchar *filename;
+    const gchar *display_name;
+    gchar *atom_name, *type_name;
+    guchar *data;
+    gboolean realtime;
+    gint64 start, elapsed, delay;
+    gint pid;
+    guint32 count;
+    int i;
+    FILE *f;
+
+    filename = NULL;
+    display_name = NULL;
+    realtime = FALSE;
+    pid = 0;
+    for (i = 1; i < argc; i++)
+    {
+        if (g_str_has_prefix (argv[i], "--display="))
+        {
+            display_name = argv[i] + strlen ("--display=");
+        }
+        else if (g_str_has_prefix (argv[i], "--pid="))
+        {
+            pid = atoi (argv[i] + strlen ("--pid="));
+        }
+        else if (!strcmp (argv[i], "--realtime"))
+        {
+            realtime = TRUE;
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    if (!filename)
+    {
+        g_printerr ("Usage: %s [--display=name] [--pid=wm-pid] [--realtime] recording\n", argv[0]);
+        return 1;
+    }
+
+    f = fopen (filename, "rb");
+    if (!f)
+    {
+        g_printerr ("Cannot open %s: %s\n", filename, g_strerror (errno));
+        return 1;
+    }
+
+    if ((fread (&header, sizeof (header), 1, f) != 1) ||
+        (memcmp (header.magic, EVENT_RECORD_MAGIC, sizeof (header.magic)) != 0))
+    {
+        g_printerr ("%s is not an xfwm4 event recording\n", filename);
+        fclose (f);
+        return 1;
+    }
+
+    if ((header.byte_order != 0x01020304) ||
+        (header.event_size != sizeof (XEvent)))
+    {
+        g_printerr ("%s was recorded on an incompatible machine\n", filename);
+        fclose (f);
+        return 1;
+    }
+
+    memset (&replay, 0, sizeof (replay));
+    replay.dpy = XOpenDisplay (display_name);
+    if (!replay.dpy)
+    {
+        g_printerr ("Cannot open display %s\n", XDisplayName (display_name));
+        fclose (f);
+        return 1;
+    }
+    XSetErrorHandler (replayErrorHandler);
+
+    replay.root = DefaultRootWindow (replay.dpy);
+    replay.recorded_root = header.root;
+    replay.windows = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    replay.created = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+    replayPrintMemory (pid, "before");
+
+    count = 0;
+    start = g_get_monotonic_time ();
+    while (fread (&entry, sizeof (entry), 1, f) == 1)
+    {
+        atom_name = replayReadString (f, entry.atom_length);
+        type_name = replayReadString (f, entry.type_length);
+        data = (guchar *) replayReadString (f, entry.data_length);
+
+        if (((entry.atom_length) && (!atom_name)) ||
+            ((entry.type_length) && (!type_name)) ||
+            ((entry.data_length) && (!data)))
+        {
+            g_printerr ("Recording truncated after %u entries\n", count);
+            g_free (atom_name);
+            g_free (type_name);
+            g_free (data);
+            break;
+        }
+
+        if (realtime)
+        {
+            delay = entry.time - (g_get_monotonic_time () - start);
+            if (delay > 0)
+            {
+                XFlush (replay.dpy);
+                g_usleep (delay);
+            }
+        }
+
+        replayEntry (&replay, &entry, atom_name, type_name, data);
+        count++;
+
+        g_free (atom_name);
+        g_free (type_name);
+        g_free (data);
+    }
+    fclose (f);
+
+    replayWaitForWindowManager (&replay);
+    elapsed = g_get_monotonic_time () - start;
+
+    g_print ("%u entries, %u replayed, %u skipped, %u X errors\n",
+             count, replay.replayed, replay.skipped, replay_errors);
+    g_print ("processed in %.3f ms, %.0f entries/s\n",
+             elapsed / 1000.0, elapsed ? count * 1000000.0 / elapsed : 0.0);
+    replayPrintMemory (pid, "after");
+
+    g_hash_table_destroy (replay.windows);
+    g_hash_table_destroy (replay.created);
+    XCloseDisplay (replay.dpy);
+
+    return 0;
+}
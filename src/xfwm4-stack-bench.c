@@ -0,0 +1,389 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+
+/*
+ * Raises random windows with the stacking code of stacking.c and
+ * transients.c, with 2000 clients mapped by default, and times the
+ * raises:
+ *
+ *   xfwm4-stack-bench [--clients=n] [--raises=n] [--transients=percent] [--seed=n]
+ *
+ * There is no X server, the stacking requests are applied to a copy of
+ * the server stack instead, which is checked against the stack of the
+ * window manager after each raise, together with the per-client links
+ * into it. Any difference is an error.
+ */
+
+#include "stacking.c"
+#include "transients.c"
+
+#define STACK_BENCH_ROOT        1
+#define STACK_BENCH_FIRST_XID   0x100
+
+typedef struct
+{
+    GArray *server_stack;
+    GHashTable *windows;
+    guint restacks;
+    guint configures;
+    guint restacked;
+} StackBench;
+
+static StackBench bench;
+
+/* Top most first, as XRestackWindows() takes them */
+static gint
+stackBenchFind (Window w)
+{
+    guint i;
+
+    for (i = 0; i < bench.server_stack->len; i++)
+    {
+        if (g_array_index (bench.server_stack, Window, i) == w)
+        {
+            return (gint) i;
+        }
+    }
+    return -1;
+}
+
+static void
+stackBenchPlaceBelow (Window w, Window sibling)
+{
+    gint pos;
+
+    pos = stackBenchFind (w);
+    if (pos >= 0)
+    {
+        g_array_remove_index (bench.server_stack, pos);
+    }
+    pos = stackBenchFind (sibling);
+    g_array_insert_val (bench.server_stack, pos + 1, w);
+}
+
+int
+XRestackWindows (Display *dpy, Window *windows, int nwindows)
+{
+    gint i;
+
+    bench.restacks++;
+    bench.restacked += nwindows;
+    if (stackBenchFind (windows[0]) < 0)
+    {
+        g_array_prepend_val (bench.server_stack, windows[0]);
+    }
+    for (i = 1; i < nwindows; i++)
+    {
+        stackBenchPlaceBelow (windows[i], windows[i - 1]);
+    }
+
+    return 1;
+}
+
+int
+XConfigureWindow (Display *dpy, Window w, unsigned int value_mask, XWindowChanges *values)
+{
+    g_assert (value_mask == (CWSibling | CWStackMode));
+    g_assert (values->stack_mode == Below);
+
+    bench.configures++;
+    bench.restacked++;
+    stackBenchPlaceBelow (w, values->sibling);
+
+    return 1;
+}
+
+/* Stacking needs nothing else from the rest of the window manager */
+Display *
+myScreenGetXDisplay (ScreenInfo *screen_info)
+{
+    return NULL;
+}
+
+Client *
+myScreenGetClientFromWindow (ScreenInfo *screen_info, Window w, unsigned short mode)
+{
+    return g_hash_table_lookup (bench.windows, GUINT_TO_POINTER (w));
+}
+
+Client *
+myDisplayGetClientFromWindow (DisplayInfo *display_info, Window w, unsigned short mode)
+{
+    return g_hash_table_lookup (bench.windows, GUINT_TO_POINTER (w));
+}
+
+void
+myDisplayAddClient (DisplayInfo *display_info, Client *c)
+{
+    g_hash_table_insert (bench.windows, GUINT_TO_POINTER (c->window), c);
+    g_hash_table_insert (bench.windows, GUINT_TO_POINTER (c->frame), c);
+}
+
+void
+myDisplayRemoveClient (DisplayInfo *display_info, Client *c)
+{
+    g_hash_table_remove (bench.windows, GUINT_TO_POINTER (c->window));
+    g_hash_table_remove (bench.windows, GUINT_TO_POINTER (c->frame));
+}
+
+void
+clientSetNetClientList (ScreenInfo *screen_info, Atom atom)
+{
+}
+
+void
+clientSetLayer (Client *c, guint l)
+{
+    c->win_layer = l;
+}
+
+void
+strutsInvalidate (ScreenInfo *screen_info)
+{
+}
+
+Client *
+clientGetFocus (void)
+{
+    return NULL;
+}
+
+void
+clientPassFocus (ScreenInfo *screen_info, Client *c, GList *exclude_list)
+{
+}
+
+gboolean
+clientSelectMask (Client *c, Client *other, guint mask, guint type)
+{
+    return TRUE;
+}
+
+void
+frameIndexQuery (ScreenInfo *screen_info, const GdkRectangle *area, GPtrArray *result)
+{
+}
+
+int
+frameX (Client *c)
+{
+    return 0;
+}
+
+int
+frameY (Client *c)
+{
+    return 0;
+}
+
+int
+frameWidth (Client *c)
+{
+    return 0;
+}
+
+int
+frameHeight (Client *c)
+{
+    return 0;
+}
+
+/* The per-client links and the server stack must both match the stack list */
+static gboolean
+stackBenchCheck (ScreenInfo *screen_info)
+{
+    GList *list;
+    Client *c;
+    guint i, count;
+
+    count = 0;
+    for (list = screen_info->windows_stack; list; list = g_list_next (list))
+    {
+        c = (Client *) list->data;
+        if ((c->stack_link != list) || (!list->next && (list != screen_info->windows_stack_last)))
+        {
+            g_printerr ("Stack link of client 0x%lx is wrong\n", c->window);
+            return FALSE;
+        }
+        count++;
+    }
+    if (count != screen_info->client_count)
+    {
+        g_printerr ("%u clients in the stack, %u managed\n", count, screen_info->client_count);
+        return FALSE;
+    }
+
+    i = 4;
+    for (list = screen_info->windows_stack_last; list; list = g_list_previous (list))
+    {
+        c = (Client *) list->data;
+        if ((i >= bench.server_stack->len) ||
+            (g_array_index (bench.server_stack, Window, i) != c->frame))
+        {
+            g_printerr ("Server stack differs at %u, frame 0x%lx\n", i, c->frame);
+            return FALSE;
+        }
+        i++;
+    }
+
+    return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+    DisplayInfo *display_info;
+    ScreenInfo *screen_info;
+    Client **clients, *c;
+    GRand *rand;
+    gint64 start, elapsed;
+    guint n_clients, n_raises, transients, seed;
+    guint i, applied;
+    Window w;
+
+    n_clients = 2000;
+    n_raises = 10000;
+    transients = 10;
+    seed = 1;
+    for (i = 1; i < (guint) argc; i++)
+    {
+        if (g_str_has_prefix (argv[i], "--clients="))
+        {
+            n_clients = (guint) MAX (atoi (argv[i] + strlen ("--clients=")), 2);
+        }
+        else if (g_str_has_prefix (argv[i], "--raises="))
+        {
+            n_raises = (guint) MAX (atoi (argv[i] + strlen ("--raises=")), 1);
+        }
+        else if (g_str_has_prefix (argv[i], "--transients="))
+        {
+            transients = (guint) CLAMP (atoi (argv[i] + strlen ("--transients=")), 0, 100);
+        }
+        else if (g_str_has_prefix (argv[i], "--seed="))
+        {
+            seed = (guint) atoi (argv[i] + strlen ("--seed="));
+        }
+        else
+        {
+            g_printerr ("Usage: %s [--clients=n] [--raises=n] [--transients=percent] [--seed=n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench.server_stack = g_array_sized_new (FALSE, FALSE, sizeof (Window), n_clients + 4);
+    bench.windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    display_info = g_new0 (DisplayInfo, 1);
+    screen_info = g_new0 (ScreenInfo, 1);
+    screen_info->display_info = display_info;
+    screen_info->xroot = STACK_BENCH_ROOT;
+
+    /* The sidewalks stay above everything else */
+    w = STACK_BENCH_FIRST_XID;
+    for (i = 0; i < 4; i++)
+    {
+        MYWINDOW_XWINDOW (screen_info->sidewalk[i]) = w;
+        g_array_append_val (bench.server_stack, w);
+        w++;
+    }
+
+    rand = g_rand_new_with_seed (seed);
+    clients = g_new0 (Client *, n_clients);
+    for (i = 0; i < n_clients; i++)
+    {
+        c = g_new0 (Client, 1);
+        c->screen_info = screen_info;
+        c->window = w++;
+        c->frame = w++;
+        c->name = g_strdup_printf ("client %u", i);
+        c->win_layer = WIN_LAYER_NORMAL;
+        c->type = WINDOW_NORMAL;
+        if ((i > 0) && (g_rand_int_range (rand, 0, 100) < (gint32) transients))
+        {
+            c->transient_for = clients[g_rand_int_range (rand, 0, i)]->window;
+            c->type = WINDOW_DIALOG;
+        }
+        else if (g_rand_int_range (rand, 0, 100) < 5)
+        {
+            c->win_layer = g_rand_boolean (rand) ? WIN_LAYER_BELOW : WIN_LAYER_ONTOP;
+        }
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_VISIBLE);
+        clients[i] = c;
+
+        /* Mapped windows start on top, as after clientFrame() */
+        clientAddToList (c);
+        clientRaise (c, None);
+    }
+
+    if (!stackBenchCheck (screen_info))
+    {
+        return 1;
+    }
+
+    bench.restacks = 0;
+    bench.configures = 0;
+    bench.restacked = 0;
+    applied = 0;
+    elapsed = 0;
+    for (i = 0; i < n_raises; i++)
+    {
+        c = clients[g_rand_int_range (rand, 0, n_clients)];
+        if (c != screen_info->last_raise)
+        {
+            applied++;
+        }
+
+        start = g_get_monotonic_time ();
+        clientRaise (c, None);
+        elapsed += g_get_monotonic_time () - start;
+
+        if (!stackBenchCheck (screen_info))
+        {
+            g_printerr ("After raise %u of client 0x%lx\n", i, c->window);
+            return 1;
+        }
+    }
+
+    g_print ("%u clients, %u raises: %.1f us per raise\n", n_clients, n_raises,
+             (gdouble) elapsed / n_raises);
+    /* Compared to restacking all the windows on each raise, as it used to */
+    g_print ("%u full restack(s), %u window(s) moved alone, %u window(s) restacked, %u otherwise\n",
+             bench.restacks, bench.configures, bench.restacked, applied * (n_clients + 4));
+
+    for (i = 0; i < n_clients; i++)
+    {
+        clientRemoveFromList (clients[i]);
+        g_free (clients[i]->name);
+        g_free (clients[i]);
+    }
+    g_free (clients);
+    g_rand_free (rand);
+    g_array_free (screen_info->applied_stack, TRUE);
+    g_free (screen_info);
+    g_free (display_info);
+    g_hash_table_destroy (bench.windows);
+    g_array_free (bench.server_stack, TRUE);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+/*
+ * Decoder for the event trace written by xfwm4 on SIGUSR2, see
+ * event_trace.h for the file format.
+ *
+ *   xfwm4-trace-decode [--slow=usec] $XDG_RUNTIME_DIR/xfwm4-trace-<pid>.bin
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <X11/X.h>
+
+#include "event_trace.h"
+
+static const gchar *
+getEventTypeName (guint16 type)
+{
+    static const gchar *names[] = {
+        NULL, NULL,
+        "KeyPress", "KeyRelease", "ButtonPress", "ButtonRelease",
+        "MotionNotify", "EnterNotify", "LeaveNotify", "FocusIn",
+        "FocusOut", "KeymapNotify", "Expose", "GraphicsExpose",
+        "NoExpose", "VisibilityNotify", "CreateNotify", "DestroyNotify",
+        "UnmapNotify", "MapNotify", "MapRequest", "ReparentNotify",
+        "ConfigureNotify", "ConfigureRequest", "GravityNotify", "ResizeRequest",
+        "CirculateNotify", "CirculateRequest", "PropertyNotify", "SelectionClear",
+        "SelectionRequest", "SelectionNotify", "ColormapNotify", "ClientMessage",
+        "MappingNotify", "GenericEvent"
+    };
+
+    if ((type < G_N_ELEMENTS (names)) && (names[type]))
+    {
+        return names[type];
+    }
+    return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+    eventTraceHeader header;
+    eventTraceRecord record;
+    const gchar *filename;
+    const gchar *name;
+    gint64 first_receive_time;
+    gint64 last_receive_time;
+    guint32 first_server_time;
+    guint32 slow;
+    guint32 i;
+    gchar type[16];
+    FILE *f;
+
+    slow = 0;
+    filename = NULL;
+    for (i = 1; i < (guint32) argc; i++)
+    {
+        if (g_str_has_prefix (argv[i], "--slow="))
+        {
+            slow = (guint32) atoi (argv[i] + strlen ("--slow="));
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    if (!filename)
+    {
+        g_printerr ("Usage: %s [--slow=usec] trace-file\n", argv[0]);
+        return 1;
+    }
+
+    f = fopen (filename, "rb");
+    if (!f)
+    {
+        g_printerr ("Cannot open %s: %s\n", filename, g_strerror (errno));
+        return 1;
+    }
+
+    if ((fread (&header, sizeof (header), 1, f) != 1) ||
+        (memcmp (header.magic, EVENT_TRACE_MAGIC, sizeof (header.magic)) != 0))
+    {
+        g_printerr ("%s is not an xfwm4 event trace\n", filename);
+        fclose (f);
+        return 1;
+    }
+
+    if ((header.byte_order != 0x01020304) ||
+        (header.record_size != sizeof (eventTraceRecord)))
+    {
+        g_printerr ("%s was written on an incompatible machine\n", filename);
+        fclose (f);
+        return 1;
+    }
+
+    g_print ("%u records, %u older records dropped\n", header.count, header.dropped);
+    g_print ("%10s %-10s %-18s %10s %12s %12s %10s\n",
+             "seq", "source", "type", "window", "server (ms)", "local (ms)", "duration");
+
+    first_receive_time = 0;
+    last_receive_time = 0;
+    first_server_time = 0;
+    for (i = 0; i < header.count; i++)
+    {
+        if (fread (&record, sizeof (record), 1, f) != 1)
+        {
+            g_printerr ("Trace truncated after %u records\n", i);
+            break;
+        }
+
+        if (i == 0)
+        {
+            first_receive_time = record.receive_time;
+            first_server_time = record.server_time;
+        }
+        last_receive_time = record.receive_time;
+
+        if (record.duration < slow)
+        {
+            continue;
+        }
+
+        name = getEventTypeName (record.type);
+        if (!name)
+        {
+            g_snprintf (type, sizeof (type), "%u", record.type);
+            name = type;
+        }
+
+        /* Server timestamps are in ms and wrap at 32 bits */
+        g_print ("%10u %-10s %-18s 0x%08x %12d %12.3f %8u us\n",
+                 record.sequence,
+                 (record.source == EVENT_TRACE_SOURCE_COMPOSITOR) ? "compositor" : "handler",
+                 name, record.window,
+                 (gint32) (record.server_time - first_server_time),
+                 (record.receive_time - first_receive_time) / 1000.0,
+                 record.duration);
+    }
+
+    if (last_receive_time)
+    {
+        g_print ("trace dumped %.3f ms after the last record started\n",
+                 (header.dump_time - last_receive_time) / 1000.0);
+    }
+
+    fclose (f);
+    return 0;
+}
@@ -0,0 +1,322 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+
+
+/*
+ * Runs the XPM parser of mypixmap.c over theme pixmaps, and over
+ * truncated and mutated copies of them, and times the parse. Each
+ * variant is copied in a buffer of its exact size so that running
+ * this under valgrind or with -fsanitize=address catches any read
+ * past the end of the data:
+ *
+ *   xfwm4-xpm-fuzz [--iterations=n] [--mutations=n] [--seed=n] [--verbose] \
+ *       $(find themes -name '*.xpm')
+ */
+
+#include "mypixmap.c"
+
+static guint parse_warnings = 0;
+static gboolean verbose = FALSE;
+
+/* The parser lives in mypixmap.c, which needs nothing else from the screen */
+Display *
+myScreenGetXDisplay (ScreenInfo *screen_info)
+{
+    return NULL;
+}
+
+static void
+xpmFuzzLogHandler (const gchar *log_domain, GLogLevelFlags log_level,
+                   const gchar *message, gpointer user_data)
+{
+    parse_warnings++;
+    if (verbose)
+    {
+        g_log_default_handler (log_domain, log_level, message, user_data);
+    }
+}
+
+/* Same symbols as the ones the themes use, with fixed colors */
+static xfwmColorSymbol xpm_fuzz_colors[] =
+{
+    { "active_text_color",     "#ffffff" },
+    { "inactive_text_color",   "#000000" },
+    { "active_border_color",   "#000000" },
+    { "inactive_border_color", "#000000" },
+    { "active_color_1",        "#3465a4" },
+    { "active_hilight_1",      "#729fcf" },
+    { "active_shadow_1",       "#204a87" },
+    { "active_mid_1",          "#5080c0" },
+    { "active_color_2",        "#dcdad5" },
+    { "active_hilight_2",      "#ffffff" },
+    { "active_shadow_2",       "#888a85" },
+    { "active_mid_2",          "#babdb6" },
+    { "inactive_color_1",      "#dcdad5" },
+    { "inactive_hilight_1",    "#ffffff" },
+    { "inactive_shadow_1",     "#888a85" },
+    { "inactive_mid_1",        "#babdb6" },
+    { "inactive_color_2",      "#dcdad5" },
+    { "inactive_hilight_2",    "#ffffff" },
+    { "inactive_shadow_2",     "#888a85" },
+    { "inactive_mid_2",        "#babdb6" },
+    { NULL,                    NULL }
+};
+
+/* Header values the parser has to refuse or survive */
+static const gchar *xpm_fuzz_headers[] =
+{
+    "0 0 0 0",
+    "-1 -1 -1 -1",
+    "1 1 1 0",
+    "1 1 1 32",
+    "1 1 0 1",
+    "1 1 2147483647 1",
+    "2147483647 1 1 1",
+    "4096 4096 1 1",
+    "21 29 5 2",
+    "21 29 65536 1",
+    "21",
+    "",
+};
+
+typedef struct
+{
+    guint variants;
+    guint parsed;
+    guint rejected;
+    gint64 elapsed;
+} XpmFuzzStats;
+
+static GdkPixbuf *
+xpmFuzzParse (const gchar *data, gsize size)
+{
+    struct file_handle h;
+    GdkPixbuf *pixbuf;
+    gchar *copy;
+
+    /* Exact size, so that overreads hit the end of the allocation */
+    copy = g_malloc (MAX (size, 1));
+    memcpy (copy, data, size);
+
+    memset (&h, 0, sizeof (h));
+    h.pos = copy;
+    h.end = copy + size;
+    pixbuf = pixbuf_create_from_xpm (&h, xpm_fuzz_colors);
+    g_free (h.buffer);
+    g_free (copy);
+
+    return pixbuf;
+}
+
+static void
+xpmFuzzRun (XpmFuzzStats *stats, const gchar *data, gsize size)
+{
+    GdkPixbuf *pixbuf;
+    gint64 start;
+
+    start = g_get_monotonic_time ();
+    pixbuf = xpmFuzzParse (data, size);
+    stats->elapsed += g_get_monotonic_time () - start;
+
+    stats->variants++;
+    if (pixbuf)
+    {
+        stats->parsed++;
+        g_object_unref (pixbuf);
+    }
+    else
+    {
+        stats->rejected++;
+    }
+}
+
+static void
+xpmFuzzTruncate (XpmFuzzStats *stats, const gchar *data, gsize size)
+{
+    gsize length, step;
+
+    step = MAX (size / 64, 1);
+    for (length = 0; length < size; length += step)
+    {
+        xpmFuzzRun (stats, data, length);
+    }
+    xpmFuzzRun (stats, data, size - 1);
+}
+
+static void
+xpmFuzzMutate (XpmFuzzStats *stats, GRand *rand, const gchar *data, gsize size, guint count)
+{
+    static const gchar interesting[] = "\"\0 9/*{},#";
+    gchar *copy;
+    guint i, j, n;
+    gsize pos;
+
+    copy = g_malloc (size);
+    for (i = 0; i < count; i++)
+    {
+        memcpy (copy, data, size);
+        n = g_rand_int_range (rand, 1, 5);
+        for (j = 0; j < n; j++)
+        {
+            pos = g_rand_int_range (rand, 0, (gint32) size);
+            if (g_rand_boolean (rand))
+            {
+                copy[pos] = interesting[g_rand_int_range (rand, 0, sizeof (interesting) - 1)];
+            }
+            else
+            {
+                copy[pos] = (gchar) g_rand_int_range (rand, 0, 256);
+            }
+        }
+        xpmFuzzRun (stats, copy, size);
+    }
+    g_free (copy);
+}
+
+static void
+xpmFuzzHeaders (XpmFuzzStats *stats, const gchar *data, gsize size)
+{
+    const gchar *start, *end;
+    GString *variant;
+    guint i;
+
+    /* The header is the first string of the array */
+    start = memchr (data, '{', size);
+    start = start ? memchr (start, '"', size - (start - data)) : NULL;
+    end = start ? memchr (start + 1, '"', size - (start + 1 - data)) : NULL;
+    if (!end)
+    {
+        return;
+    }
+
+    variant = g_string_sized_new (size + 32);
+    for (i = 0; i < G_N_ELEMENTS (xpm_fuzz_headers); i++)
+    {
+        g_string_truncate (variant, 0);
+        g_string_append_len (variant, data, start + 1 - data);
+        g_string_append (variant, xpm_fuzz_headers[i]);
+        g_string_append_len (variant, end, size - (end - data));
+        xpmFuzzRun (stats, variant->str, variant->len);
+    }
+    g_string_free (variant, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+    XpmFuzzStats stats, total;
+    GdkPixbuf *pixbuf;
+    GRand *rand;
+    gchar *contents;
+    gsize size;
+    gint64 start, elapsed;
+    guint iterations, mutations, seed;
+    guint files, failed;
+    gint i, j;
+
+    iterations = 100;
+    mutations = 200;
+    seed = 1;
+    files = 0;
+    failed = 0;
+    memset (&total, 0, sizeof (total));
+
+    for (i = 1; i < argc && g_str_has_prefix (argv[i], "--"); i++)
+    {
+        if (g_str_has_prefix (argv[i], "--iterations="))
+        {
+            iterations = (guint) MAX (atoi (argv[i] + strlen ("--iterations=")), 1);
+        }
+        else if (g_str_has_prefix (argv[i], "--mutations="))
+        {
+            mutations = (guint) MAX (atoi (argv[i] + strlen ("--mutations=")), 0);
+        }
+        else if (g_str_has_prefix (argv[i], "--seed="))
+        {
+            seed = (guint) atoi (argv[i] + strlen ("--seed="));
+        }
+        else if (!strcmp (argv[i], "--verbose"))
+        {
+            verbose = TRUE;
+        }
+    }
+
+    if (i >= argc)
+    {
+        g_printerr ("Usage: %s [--iterations=n] [--mutations=n] [--seed=n] [--verbose] file.xpm...\n", argv[0]);
+        return 1;
+    }
+
+    g_log_set_handler (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, xpmFuzzLogHandler, NULL);
+    rand = g_rand_new_with_seed (seed);
+
+    g_print ("%-48s %8s %8s %12s\n", "file", "bytes", "size", "parse (us)");
+    for (; i < argc; i++)
+    {
+        if (!g_file_get_contents (argv[i], &contents, &size, NULL) || (size == 0))
+        {
+            g_printerr ("Cannot read %s\n", argv[i]);
+            failed++;
+            continue;
+        }
+        files++;
+
+        pixbuf = xpmFuzzParse (contents, size);
+        if (!pixbuf)
+        {
+            g_printerr ("%s does not parse\n", argv[i]);
+            failed++;
+            g_free (contents);
+            continue;
+        }
+
+        start = g_get_monotonic_time ();
+        for (j = 0; j < (gint) iterations; j++)
+        {
+            g_object_unref (xpmFuzzParse (contents, size));
+        }
+        elapsed = g_get_monotonic_time () - start;
+        g_print ("%-48s %8lu %4dx%-4d %12.1f\n", argv[i], (gulong) size,
+                 gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf),
+                 (gdouble) elapsed / iterations);
+        g_object_unref (pixbuf);
+
+        memset (&stats, 0, sizeof (stats));
+        xpmFuzzTruncate (&stats, contents, size);
+        xpmFuzzHeaders (&stats, contents, size);
+        xpmFuzzMutate (&stats, rand, contents, size, mutations);
+        total.variants += stats.variants;
+        total.parsed += stats.parsed;
+        total.rejected += stats.rejected;
+        total.elapsed += stats.elapsed;
+
+        g_free (contents);
+    }
+    g_rand_free (rand);
+
+    g_print ("%u file(s), %u variant(s): %u parsed, %u rejected, %u warning(s), %.1f us per variant\n",
+             files, total.variants, total.parsed, total.rejected, parse_warnings,
+             (gdouble) total.elapsed / MAX (total.variants, 1));
+
+    return (failed ? 1 : 0);
+}
@@ -1519,3 +1519,179 @@ static const XPMColorEntry xColors[] = {
   { 7324, 139, 139, 0 },
   { 7332, 154, 205, 50 }
 };
+
+#define XPM_COLOR_HASH_SIZE 2048
+
+static const guint16 xColorHash[XPM_COLOR_HASH_SIZE] = {
+  0, 0, 0, 614, 0, 0, 264, 0, 67, 70, 0, 0,
+  0, 575, 0, 0, 0, 440, 0, 0, 0, 0, 0, 0,
+  0, 137, 155, 671, 0, 567, 0, 0, 0, 597, 539, 0,
+  495, 134, 0, 0, 0, 0, 263, 196, 456, 0, 572, 0,
+  571, 278, 545, 0, 0, 90, 736, 0, 0, 0, 0, 467,
+  0, 53, 339, 605, 66, 635, 245, 0, 29, 87, 91, 0,
+  0, 270, 637, 0, 193, 0, 0, 0, 0, 0, 462, 0,
+  227, 367, 481, 60, 0, 0, 576, 726, 0, 234, 0, 165,
+  357, 602, 661, 248, 0, 0, 0, 345, 108, 0, 0, 620,
+  257, 31, 594, 0, 0, 577, 727, 284, 492, 0, 364, 683,
+  57, 113, 0, 0, 0, 0, 239, 333, 352, 733, 0, 0,
+  0, 0, 0, 321, 342, 0, 378, 0, 512, 0, 0, 0,
+  0, 315, 0, 0, 0, 0, 16, 49, 229, 56, 653, 507,
+  0, 0, 0, 240, 336, 391, 0, 0, 159, 490, 690, 0,
+  326, 0, 0, 377, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 295, 0, 629, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 405, 0, 587, 751, 0, 0, 0, 0,
+  0, 0, 0, 0, 724, 0, 0, 94, 0, 0, 329, 0,
+  0, 62, 0, 0, 632, 51, 0, 0, 177, 0, 0, 0,
+  0, 0, 149, 538, 748, 0, 0, 0, 0, 427, 0, 0,
+  0, 0, 0, 0, 557, 682, 0, 142, 421, 0, 0, 0,
+  471, 172, 0, 0, 0, 0, 0, 0, 92, 0, 0, 216,
+  752, 0, 0, 0, 0, 0, 0, 0, 0, 202, 0, 0,
+  38, 95, 445, 0, 121, 418, 0, 0, 0, 0, 0, 0,
+  0, 86, 709, 0, 0, 0, 0, 0, 213, 0, 0, 78,
+  0, 409, 0, 0, 0, 714, 0, 0, 0, 535, 0, 126,
+  0, 478, 0, 0, 0, 665, 0, 470, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 218, 680, 0, 129, 97, 0, 0,
+  0, 0, 0, 208, 44, 0, 0, 253, 560, 0, 0, 80,
+  0, 0, 668, 296, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 439, 739,
+  0, 0, 0, 0, 198, 0, 72, 0, 0, 0, 0, 0,
+  302, 705, 0, 0, 0, 521, 0, 0, 0, 0, 0, 396,
+  0, 647, 673, 641, 0, 0, 0, 0, 460, 528, 0, 0,
+  0, 188, 273, 71, 275, 458, 0, 0, 0, 0, 0, 0,
+  0, 0, 293, 0, 0, 0, 0, 0, 0, 469, 670, 0,
+  152, 0, 0, 0, 251, 0, 0, 84, 474, 417, 119, 496,
+  0, 262, 297, 455, 717, 0, 0, 0, 281, 0, 472, 0,
+  0, 735, 0, 0, 414, 26, 466, 0, 0, 559, 0, 0,
+  616, 246, 0, 0, 0, 0, 0, 0, 267, 0, 0, 192,
+  720, 0, 0, 0, 522, 463, 0, 228, 506, 0, 0, 0,
+  0, 676, 0, 0, 0, 0, 358, 660, 0, 0, 249, 288,
+  0, 0, 348, 0, 96, 292, 0, 256, 189, 561, 442, 0,
+  0, 0, 0, 103, 223, 363, 473, 0, 112, 407, 679, 0,
+  0, 238, 330, 353, 537, 564, 601, 0, 291, 518, 320, 341,
+  0, 379, 0, 745, 261, 8, 0, 0, 308, 0, 85, 0,
+  100, 17, 230, 652, 0, 0, 508, 0, 0, 0, 0, 337,
+  386, 0, 0, 160, 0, 0, 581, 325, 0, 0, 374, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 628, 0,
+  0, 1, 0, 0, 0, 21, 74, 0, 0, 132, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 723,
+  0, 0, 0, 491, 544, 340, 612, 0, 0, 0, 0, 0,
+  0, 0, 0, 176, 0, 0, 656, 0, 0, 150, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 183,
+  556, 623, 34, 123, 613, 0, 526, 0, 0, 0, 0, 486,
+  716, 0, 0, 0, 583, 0, 215, 0, 625, 0, 0, 0,
+  0, 0, 0, 0, 203, 0, 0, 37, 180, 0, 0, 122,
+  0, 0, 0, 0, 0, 0, 0, 0, 710, 0, 0, 0,
+  0, 0, 0, 212, 0, 0, 0, 0, 0, 0, 0, 2,
+  715, 0, 0, 93, 706, 0, 0, 0, 477, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 13, 138, 0,
+  547, 0, 0, 128, 14, 435, 0, 0, 0, 0, 0, 0,
+  0, 0, 220, 0, 0, 0, 0, 0, 0, 0, 300, 0,
+  0, 0, 131, 0, 0, 146, 438, 171, 0, 0, 0, 627,
+  0, 453, 0, 0, 0, 0, 740, 0, 0, 0, 0, 209,
+  685, 0, 444, 0, 0, 0, 0, 301, 0, 0, 0, 548,
+  395, 704, 0, 0, 0, 0, 397, 0, 0, 406, 0, 0,
+  0, 0, 0, 0, 0, 562, 0, 0, 0, 274, 0, 0,
+  485, 0, 674, 0, 0, 0, 0, 0, 551, 0, 20, 73,
+  141, 0, 0, 0, 696, 0, 0, 0, 0, 0, 649, 252,
+  0, 0, 0, 0, 424, 0, 0, 0, 0, 0, 718, 0,
+  0, 0, 0, 280, 0, 0, 0, 0, 0, 0, 0, 415,
+  0, 0, 0, 0, 566, 0, 0, 0, 598, 0, 0, 114,
+  133, 498, 606, 268, 147, 615, 195, 0, 0, 0, 0, 441,
+  277, 0, 225, 0, 0, 0, 157, 0, 0, 0, 0, 0,
+  52, 163, 359, 604, 117, 179, 250, 289, 501, 347, 0, 554,
+  271, 0, 255, 187, 0, 0, 430, 0, 0, 0, 184, 224,
+  370, 480, 59, 111, 0, 0, 0, 0, 25, 153, 166, 233,
+  331, 354, 447, 588, 0, 319, 344, 0, 0, 450, 514, 260,
+  7, 30, 0, 309, 578, 728, 373, 0, 18, 47, 0, 0,
+  0, 509, 167, 0, 0, 0, 334, 385, 0, 0, 0, 0,
+  81, 0, 324, 0, 0, 375, 0, 515, 0, 140, 725, 0,
+  312, 0, 0, 0, 0, 0, 50, 664, 0, 0, 45, 0,
+  0, 178, 0, 0, 390, 0, 0, 570, 643, 689, 422, 658,
+  88, 350, 517, 0, 0, 0, 722, 0, 0, 0, 0, 0,
+  307, 173, 611, 0, 0, 0, 156, 0, 0, 0, 175, 0,
+  0, 0, 585, 402, 151, 0, 750, 0, 0, 0, 0, 0,
+  0, 0, 0, 700, 0, 0, 555, 622, 0, 0, 0, 0,
+  63, 608, 0, 0, 0, 0, 487, 0, 0, 0, 0, 584,
+  0, 214, 0, 0, 0, 0, 0, 523, 0, 0, 0, 204,
+  0, 107, 36, 0, 0, 0, 420, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 746, 0, 0, 0, 0, 211, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 199, 0, 0, 0,
+  0, 0, 0, 476, 0, 0, 0, 0, 306, 0, 0, 0,
+  0, 0, 0, 669, 12, 644, 0, 0, 0, 0, 127, 434,
+  408, 0, 0, 0, 0, 0, 0, 0, 0, 231, 0, 0,
+  0, 0, 0, 0, 666, 299, 0, 0, 0, 0, 0, 0,
+  145, 563, 0, 0, 738, 0, 0, 0, 0, 0, 0, 0,
+  711, 741, 650, 41, 0, 0, 185, 686, 0, 0, 0, 0,
+  0, 0, 304, 0, 0, 0, 549, 0, 703, 527, 0, 0,
+  541, 398, 698, 0, 0, 639, 0, 0, 0, 0, 530, 0,
+  286, 626, 0, 0, 0, 69, 0, 3, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 697,
+  0, 0, 642, 0, 83, 0, 600, 531, 0, 494, 0, 0,
+  0, 0, 0, 0, 0, 719, 0, 0, 0, 0, 68, 283,
+  505, 0, 0, 737, 0, 0, 0, 0, 0, 511, 0, 0,
+  0, 0, 618, 599, 0, 0, 497, 0, 0, 0, 265, 553,
+  552, 194, 0, 0, 574, 0, 0, 276, 0, 226, 372, 0,
+  734, 0, 0, 0, 0, 0, 0, 633, 360, 603, 0, 116,
+  243, 290, 500, 619, 0, 0, 0, 272, 0, 254, 106, 191,
+  0, 0, 580, 730, 0, 0, 221, 369, 0, 58, 110, 0,
+  677, 0, 0, 232, 636, 355, 663, 0, 0, 0, 0, 503,
+  0, 343, 0, 0, 0, 513, 259, 6, 592, 0, 310, 579,
+  729, 384, 102, 699, 366, 0, 0, 0, 510, 0, 0, 9,
+  237, 335, 388, 0, 0, 158, 0, 0, 0, 323, 0, 0,
+  380, 0, 0, 0, 516, 595, 0, 313, 0, 0, 0, 0,
+  0, 655, 0, 19, 0, 0, 0, 109, 0, 0, 0, 389,
+  0, 0, 161, 0, 0, 0, 328, 349, 0, 0, 0, 0,
+  0, 0, 0, 0, 316, 624, 0, 318, 0, 631, 65, 432,
+  0, 0, 0, 0, 22, 75, 693, 0, 394, 0, 403, 0,
+  0, 749, 0, 0, 0, 0, 382, 638, 0, 0, 0, 0,
+  0, 0, 621, 0, 351, 400, 0, 64, 169, 443, 162, 659,
+  452, 488, 0, 0, 0, 565, 0, 0, 0, 0, 0, 721,
+  0, 0, 0, 425, 0, 0, 205, 744, 591, 28, 182, 4,
+  0, 120, 419, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 732, 0, 0, 0, 210, 0, 0, 0, 436, 0, 0,
+  40, 428, 0, 200, 0, 451, 0, 0, 0, 0, 475, 0,
+  0, 0, 0, 305, 0, 0, 448, 707, 0, 0, 493, 11,
+  0, 0, 0, 0, 0, 0, 433, 0, 0, 99, 0, 712,
+  459, 0, 0, 533, 0, 0, 0, 0, 0, 0, 0, 667,
+  0, 0, 0, 0, 0, 609, 0, 144, 0, 0, 0, 0,
+  429, 0, 154, 0, 0, 0, 0, 0, 742, 0, 42, 0,
+  536, 186, 0, 0, 0, 0, 0, 0, 0, 303, 0, 454,
+  0, 550, 0, 702, 0, 0, 0, 0, 399, 0, 0, 0,
+  0, 0, 0, 0, 0, 529, 675, 0, 0, 0, 0, 0,
+  0, 437, 0, 0, 0, 590, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 645, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 484, 0, 589, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 282, 0, 0, 0, 0, 0, 0,
+  0, 413, 0, 0, 648, 672, 568, 586, 0, 118, 502, 617,
+  0, 0, 135, 431, 0, 266, 0, 0, 197, 401, 457, 573,
+  0, 0, 279, 0, 0, 371, 449, 0, 0, 0, 416, 504,
+  468, 0, 54, 338, 361, 569, 115, 244, 499, 634, 0, 136,
+  0, 0, 269, 412, 0, 190, 98, 681, 0, 0, 0, 461,
+  0, 222, 368, 482, 79, 0, 0, 678, 0, 0, 235, 55,
+  164, 356, 546, 662, 247, 0, 0, 0, 346, 0, 0, 0,
+  0, 258, 5, 32, 593, 311, 0, 125, 285, 101, 464, 365,
+  483, 0, 0, 0, 0, 0, 747, 236, 332, 387, 0, 0,
+  0, 0, 0, 0, 322, 0, 0, 381, 446, 0, 0, 33,
+  0, 0, 314, 0, 0, 0, 0, 15, 48, 654, 0, 0,
+  0, 0, 24, 77, 241, 0, 392, 0, 0, 0, 691, 0,
+  287, 327, 0, 0, 376, 0, 104, 0, 525, 0, 0, 317,
+  423, 0, 294, 0, 532, 630, 0, 0, 0, 607, 0, 23,
+  76, 0, 0, 35, 393, 404, 0, 692, 0, 0, 89, 0,
+  0, 383, 0, 0, 105, 0, 0, 0, 0, 0, 0, 362,
+  610, 479, 0, 0, 0, 0, 0, 0, 489, 0, 0, 0,
+  0, 543, 61, 148, 582, 0, 0, 0, 0, 0, 426, 0,
+  124, 206, 46, 651, 0, 181, 558, 0, 0, 0, 743, 540,
+  0, 0, 657, 0, 0, 0, 0, 0, 0, 0, 139, 0,
+  217, 0, 0, 0, 0, 0, 0, 0, 0, 0, 201, 0,
+  0, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0, 465,
+  0, 0, 708, 0, 0, 0, 10, 174, 0, 0, 82, 0,
+  519, 0, 410, 0, 0, 0, 713, 0, 0, 0, 534, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 27, 143, 0, 168, 0, 219, 0, 0, 130, 0, 411,
+  0, 0, 0, 0, 207, 43, 0, 0, 242, 684, 0, 542,
+  0, 0, 596, 0, 298, 0, 0, 0, 0, 0, 701, 170,
+  0, 688, 524, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 687, 0, 0, 0, 520, 0,
+  0, 0, 0, 0, 0, 0, 694, 731, 0, 0, 0, 0,
+  0, 695, 646, 0, 640, 0, 0, 0
+};
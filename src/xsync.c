@@ -25,6 +25,7 @@
 #endif
 
 #include "xsync.h"
+#include "compositor.h"
 
 #ifdef HAVE_XSYNC
 
@@ -192,6 +193,8 @@ clientXSyncTimeout (gpointer data)
 
         /* Disable XSync for this client */
         FLAG_UNSET (c->flags, CLIENT_FLAG_XSYNC_ENABLED);
+        FLAG_UNSET (c->flags, CLIENT_FLAG_XSYNC_CONFIGURE);
+        compositorThawWindow (c->screen_info->display_info, c->frame);
     }
     return (FALSE);
 }
@@ -204,8 +207,14 @@ clientXSyncResetTimeout (Client * c)
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
     clientXSyncClearTimeout (c);
+    /*
+     * Leave slow clients enough time to draw rather than giving up on them,
+     * but not so much that a client which stopped answering holds us forever
+     */
     c->xsync_timeout_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
-                                              CLIENT_XSYNC_TIMEOUT,
+                                              CLAMP (4 * c->xsync_frame_time / 1000,
+                                                     CLIENT_XSYNC_TIMEOUT,
+                                                     CLIENT_XSYNC_MAX_TIMEOUT),
                                               clientXSyncTimeout, c, NULL);
 }
 
@@ -247,15 +256,90 @@ clientXSyncRequest (Client * c)
 
     clientXSyncResetTimeout (c);
     FLAG_SET (c->flags, CLIENT_FLAG_XSYNC_WAITING);
+    FLAG_UNSET (c->flags, CLIENT_FLAG_XSYNC_CONFIGURE);
+    c->xsync_request_time = g_get_monotonic_time ();
+}
+
+/*
+ * Tell the client its frame made it to the screen, clients using the
+ * extended counter wait for this before drawing the next frame. We do
+ * not know when the frame is actually presented, so the timings only
+ * carry the frame counter.
+ */
+void
+clientXSyncFrameDrawn (Client *c, gint64 drawn_time)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    XClientMessageEvent xev;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+    FLAG_UNSET (c->flags, CLIENT_FLAG_XSYNC_FRAME_PENDING);
+
+    xev.type = ClientMessage;
+    xev.window = c->window;
+    xev.message_type = display_info->atoms[NET_WM_FRAME_DRAWN];
+    xev.format = 32;
+    xev.data.l[0] = (long) XSyncValueLow32 (c->xsync_frame_value);
+    xev.data.l[1] = (long) XSyncValueHigh32 (c->xsync_frame_value);
+    xev.data.l[2] = (long) (drawn_time & G_GINT64_CONSTANT (0xffffffff));
+    xev.data.l[3] = (long) (drawn_time >> 32);
+    xev.data.l[4] = 0;
+    XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+
+    xev.message_type = display_info->atoms[NET_WM_FRAME_TIMINGS];
+    xev.data.l[2] = 0; /* presentation time offset, unknown */
+    xev.data.l[3] = 0; /* refresh interval, unknown */
+    xev.data.l[4] = 0;
+    XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+}
+
+static void
+clientXSyncQueueFrameDrawn (Client *c)
+{
+    if (!FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_FRAME_PENDING))
+    {
+        return;
+    }
+
+    /* Let the compositor tell once it has painted the frame */
+    if (!compositorQueueFrameDrawn (c->screen_info->display_info, c->frame))
+    {
+        clientXSyncFrameDrawn (c, g_get_monotonic_time ());
+    }
 }
 
 void
 clientXSyncUpdateValue (Client *c, XSyncValue value)
 {
+    gint64 frame_time;
+    gboolean waiting;
+
     g_return_if_fail (c != NULL);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
     c->xsync_value = value;
+
+    /* An even value of the extended counter means the client finished a frame */
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER) &&
+        (XSyncValueLow32 (value) % 2 == 0))
+    {
+        c->xsync_frame_value = value;
+        FLAG_SET (c->flags, CLIENT_FLAG_XSYNC_FRAME_PENDING);
+    }
+
+    /* Frames started before our request do not answer it */
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_WAITING) &&
+        XSyncValueLessThan (value, c->next_xsync_value))
+    {
+        clientXSyncQueueFrameDrawn (c);
+        return;
+    }
+
     if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER))
     {
         if (XSyncValueLow32(c->xsync_value) % 2 == 0)
@@ -263,8 +347,40 @@ clientXSyncUpdateValue (Client *c, XSyncValue value)
             addToXSyncValue (&value, 1);
         }
     }
+
+    waiting = FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_WAITING);
+    if (waiting)
+    {
+        frame_time = g_get_monotonic_time () - c->xsync_request_time;
+        c->xsync_frame_time = c->xsync_frame_time ?
+                              (3 * c->xsync_frame_time + frame_time) / 4 : frame_time;
+        TRACE ("client frame time %" G_GINT64_FORMAT " us", c->xsync_frame_time);
+    }
+
     c->next_xsync_value = value;
     clientXSyncClearTimeout (c);
+
+    /* The client has caught up, show what it drew at the new size */
+    if (waiting)
+    {
+        compositorThawWindow (c->screen_info->display_info, c->frame);
+    }
+    clientXSyncQueueFrameDrawn (c);
+
+    /*
+     * Motion events received while waiting were not applied, send the
+     * latest size now, so configure requests follow the client's pace.
+     */
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_CONFIGURE))
+    {
+        FLAG_UNSET (c->flags, CLIENT_FLAG_XSYNC_CONFIGURE);
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING) &&
+            FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_ENABLED))
+        {
+            clientXSyncRequest (c);
+            clientReconfigure (c, NO_CFG_FLAG);
+        }
+    }
 }
 
 #endif /* HAVE_XSYNC */
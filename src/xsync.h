@@ -50,6 +50,8 @@ void                     clientDestroyXSyncAlarm                (Client *);
 gboolean                 clientGetXSyncCounter                  (Client *);
 void                     clientXSyncClearTimeout                (Client *);
 void                     clientXSyncRequest                     (Client *);
+void                     clientXSyncFrameDrawn                  (Client *,
+                                                                 gint64);
 void                     clientXSyncUpdateValue                 (Client *,
                                                                  XSyncValue);
 